@@ -1,3 +1,5 @@
 Pushd "%~dp0"
 
 "%VULKAN_SDK%\Bin\glslc.exe" "%~dp0shaders\shader.comp" -o "cmake-build-debug\shader.comp.spv"
+"%VULKAN_SDK%\Bin\glslc.exe" "%~dp0shaders\wavefront.comp" -o "cmake-build-debug\wavefront.comp.spv"
+"%VULKAN_SDK%\Bin\glslc.exe" "%~dp0shaders\adaptive_sampling.comp" -o "cmake-build-debug\adaptive_sampling.comp.spv"
@@ -0,0 +1,553 @@
+// shared by the megakernel (shader.comp) and the wavefront kernels (wavefront.comp)
+
+// STRUCTS
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
+struct HitRecord {
+    bool doesHit;
+    float t;
+    vec3 point;
+    vec3 normal;
+    bool frontFace;
+    uint materialIndex;
+    vec2 uv;
+};
+
+struct ScatterRecord {
+    bool doesScatter;
+    vec3 attenuation;
+    vec3 scatterDirection;
+};
+
+struct Sphere {
+    vec3 center;
+    float radius;
+    uint materialIndex;
+};
+
+struct Material {
+    uint type;
+    uint textureType;
+    vec3[2] colors;
+    float specificAttribute;// metal: "fuzz", refractive: "refraction index"
+};
+
+struct BVHNode {
+    vec3 aabbMin;
+    uint offset;// leaf: index of the first sphere, inner node: index of the second child
+    vec3 aabbMax;
+    uint sphereCount;// 0 for inner nodes, the first child always directly follows its parent
+};
+
+struct Camera {
+    float fov;
+    float aperture;
+    float focusDistance;
+    vec3 lookFrom;
+    vec3 lookAt;
+    vec3 up;
+};
+
+struct Viewport {
+    vec3 horizontal;
+    vec3 vertical;
+    vec3 upperLeftCorner;
+    vec3 cameraUp;
+    vec3 cameraRight;
+};
+
+
+// INPUTS
+// one layer per view (VulkanSettings::viewCount)
+layout(binding = 0, rgba8) uniform writeonly image2DArray renderTarget;
+
+layout(binding = 1, rgba16) uniform image2DArray summedPixelColorImage;
+
+layout(binding = 2, std430) readonly buffer SphereBuffer {
+    Sphere spheres[];
+};
+
+layout(binding = 3, std430) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+layout(binding = 4, std430) readonly buffer BVH {
+    BVHNode nodes[];
+} bvh;
+
+// bounce and path counters of the current frame, only written if COLLECT_PATH_STATISTICS is set
+layout(binding = 10, std430) buffer PathStatistics {
+    uint pathCount[2];// low and high 32 bits
+    uint bounceCount[2];
+    uint sampledTileCount;// tiles in the adaptive sampling work list
+    uint squaredErrorSum[2];// progressive mode: squared relative error of the traced pixels, 16 fractional bits
+    uint errorPixelCount;
+} pathStatistics;
+
+// adaptive sampling and progressive mode: sample count, sum and squared sum of the luminance of every pixel
+layout(binding = 11, rgba32f) uniform image2D varianceImage;
+
+// tiles (work groups of shader.comp) that haven't converged yet, built by adaptive_sampling.comp
+layout(binding = 12, std430) buffer TileWorkList {
+    uint dispatch[3];// x: length of the list
+    uint padding;
+    uint tiles[];// y * tile columns + x
+} tileWorkList;
+
+// progressive mode: sum of all samples of every pixel, without knowing the total sample count upfront
+layout(binding = 13, rgba32f) uniform image2D accumulationImage;
+
+// one camera per view, updated by the host between render calls without recreating the pipelines
+layout(binding = 14, std430) readonly buffer CameraBuffer {
+    Camera cameras[];
+};
+
+layout(push_constant) uniform RenderCallInfo {
+    uint number;
+    uint totalRenderCalls;
+    uint totalSamples;
+} renderCallInfo;
+
+
+// ENUMS
+const uint MATERIAL_TYPE_DIFFUSE = 0;
+const uint MATERIAL_TYPE_METAL = 1;
+const uint MATERIAL_TYPE_REFRACTIVE = 2;
+
+const uint TEXTURE_TYPE_SOLID = 0;
+const uint TEXTURE_TYPE_CHECKERED = 1;
+
+
+// SPECIALIZATION CONSTANTS
+// the ids have to match the member order of SpecializationConstants in vulkan.h
+layout(constant_id = 0) const bool USE_BVH = true;
+layout(constant_id = 3) const uint MAX_DEPTH = 50;
+layout(constant_id = 4) const uint SAMPLES_PER_PASS = 0;// 0: derived from the push constants
+layout(constant_id = 5) const uint MATERIAL_TYPES = 7;// bit mask of the material types used by the scene
+
+layout(constant_id = 6) const float BACKGROUND_COLOR_R = 0.70f;
+layout(constant_id = 7) const float BACKGROUND_COLOR_G = 0.80f;
+layout(constant_id = 8) const float BACKGROUND_COLOR_B = 1.00f;
+
+layout(constant_id = 10) const bool RUSSIAN_ROULETTE = false;
+layout(constant_id = 11) const uint RUSSIAN_ROULETTE_MIN_DEPTH = 3;
+layout(constant_id = 12) const bool COLLECT_PATH_STATISTICS = false;
+layout(constant_id = 13) const bool ADAPTIVE_SAMPLING = false;
+layout(constant_id = 14) const uint ADAPTIVE_SAMPLING_MIN_SAMPLES = 16;
+layout(constant_id = 15) const float ADAPTIVE_SAMPLING_THRESHOLD = 0.02f;
+layout(constant_id = 16) const bool PROGRESSIVE = false;
+
+const bool HAS_DIFFUSE_MATERIALS = (MATERIAL_TYPES & (1u << MATERIAL_TYPE_DIFFUSE)) != 0u;
+const bool HAS_METAL_MATERIALS = (MATERIAL_TYPES & (1u << MATERIAL_TYPE_METAL)) != 0u;
+const bool HAS_REFRACTIVE_MATERIALS = (MATERIAL_TYPES & (1u << MATERIAL_TYPE_REFRACTIVE)) != 0u;
+const bool TRACK_VARIANCE = ADAPTIVE_SAMPLING || PROGRESSIVE;
+
+// CONSTANTS
+const float PI = 3.1415926535897932384626433832795f;
+
+const float MAX_RAY_COLLISION_DISTANCE = 100000000.0f;
+const vec3 BACKGROUND_COLOR = vec3(BACKGROUND_COLOR_R, BACKGROUND_COLOR_G, BACKGROUND_COLOR_B);
+const uint BVH_STACK_SIZE = 32;// has to match BVH_MAX_DEPTH in bvh.h
+
+
+// METHODS
+vec3 rayAt(const Ray ray, const float t);
+ScatterRecord scatter(const Ray ray, const HitRecord record);
+vec3 getTextureColor(const Material material, const vec3 point, const vec2 uv);
+HitRecord hitSphere(const Ray ray, const Sphere sphere, const float tMin, const float tMax);
+vec2 getSphereUV(const vec3 point);
+HitRecord hitAnySphere(const Ray ray, const float tMin, const float tMax);
+HitRecord hitAnySphereLinear(const Ray ray, const float tMin, const float tMax);
+HitRecord hitAnySphereBVH(const Ray ray, const float tMin, const float tMax);
+float hitAABB(const vec3 origin, const vec3 inverseDirection, const vec3 aabbMin, const vec3 aabbMax, const float tMin, const float tMax);
+float random();
+float randomInInterval(const float min, const float max);
+vec3 randomVector(const float min, const float max);
+vec3 randomUnitVector();
+bool isVectorNearZero(const vec3 vector);
+bool canRefract(const vec3 vector, const vec3 normal, const float eta);
+float reflectanceFactor(const vec3 vector, const vec3 normal, const float eta);
+Camera getCamera();
+Viewport calculateViewport(const float aspectRatio);
+Ray getCameraRay(const Viewport viewport, const vec2 uv);
+bool survivesRussianRoulette(inout vec3 throughput, const uint depth);
+void addPathStatistics(const uint paths, const uint bounces);
+vec4 addVarianceSample(const vec4 variance, const vec3 color);
+float getRelativeError(const vec4 variance);
+bool hasPixelConverged(const vec4 variance);
+void addImageError(const float relativeError);
+
+
+// MATERIAL
+ScatterRecord scatterMaterialDiffuse(const Ray ray, const HitRecord record, const Material material);
+ScatterRecord scatterMaterialMetal(const Ray ray, const HitRecord record, const Material material);
+ScatterRecord scatterMaterialRefractive(const Ray ray, const HitRecord record, const Material material);
+
+ScatterRecord scatter(const Ray ray, const HitRecord record) {
+    const Material material = materials[record.materialIndex];
+
+    // branches of material types the scene doesn't use are removed when the pipeline is specialized
+    if (HAS_DIFFUSE_MATERIALS && material.type == MATERIAL_TYPE_DIFFUSE) {
+        return scatterMaterialDiffuse(ray, record, material);
+
+    } else if (HAS_METAL_MATERIALS && material.type == MATERIAL_TYPE_METAL) {
+        return scatterMaterialMetal(ray, record, material);
+
+    } else if (HAS_REFRACTIVE_MATERIALS && material.type == MATERIAL_TYPE_REFRACTIVE) {
+        return scatterMaterialRefractive(ray, record, material);
+
+    }
+
+    return ScatterRecord(false, vec3(0.0f), vec3(0.0f));
+}
+
+
+// RAY
+vec3 rayAt(const Ray ray, const float t) {
+    return ray.origin + t * ray.direction;
+}
+
+// SCATTER
+ScatterRecord scatterMaterialDiffuse(const Ray ray, const HitRecord record, const Material material) {
+    vec3 scatterDirection = record.normal + randomUnitVector();
+
+    if (isVectorNearZero(scatterDirection)) {
+        scatterDirection = record.normal;
+    }
+
+    return ScatterRecord(true, getTextureColor(material, record.point, record.uv), scatterDirection);
+}
+
+ScatterRecord scatterMaterialMetal(const Ray ray, const HitRecord record, const Material material) {
+    const vec3 reflectedDirection = reflect(ray.direction, record.normal);
+    const vec3 fuzzDireciton = material.specificAttribute * randomUnitVector();
+    const vec3 scatterDirection = normalize(reflectedDirection + fuzzDireciton);
+
+    const bool doesScatter = dot(scatterDirection, record.normal) > 0.0f;
+    return ScatterRecord(doesScatter, getTextureColor(material, record.point, record.uv), scatterDirection);
+}
+
+ScatterRecord scatterMaterialRefractive(const Ray ray, const HitRecord record, const Material material) {
+    const float eta = record.frontFace ? (1.0f / material.specificAttribute) : material.specificAttribute;
+    const bool doesRefract = canRefract(ray.direction, record.normal, eta) && reflectanceFactor(ray.direction, record.normal, eta) < random();
+
+    vec3 scatterDirection;
+
+    if (doesRefract) {
+        scatterDirection = refract(ray.direction, record.normal, eta);
+    } else {
+        scatterDirection = reflect(ray.direction, record.normal);
+    }
+
+    return ScatterRecord(true, getTextureColor(material, record.point, record.uv), scatterDirection);
+}
+
+
+// TEXTURE
+vec3 getTextureColor(const Material material, const vec3 point, const vec2 uv) {
+    if (material.textureType == TEXTURE_TYPE_SOLID) {
+        return material.colors[0];
+
+    } else if (material.textureType == TEXTURE_TYPE_CHECKERED) {
+        const float size = 6.0f;
+        const float sines = sin(size * point.x) * sin(size * point.y) * sin(size * point.z);
+        return material.colors[sines > 0.0f ? 0 : 1];
+    }
+
+    return material.colors[0];
+}
+
+
+// SPHERE
+HitRecord hitSphere(const Ray ray, const Sphere sphere, const float tMin, const float tMax) {
+    const vec3 CO = ray.origin - sphere.center.xyz;
+    const float a = dot(ray.direction, ray.direction);
+    const float halfB = dot(CO, ray.direction);
+    const float c = dot(CO, CO) - sphere.radius * sphere.radius;
+
+    const float D = halfB * halfB - a * c;
+
+    if (D < 0) {
+        return HitRecord(false, 0.0f, vec3(0.0f), vec3(0.0f), true, 0, vec2(0.0f));
+    }
+
+    const float t1 = (-halfB - sqrt(D)) / a;
+    const float t2 = (-halfB + sqrt(D)) / a;
+
+    float t;
+
+    if (t1 >= tMin && t1 <= tMax) {
+        t = t1;
+    } else if (t2 >= tMin && t2 <= tMax) {
+        t = t2;
+    } else {
+        return HitRecord(false, 0.0f, vec3(0.0f), vec3(0.0f), true, 0, vec2(0.0f));
+    }
+
+    const vec3 point = rayAt(ray, t);
+    const vec3 outwardNormal = normalize(point - sphere.center.xyz);
+    const bool frontFace = dot(ray.direction, outwardNormal) < 0.0f;
+    const vec3 normal = frontFace ? outwardNormal : -outwardNormal;
+
+    return HitRecord(true, t, point, normal, frontFace, sphere.materialIndex, getSphereUV(point));
+}
+
+vec2 getSphereUV(const vec3 point) {
+    return vec2((atan(-point.z, point.x) + PI) / 2 * PI, acos(-point.y) / PI);
+}
+
+HitRecord hitAnySphere(const Ray ray, const float tMin, const float tMax) {
+    if (USE_BVH) {
+        return hitAnySphereBVH(ray, tMin, tMax);
+    }
+
+    return hitAnySphereLinear(ray, tMin, tMax);
+}
+
+HitRecord hitAnySphereLinear(const Ray ray, const float tMin, const float tMax) {
+    HitRecord record = HitRecord(false, tMax, vec3(0.0f), vec3(0.0f), true, 0, vec2(0.0f));
+
+    for (uint i = 0; i < uint(spheres.length()); i++) {
+        HitRecord tempRecord = hitSphere(ray, spheres[i], tMin, record.t);
+        if (tempRecord.doesHit) {
+            record = tempRecord;
+        }
+    }
+
+    return record;
+}
+
+
+// BVH
+// returns the entry distance of the ray into the box, or MAX_RAY_COLLISION_DISTANCE if it misses the box
+float hitAABB(const vec3 origin, const vec3 inverseDirection, const vec3 aabbMin, const vec3 aabbMax, const float tMin, const float tMax) {
+    const vec3 t0 = (aabbMin - origin) * inverseDirection;
+    const vec3 t1 = (aabbMax - origin) * inverseDirection;
+    const vec3 tSmaller = min(t0, t1);
+    const vec3 tBigger = max(t0, t1);
+
+    const float tNear = max(tMin, max(tSmaller.x, max(tSmaller.y, tSmaller.z)));
+    const float tFar = min(tMax, min(tBigger.x, min(tBigger.y, tBigger.z)));
+
+    return tNear <= tFar ? tNear : MAX_RAY_COLLISION_DISTANCE;
+}
+
+HitRecord hitAnySphereBVH(const Ray ray, const float tMin, const float tMax) {
+    HitRecord record = HitRecord(false, tMax, vec3(0.0f), vec3(0.0f), true, 0, vec2(0.0f));
+    const vec3 inverseDirection = 1.0f / ray.direction;
+
+    if (hitAABB(ray.origin, inverseDirection, bvh.nodes[0].aabbMin, bvh.nodes[0].aabbMax, tMin, record.t) == MAX_RAY_COLLISION_DISTANCE) {
+        return record;
+    }
+
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIndex = 0;
+
+    while (true) {
+        const BVHNode node = bvh.nodes[nodeIndex];
+
+        if (node.sphereCount > 0) {
+            for (uint i = node.offset; i < node.offset + node.sphereCount; i++) {
+                HitRecord tempRecord = hitSphere(ray, spheres[i], tMin, record.t);
+                if (tempRecord.doesHit) {
+                    record = tempRecord;
+                }
+            }
+
+        } else {
+            // visit the nearer child first and postpone the other one, so that record.t shrinks as early as possible
+            uint nearChild = nodeIndex + 1;
+            uint farChild = node.offset;
+
+            float tNear = hitAABB(ray.origin, inverseDirection, bvh.nodes[nearChild].aabbMin, bvh.nodes[nearChild].aabbMax, tMin, record.t);
+            float tFar = hitAABB(ray.origin, inverseDirection, bvh.nodes[farChild].aabbMin, bvh.nodes[farChild].aabbMax, tMin, record.t);
+
+            if (tFar < tNear) {
+                const uint tempChild = nearChild;
+                nearChild = farChild;
+                farChild = tempChild;
+
+                const float tempT = tNear;
+                tNear = tFar;
+                tFar = tempT;
+            }
+
+            if (tNear != MAX_RAY_COLLISION_DISTANCE) {
+                if (tFar != MAX_RAY_COLLISION_DISTANCE) {
+                    stack[stackSize++] = farChild;
+                }
+
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        if (stackSize == 0) {
+            break;
+        }
+
+        nodeIndex = stack[--stackSize];
+    }
+
+    return record;
+}
+
+
+// RANDOM
+uint hash(uint x) {
+    x += (x << 10u);
+    x ^= (x >>  6u);
+    x += (x <<  3u);
+    x ^= (x >> 11u);
+    x += (x << 15u);
+    return x;
+}
+
+// the random sequence of a pixel continues from these values, the kernels set them before calling random()
+uvec2 randomPixel = uvec2(0);
+uint view = 0;// the camera and the layer of the images the current invocation renders
+uint currentRandomOffset = 0;
+
+float random() {
+    currentRandomOffset += 1;
+    const uvec4 v = floatBitsToUint(vec4(randomPixel, renderCallInfo.number, currentRandomOffset));
+
+    // every view gets its own sequences, the first one keeps the sequences of a single view
+    uint m = hash(v.x ^ hash(v.y) ^ hash(v.z) ^ hash(v.w + view * 0x9E3779B9u));
+    m &= 0x007FFFFFu;
+    m |= 0x3F800000u;
+    return uintBitsToFloat(m) - 1.0f;
+}
+
+float randomInInterval(const float min, const float max) {
+    return random() * (max - min) + min;
+}
+
+vec3 randomVector(const float min, const float max) {
+    return vec3(randomInInterval(min, max), randomInInterval(min, max), randomInInterval(min, max));
+}
+
+vec3 randomUnitVector() {
+    return normalize(randomVector(-1.0f, 1.0f));
+}
+
+
+// UTILITY
+bool isVectorNearZero(const vec3 vector) {
+    const float s = 1e-8;
+    return abs(vector.x) < s && abs(vector.y) < s && abs(vector.z) < s;
+}
+
+bool canRefract(const vec3 vector, const vec3 normal, const float eta) {
+    const float cosTheta = dot(-vector, normal);
+    return eta * sqrt(1.0f - cosTheta * cosTheta) <= 1.0f;
+}
+
+float reflectanceFactor(const vec3 vector, const vec3 normal, const float eta) {
+    const float r = pow((1.0f - eta) / (1.0f + eta), 2.0f);
+    return r + (1.0f - r) * pow(1.0f - dot(-vector, normal), 5.0f);
+}
+
+// VIEWPORT
+Camera getCamera() {
+    return cameras[view];
+}
+
+Viewport calculateViewport(const float aspectRatio) {
+    const Camera camera = getCamera();
+    const float viewportHeight = tan(radians(camera.fov) / 2.0f) * 2.0f;
+    const float viewportWidth = aspectRatio * viewportHeight;
+
+    const vec3 cameraForward = normalize(camera.lookAt - camera.lookFrom);
+    const vec3 cameraRight = normalize(cross(camera.up, cameraForward));
+    const vec3 cameraUp = normalize(cross(cameraForward, cameraRight));
+
+    const vec3 horizontal = viewportWidth * cameraRight * camera.focusDistance;
+    const vec3 vertical = viewportHeight * cameraUp * camera.focusDistance;
+    const vec3 upperLeftCorner = camera.lookFrom - horizontal / 2.0f + vertical / 2.0f + cameraForward * camera.focusDistance;
+
+    return Viewport(horizontal, vertical, upperLeftCorner, cameraUp, cameraRight);
+}
+
+Ray getCameraRay(const Viewport viewport, const vec2 uv) {
+    const Camera camera = getCamera();
+    const vec2 random = (camera.aperture / 2.0f) * normalize(vec2(randomInInterval(-1.0f, 1.0f), randomInInterval(-1.0f, 1.0f)));
+    const vec3 offset = viewport.cameraRight * random.x + viewport.cameraUp * random.y;
+
+    const vec3 from = camera.lookFrom + offset;
+    const vec3 to = viewport.upperLeftCorner + viewport.horizontal * uv.x - viewport.vertical * uv.y;
+
+    return Ray(from, normalize(to - from));
+}
+
+
+// PATH TERMINATION
+// paths with a low throughput are likely to be terminated, the surviving ones are weighted up to stay unbiased
+bool survivesRussianRoulette(inout vec3 throughput, const uint depth) {
+    if (!RUSSIAN_ROULETTE || depth < RUSSIAN_ROULETTE_MIN_DEPTH) {
+        return true;
+    }
+
+    const float survivalProbability = min(max(throughput.r, max(throughput.g, throughput.b)), 1.0f);
+    if (random() >= survivalProbability) {
+        return false;
+    }
+
+    throughput /= survivalProbability;
+    return true;
+}
+
+
+// STATISTICS
+void addPathStatistics(const uint paths, const uint bounces) {
+    // 64 bit counters, the high word is incremented whenever adding to the low word overflows
+    if (atomicAdd(pathStatistics.pathCount[0], paths) > 0xFFFFFFFFu - paths) {
+        atomicAdd(pathStatistics.pathCount[1], 1u);
+    }
+
+    if (atomicAdd(pathStatistics.bounceCount[0], bounces) > 0xFFFFFFFFu - bounces) {
+        atomicAdd(pathStatistics.bounceCount[1], 1u);
+    }
+}
+
+
+// ADAPTIVE SAMPLING
+// a pixel of the variance image holds the sample count, the sum and the squared sum of the luminance of its samples
+vec4 addVarianceSample(const vec4 variance, const vec3 color) {
+    const float luminance = dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+    return variance + vec4(1.0f, luminance, luminance * luminance, 0.0f);
+}
+
+// the standard error of the mean luminance relative to the mean, dark pixels are compared against a lower bound of the
+// mean instead, as their relative error would hardly ever get small enough. 1 until the estimate can be trusted.
+float getRelativeError(const vec4 variance) {
+    const float sampleCount = variance.x;
+    if (sampleCount < float(max(ADAPTIVE_SAMPLING_MIN_SAMPLES, 2u))) {
+        return 1.0f;
+    }
+
+    const float mean = variance.y / sampleCount;
+    const float sampleVariance = max(variance.z - variance.y * mean, 0.0f) / (sampleCount - 1.0f);
+    const float standardError = sqrt(sampleVariance / sampleCount);
+
+    return standardError / max(mean, 0.1f);
+}
+
+bool hasPixelConverged(const vec4 variance) {
+    return getRelativeError(variance) <= ADAPTIVE_SAMPLING_THRESHOLD;
+}
+
+// the host stops the progressive mode once the root mean square of the errors is below its target
+void addImageError(const float relativeError) {
+    const uint squaredError = uint(min(relativeError * relativeError, 1.0f) * 65536.0f);
+
+    if (atomicAdd(pathStatistics.squaredErrorSum[0], squaredError) > 0xFFFFFFFFu - squaredError) {
+        atomicAdd(pathStatistics.squaredErrorSum[1], 1u);
+    }
+
+    atomicAdd(pathStatistics.errorPixelCount, 1u);
+}
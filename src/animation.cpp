@@ -0,0 +1,136 @@
+#include "animation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <numbers>
+
+namespace {
+    const float SMALL_SPHERE_RADIUS = 0.5f;
+    const float BOUNCE_HEIGHT = 0.4f;
+    const float BOUNCES_PER_ORBIT = 2.0f;
+
+    // Rodrigues' rotation of the offset from the look at point, the up vector stays the same
+    Camera rotateAroundLookAt(const Camera &camera, float angle) {
+        const glm::vec3 axis = glm::normalize(camera.up);
+        const glm::vec3 offset = camera.lookFrom - camera.lookAt;
+
+        Camera rotatedCamera = camera;
+        rotatedCamera.lookFrom = camera.lookAt + offset * std::cos(angle) + glm::cross(axis, offset) * std::sin(angle) +
+                                 axis * glm::dot(axis, offset) * (1.0f - std::cos(angle));
+
+        return rotatedCamera;
+    }
+}
+
+AnimationResult renderAnimation(Vulkan &vulkan, const AnimationSettings &settings, const Animation &animation) {
+    const std::filesystem::path outputDirectory = std::filesystem::path(settings.outputPrefix).parent_path();
+    if (!outputDirectory.empty()) {
+        std::filesystem::create_directories(outputDirectory);
+    }
+
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    // deferred: evaluated by get(), after the previous frame has been finished
+    const std::launch launchPolicy = settings.overlap ? std::launch::async : std::launch::deferred;
+    std::future<AnimationFrame> nextFrame = std::async(launchPolicy, [&animation] { return animation(0); });
+
+    for (uint32_t frame = 0; frame < settings.frameCount; frame++) {
+        const AnimationFrame animationFrame = nextFrame.get();
+
+        if (frame + 1 < settings.frameCount) {
+            nextFrame = std::async(launchPolicy, [&animation, frame] { return animation(frame + 1); });
+        }
+
+        // only staged, the render calls of the previous frame may still be executing
+        vulkan.setCamera(animationFrame.camera);
+        vulkan.updateSpheres(animationFrame.firstSphere, animationFrame.spheres);
+        vulkan.restartAccumulation();
+
+        for (uint32_t number = 1; number <= settings.renderCallsPerFrame; number++) {
+            vulkan.render(
+                    {
+                            .number = number,
+                            .totalRenderCalls = settings.renderCallsPerFrame,
+                            .totalSamples = settings.samplesPerFrame
+                    });
+        }
+
+        vulkan.update();
+
+        // the next frame waits for the copy of the render target, but not for the encoding
+        const std::shared_future<void> screenshot = vulkan.saveScreenshotAsync(getAnimationFramePath(settings, frame));
+
+        if (!settings.overlap) {
+            vulkan.waitIdle();
+            screenshot.wait();
+        }
+    }
+
+    vulkan.waitForScreenshots();
+
+    const double timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+
+    return {
+            .frameCount = settings.frameCount,
+            .timeMs = timeMs,
+            .framesPerHour = timeMs > 0.0 ? double(settings.frameCount) * 3600000.0 / timeMs : 0.0
+    };
+}
+
+std::string getAnimationFramePath(const AnimationSettings &settings, uint32_t frame) {
+    const uint32_t digits = 5;
+    std::string number = std::to_string(frame);
+
+    if (number.size() < digits) {
+        number.insert(0, digits - number.size(), '0');
+    }
+
+    return settings.outputPrefix + number + settings.extension;
+}
+
+std::vector<Camera> createOrbitCameras(const Camera &camera, uint32_t count) {
+    std::vector<Camera> cameras;
+
+    for (uint32_t i = 0; i < count; i++) {
+        cameras.push_back(rotateAroundLookAt(camera, float(i) / float(count) * 2.0f * std::numbers::pi_v<float>));
+    }
+
+    return cameras;
+}
+
+Animation createOrbitAnimation(const Scene &scene, uint32_t frameCount) {
+    const auto isSmall = [](const Sphere &sphere) { return sphere.radius < SMALL_SPHERE_RADIUS; };
+    const auto firstSmall = std::find_if(scene.spheres.begin(), scene.spheres.end(), isSmall);
+    const auto lastSmall = std::find_if(scene.spheres.rbegin(), scene.spheres.rend(), isSmall);
+
+    // the spheres in between that aren't small are part of the update as well, but stay where they are
+    const uint32_t firstSphere = static_cast<uint32_t>(firstSmall - scene.spheres.begin());
+    const std::vector<Sphere> spheres(firstSmall, firstSmall == scene.spheres.end() ? firstSmall : lastSmall.base());
+
+    return [camera = scene.camera, firstSphere, spheres, frameCount](uint32_t frame) {
+        const float time = float(frame) / float(std::max(frameCount, 1u));
+
+        AnimationFrame animationFrame = {
+                .camera = rotateAroundLookAt(camera, time * 2.0f * std::numbers::pi_v<float>),
+                .firstSphere = firstSphere,
+                .spheres = spheres
+        };
+
+        const glm::vec3 axis = glm::normalize(camera.up);
+
+        for (size_t i = 0; i < animationFrame.spheres.size(); i++) {
+            Sphere &sphere = animationFrame.spheres[i];
+            if (sphere.radius >= SMALL_SPHERE_RADIUS)
+                continue;
+
+            // golden ratio: the phases of neighbouring spheres are spread evenly
+            const float phase = std::fmod(float(i) * 0.618034f, 1.0f);
+            const float bounce = std::abs(std::sin((time * BOUNCES_PER_ORBIT + phase) * std::numbers::pi_v<float>));
+            sphere.center += axis * BOUNCE_HEIGHT * bounce;
+        }
+
+        return animationFrame;
+    };
+}
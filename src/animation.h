@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "scene.h"
+#include "vulkan.h"
+
+// the changes of a frame, the spheres replace the ones starting at firstSphere (see Vulkan::updateSpheres)
+struct AnimationFrame {
+    Camera camera;
+    uint32_t firstSphere;
+    std::vector<Sphere> spheres;
+};
+
+// evaluated on another thread while the previous frame is traced, so it must not touch the renderer
+using Animation = std::function<AnimationFrame(uint32_t frame)>;
+
+struct AnimationSettings {
+    uint32_t frameCount = 120;
+    uint32_t renderCallsPerFrame = 4;
+    uint32_t samplesPerFrame = 64;
+    std::string outputPrefix = "frames/frame_"; // followed by the zero padded frame number and the extension
+    std::string extension = ".png"; // ".qoi" encodes much faster
+    // false: every frame is finished and written before the next one is updated, to measure the gain of overlapping
+    bool overlap = true;
+};
+
+struct AnimationResult {
+    uint32_t frameCount;
+    double timeMs; // from the first update until the last frame has been written
+    double framesPerHour;
+};
+
+
+// Renders every frame into its own numbered image, reusing the instance, the pipelines and the buffers. While the GPU
+// traces frame N, the host evaluates the animation for frame N + 1 and encodes frame N - 1. The staged sphere updates
+// of a frame are copied by its first render call, ordered after the render calls of the previous frame.
+AnimationResult renderAnimation(Vulkan &vulkan, const AnimationSettings &settings, const Animation &animation);
+
+// e.g. frames/frame_00042.png
+std::string getAnimationFramePath(const AnimationSettings &settings, uint32_t frame);
+
+// count cameras evenly spread on the circle the camera describes around the up axis through the look at point, starting
+// with the camera itself, e.g. the views of a turntable for VulkanSettings::viewCount
+std::vector<Camera> createOrbitCameras(const Camera &camera, uint32_t count);
+
+// The camera circles the look at point once, around the up axis. The small spheres (of generated scenes, or any other
+// sphere with a radius below 0.5) bounce twice with their own phase, only the range of them is updated every frame.
+Animation createOrbitAnimation(const Scene &scene, uint32_t frameCount);
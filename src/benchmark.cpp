@@ -0,0 +1,1354 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include "vulkan.h"
+#include "image_encoder.h"
+#include "cpu_renderer.h"
+#include "scene_file.h"
+#include "animation.h"
+#include "json.h"
+
+// every configuration uses a scene generated with the same seed, so results are comparable between runs
+const uint32_t SCENE_SEED = 42;
+
+struct BenchmarkConfiguration {
+    uint32_t width, height;
+    uint32_t samplesPerCall;
+    uint32_t renderCalls;
+    int gridSize;
+    uint32_t maxDepth;
+    uint32_t groupSizeX, groupSizeY;
+    bool useBvh;
+    bool specialized; // false: the generic shader variant
+    bool diffuseOnly; // replaces all materials of the scene by diffuse ones
+    bool wavefront; // RenderMode::WAVEFRONT instead of the megakernel
+    bool russianRoulette;
+    bool adaptiveSampling;
+    bool tiled;
+    bool progressive;
+    bool snapshots; // reads the render target back after every render call
+    bool hostVisibleScene; // the shader reads the scene from host-visible instead of device-local memory
+    bool sceneUpdates; // moves 1 % of the spheres before every render call
+
+    [[nodiscard]] std::string getName() const {
+        std::stringstream name;
+        name << width << "x" << height << "/spp" << samplesPerCall << "/grid" << gridSize << "/depth" << maxDepth
+             << "/group" << groupSizeX << "x" << groupSizeY << (useBvh ? "/bvh" : "/linear")
+             << (diffuseOnly ? "/diffuse" : "") << (specialized ? "" : "/generic")
+             << (wavefront ? "/wavefront" : "") << (russianRoulette ? "/rr" : "")
+             << (adaptiveSampling ? "/adaptive" : "") << (tiled ? "/tiled" : "") << (progressive ? "/progressive" : "")
+             << (snapshots ? "/snapshots" : "") << (hostVisibleScene ? "/hostscene" : "")
+             << (sceneUpdates ? "/updates" : "");
+        return name.str();
+    }
+};
+
+struct BenchmarkResult {
+    BenchmarkConfiguration configuration;
+    size_t sphereAmount;
+    double wallTimeMs;
+    double gpuTimeMs;
+    double primaryRaysPerSecond; // based on the GPU time
+    double averagePathLength; // bounces per sample
+    double sampledPixelFraction; // below 1 with adaptive sampling
+    double maxSubmissionGpuTimeMs; // longest frame, a render call is split into several ones with tiled rendering
+    double estimatedError; // of the last render call, only in the progressive mode
+    double sceneUpdateTimeMs; // host time per render call to stage the scene updates
+    vk::DeviceSize deviceMemory;
+
+    [[nodiscard]] std::string getName() const {
+        return configuration.getName();
+    }
+};
+
+// screenshot encoding, without a device
+struct EncodeBenchmarkResult {
+    uint32_t width, height;
+    std::string format; // "png" followed by the compression level, or "qoi"
+    uint32_t threads;
+    double timeMs;
+    double megaBytesPerSecond; // of raw RGBA pixels
+    uintmax_t fileSize;
+    double speedup; // over a single thread
+
+    [[nodiscard]] std::string getName() const {
+        std::stringstream name;
+        name << "encode/" << width << "x" << height << "/" << format << "/threads" << threads;
+        return name.str();
+    }
+};
+
+// the CPU reference renderer, without a device
+struct CpuBenchmarkResult {
+    uint32_t width, height;
+    int gridSize;
+    bool useBvh;
+    bool simd; // AVX2 was requested and is supported
+    uint32_t threads;
+    double timeMs;
+    double raysPerSecond; // all rays of the paths, not only the primary ones
+    double raysPerSecondPerThread;
+    double speedup; // of AVX2 over the scalar code
+
+    [[nodiscard]] std::string getName() const {
+        std::stringstream name;
+        name << "cpu/" << width << "x" << height << "/grid" << gridSize << (useBvh ? "/bvh" : "/linear")
+             << (simd ? "/avx2" : "/scalar") << "/threads" << threads;
+        return name.str();
+    }
+};
+
+// writing and loading scene files, without a device
+struct SceneLoadBenchmarkResult {
+    size_t sphereAmount;
+    double generateTimeMs; // generating the scene and building its BVH, which loading a scene file replaces
+    double writeTimeMs; // building the BVH again and writing the file
+    double loadTimeMs; // mapping and checking the file and copying its arrays into buffer memory
+    double megaBytesPerSecond; // of the file while loading
+    uintmax_t fileSize;
+
+    [[nodiscard]] std::string getName() const {
+        return "scene/spheres" + std::to_string(sphereAmount);
+    }
+};
+
+// constructing a renderer and its first render call, without and with the pipeline cache of the previous run
+struct StartupBenchmarkResult {
+    RenderMode renderMode;
+    bool warm; // the pipeline cache of the cold start was loaded
+    StartupTimings timings; // including the pipeline variant created by the first render call
+    double totalMs; // until the first render call has been submitted
+    double speedup; // of the warm start over the cold one
+
+    [[nodiscard]] std::string getName() const {
+        return std::string("startup/") + (renderMode == RenderMode::WAVEFRONT ? "wavefront" : "megakernel") +
+               (warm ? "/warm" : "/cold");
+    }
+};
+
+// a fixed orbit around the default scene, every frame written to its own image
+struct AnimationBenchmarkResult {
+    bool overlapped; // the tracing of a frame overlaps the update of the next and the encoding of the previous one
+    uint32_t frameCount;
+    uint32_t width, height;
+    uint32_t samplesPerFrame;
+    double timeMs;
+    double framesPerHour;
+    double speedup; // of overlapping the frames over rendering them one after the other
+
+    [[nodiscard]] std::string getName() const {
+        return "animation/" + std::to_string(width) + "x" + std::to_string(height) + "/spp" +
+               std::to_string(samplesPerFrame) + (overlapped ? "/overlapped" : "/serial");
+    }
+};
+
+// the views of a turntable, traced by a single dispatch into the layers of the render target, or one after the other
+struct MultiViewBenchmarkResult {
+    uint32_t viewCount;
+    uint32_t width, height; // per view
+    uint32_t samples; // per pixel and view
+    bool batched;
+    double timeMs; // for all views, until the last one has been read back
+    double viewsPerSecond;
+    double speedup; // of batching the views over rendering them separately
+
+    [[nodiscard]] std::string getName() const {
+        return "multiview/" + std::to_string(width) + "x" + std::to_string(height) + "/views" +
+               std::to_string(viewCount) + (batched ? "/batched" : "/separate");
+    }
+};
+
+struct BenchmarkOptions {
+    std::string outputFile = "benchmark.json";
+    std::string baselineFile;
+    std::string physicalDeviceName;
+    double regressionThreshold = 0.1;
+    bool quick = false;
+};
+
+
+// Sets the speedup of every result to its throughput relative to the one of its reference, the result with the name
+// getReference returns for it. References compare against themselves, results without a reference keep 0.
+template<typename Result>
+void setSpeedups(std::vector<Result> &results, const std::function<Result(Result)> &getReference,
+                 const std::function<double(const Result &)> &getThroughput) {
+    std::map<std::string, double> throughputs;
+    for (const Result &result: results) {
+        throughputs[result.getName()] = getThroughput(result);
+    }
+
+    for (Result &result: results) {
+        const auto reference = throughputs.find(getReference(result).getName());
+        if (reference != throughputs.end()) {
+            result.speedup = getThroughput(result) / reference->second;
+        }
+    }
+}
+
+// one factor at a time: every axis is swept while all other parameters keep the values of the base configuration
+std::vector<BenchmarkConfiguration> getConfigurations(bool quick) {
+    const BenchmarkConfiguration base = {
+            .width = quick ? 640u : 1280u,
+            .height = quick ? 360u : 720u,
+            .samplesPerCall = 4,
+            .renderCalls = quick ? 3u : 10u,
+            .gridSize = 11,
+            .maxDepth = 50,
+            .groupSizeX = 16,
+            .groupSizeY = 8,
+            .useBvh = true,
+            .specialized = true,
+            .diffuseOnly = false,
+            .wavefront = false,
+            .russianRoulette = false,
+            .adaptiveSampling = false,
+            .tiled = false,
+            .progressive = false,
+            .snapshots = false,
+            .hostVisibleScene = false,
+            .sceneUpdates = false
+    };
+
+    std::vector<BenchmarkConfiguration> configurations;
+
+    const std::vector<std::pair<uint32_t, uint32_t>> resolutions = quick
+            ? std::vector<std::pair<uint32_t, uint32_t>>{{320, 180}, {640, 360}}
+            : std::vector<std::pair<uint32_t, uint32_t>>{{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+
+    for (const auto &[width, height]: resolutions) {
+        BenchmarkConfiguration configuration = base;
+        configuration.width = width;
+        configuration.height = height;
+        configurations.push_back(configuration);
+    }
+
+    for (uint32_t samplesPerCall: {1u, 4u, 16u}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.samplesPerCall = samplesPerCall;
+        configurations.push_back(configuration);
+    }
+
+    for (int gridSize: quick ? std::vector<int>{2, 11, 32} : std::vector<int>{2, 11, 32, 100}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.gridSize = gridSize;
+        configurations.push_back(configuration);
+
+        // the linear loop gets too slow for bigger scenes
+        if (gridSize <= 11) {
+            configuration.useBvh = false;
+            configurations.push_back(configuration);
+        }
+    }
+
+    for (uint32_t maxDepth: {5u, 10u, 50u}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.maxDepth = maxDepth;
+        configurations.push_back(configuration);
+    }
+
+    for (const auto &[groupSizeX, groupSizeY]: std::vector<std::pair<uint32_t, uint32_t>>{
+            {8, 8}, {16, 8}, {16, 16}, {32, 4}, {64, 1}}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.groupSizeX = groupSizeX;
+        configuration.groupSizeY = groupSizeY;
+        configurations.push_back(configuration);
+    }
+
+    // the wavefront path tracer is compared against the megakernel, with mixed materials and without divergence
+    for (bool diffuseOnly: {false, true}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.diffuseOnly = diffuseOnly;
+        configuration.wavefront = true;
+        configurations.push_back(configuration);
+
+        configuration.wavefront = false;
+        configurations.push_back(configuration);
+    }
+
+    // Russian roulette is compared against always tracing up to the maximum depth
+    for (uint32_t maxDepth: {10u, 50u}) {
+        for (bool wavefront: {false, true}) {
+            for (bool russianRoulette: {false, true}) {
+                BenchmarkConfiguration configuration = base;
+                configuration.maxDepth = maxDepth;
+                configuration.wavefront = wavefront;
+                configuration.russianRoulette = russianRoulette;
+                configurations.push_back(configuration);
+            }
+        }
+    }
+
+    // adaptive sampling is compared against sampling every pixel, at enough samples for pixels to converge
+    for (uint32_t samplesPerCall: {4u, 16u}) {
+        for (bool adaptiveSampling: {false, true}) {
+            BenchmarkConfiguration configuration = base;
+            configuration.samplesPerCall = samplesPerCall;
+            configuration.adaptiveSampling = adaptiveSampling;
+            configurations.push_back(configuration);
+        }
+    }
+
+    // tiled rendering is compared against a single dispatch per render call, also at the highest resolution
+    for (const auto &[width, height]: std::vector<std::pair<uint32_t, uint32_t>>{
+            {base.width, base.height}, resolutions.back()}) {
+        for (bool tiled: {false, true}) {
+            BenchmarkConfiguration configuration = base;
+            configuration.width = width;
+            configuration.height = height;
+            configuration.tiled = tiled;
+            configurations.push_back(configuration);
+        }
+    }
+
+    // the float accumulation of the progressive mode is compared against the normalized summed pixel color image
+    for (uint32_t samplesPerCall: {4u, 16u}) {
+        for (bool progressive: {false, true}) {
+            BenchmarkConfiguration configuration = base;
+            configuration.samplesPerCall = samplesPerCall;
+            configuration.progressive = progressive;
+            configurations.push_back(configuration);
+        }
+    }
+
+    // the throughput with a screenshot readback after every render call is compared against none
+    for (bool snapshots: {false, true}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.snapshots = snapshots;
+        configurations.push_back(configuration);
+    }
+
+    // device-local scene memory is compared against host-visible memory, and against updating the scene every call
+    for (int gridSize: quick ? std::vector<int>{11, 32} : std::vector<int>{11, 100}) {
+        BenchmarkConfiguration configuration = base;
+        configuration.gridSize = gridSize;
+        configurations.push_back(configuration);
+
+        configuration.sceneUpdates = true;
+        configurations.push_back(configuration);
+
+        configuration.sceneUpdates = false;
+        configuration.hostVisibleScene = true;
+        configurations.push_back(configuration);
+    }
+
+    // every shader variant is compared against the generic one
+    for (uint32_t samplesPerCall: {1u, 4u, 16u}) {
+        for (bool diffuseOnly: {false, true}) {
+            for (bool specialized: {true, false}) {
+                BenchmarkConfiguration configuration = base;
+                configuration.samplesPerCall = samplesPerCall;
+                configuration.diffuseOnly = diffuseOnly;
+                configuration.specialized = specialized;
+                configurations.push_back(configuration);
+            }
+        }
+    }
+
+    // the base configuration is part of every sweep
+    std::set<std::string> names;
+    std::erase_if(configurations, [&](const BenchmarkConfiguration &configuration) {
+        return !names.insert(configuration.getName()).second;
+    });
+
+    return configurations;
+}
+
+BenchmarkResult runBenchmark(const BenchmarkConfiguration &configuration, const BenchmarkOptions &options,
+                             std::string &deviceName) {
+    VulkanSettings settings = {
+            .windowWidth = configuration.width,
+            .windowHeight = configuration.height,
+            .computeShaderFile = "shader.comp.spv",
+            .computeShaderGroupSizeX = configuration.groupSizeX,
+            .computeShaderGroupSizeY = configuration.groupSizeY,
+            .headless = true,
+            .physicalDeviceName = options.physicalDeviceName,
+            .maxDepth = configuration.maxDepth,
+            .useBvh = configuration.useBvh,
+            .deviceLocalScene = !configuration.hostVisibleScene,
+            .specializeShader = configuration.specialized,
+            .russianRoulette = configuration.russianRoulette,
+            .collectPathStatistics = true,
+            .adaptiveSampling = configuration.adaptiveSampling,
+            .tiledRendering = configuration.tiled,
+            .progressive = configuration.progressive,
+            .renderMode = configuration.wavefront ? RenderMode::WAVEFRONT : RenderMode::MEGAKERNEL
+    };
+
+    Scene scene = generateRandomScene(configuration.gridSize, SCENE_SEED);
+
+    if (configuration.diffuseOnly) {
+        for (Material &material: scene.materials) {
+            material.type = MaterialType::DIFFUSE;
+        }
+    }
+
+    const size_t sphereAmount = scene.spheres.size();
+
+    Vulkan vulkan(settings, scene);
+    deviceName = vulkan.getDeviceName();
+
+    // the first render call is a warm-up and not measured
+    const uint32_t totalRenderCalls = configuration.renderCalls + 1;
+    RenderCallInfo renderCallInfo = {
+            .number = 1,
+            .totalRenderCalls = totalRenderCalls,
+            .totalSamples = totalRenderCalls * configuration.samplesPerCall
+    };
+
+    vulkan.render(renderCallInfo);
+    vulkan.waitIdle();
+
+    // a different range of spheres moves up and down in every render call, like an animated part of the scene
+    std::vector<Sphere> spheres = scene.spheres;
+    const size_t updatedSphereCount = std::max(spheres.size() / 100, size_t(1));
+    double sceneUpdateTimeMs = 0.0;
+
+    auto beginTime = std::chrono::steady_clock::now();
+
+    for (uint32_t number = 2; number <= totalRenderCalls; number++) {
+        if (configuration.sceneUpdates) {
+            const size_t firstSphere = (number * updatedSphereCount) % (spheres.size() - updatedSphereCount + 1);
+            const std::span<Sphere> updatedSpheres(spheres.data() + firstSphere, updatedSphereCount);
+
+            for (Sphere &sphere: updatedSpheres) {
+                sphere.center.y += (number % 2 == 0 ? 0.1f : -0.1f) * sphere.radius;
+            }
+
+            const auto updateBeginTime = std::chrono::steady_clock::now();
+            vulkan.updateSpheres(static_cast<uint32_t>(firstSphere), updatedSpheres);
+            sceneUpdateTimeMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - updateBeginTime).count();
+        }
+
+        renderCallInfo.number = number;
+        vulkan.render(renderCallInfo);
+
+        // only the copy is measured, not the image encoding
+        if (configuration.snapshots) {
+            vulkan.readScreenshotAsync([](const uint8_t*, uint32_t, uint32_t, uint32_t) {});
+        }
+    }
+
+    vulkan.waitIdle();
+    vulkan.waitForScreenshots();
+
+    const double wallTimeMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - beginTime).count();
+
+    double gpuTimeMs = 0.0, pathLengthSum = 0.0, sampledPixelFractionSum = 0.0, maxSubmissionGpuTimeMs = 0.0;
+    for (const RenderCallTiming &timing: vulkan.getRenderCallTimings()) {
+        if (timing.number > 1) {
+            gpuTimeMs += timing.gpuTimeMs;
+            pathLengthSum += timing.averagePathLength * timing.sampledPixelFraction;
+            sampledPixelFractionSum += timing.sampledPixelFraction;
+            maxSubmissionGpuTimeMs = std::max(maxSubmissionGpuTimeMs, timing.gpuTimeMs);
+        }
+    }
+
+    // devices without timestamp support only have the wall time
+    const double measuredTimeMs = gpuTimeMs > 0.0 ? gpuTimeMs : wallTimeMs;
+    const double primaryRays = double(configuration.width) * double(configuration.height) *
+                               double(configuration.renderCalls * configuration.samplesPerCall);
+
+    return {
+            .configuration = configuration,
+            .sphereAmount = sphereAmount,
+            .wallTimeMs = wallTimeMs,
+            .gpuTimeMs = gpuTimeMs,
+            .primaryRaysPerSecond = primaryRays / (measuredTimeMs / 1000.0),
+            .averagePathLength = pathLengthSum / sampledPixelFractionSum,
+            .sampledPixelFraction = sampledPixelFractionSum / double(configuration.renderCalls),
+            .maxSubmissionGpuTimeMs = maxSubmissionGpuTimeMs,
+            .estimatedError = vulkan.getRenderCallTimings().back().estimatedError,
+            .sceneUpdateTimeMs = sceneUpdateTimeMs / double(configuration.renderCalls),
+            .deviceMemory = vulkan.getAllocatedDeviceMemory()
+    };
+}
+
+// a gradient with noise and flat areas, as rendered images are neither pure noise nor uniform
+std::vector<uint8_t> generateEncodeBenchmarkImage(uint32_t width, uint32_t height) {
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+            const uint32_t noise = (x * 73856093u ^ y * 19349663u ^ SCENE_SEED) * 2654435761u >> 28;
+            const bool isFlat = (x * 8 / width + y * 8 / height) % 3 == 0;
+
+            pixel[0] = isFlat ? 20 : static_cast<uint8_t>(x * 255 / width + noise);
+            pixel[1] = isFlat ? 40 : static_cast<uint8_t>(y * 255 / height + noise / 2);
+            pixel[2] = isFlat ? 60 : static_cast<uint8_t>((x + y) * 255 / (width + height));
+            pixel[3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
+// every format with all hardware threads and with a single one, like the screenshots of the renderer
+std::vector<EncodeBenchmarkResult> runEncodeBenchmarks(bool quick) {
+    const std::vector<std::pair<uint32_t, uint32_t>> resolutions = quick
+            ? std::vector<std::pair<uint32_t, uint32_t>>{{1920, 1080}}
+            : std::vector<std::pair<uint32_t, uint32_t>>{{1920, 1080}, {3840, 2160}, {7680, 4320}};
+
+    const std::vector<std::string> formats = {"png0", "png1", "png6", "qoi"};
+
+    std::vector<EncodeBenchmarkResult> results;
+
+    for (const auto &[width, height]: resolutions) {
+        const std::vector<uint8_t> pixels = generateEncodeBenchmarkImage(width, height);
+
+        for (uint32_t threadCount: {0u, 1u}) {
+            ImageEncoder encoder(threadCount);
+
+            for (const std::string &format: formats) {
+                const bool isQoi = format == "qoi";
+                const std::string path = isQoi ? "encode_benchmark.qoi" : "encode_benchmark.png";
+                const uint32_t compressionLevel = isQoi ? 0 : std::stoul(format.substr(3));
+
+                const auto beginTime = std::chrono::steady_clock::now();
+                encoder.write(path, pixels.data(), width, height, compressionLevel);
+                const double timeMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - beginTime).count();
+
+                results.push_back(
+                        {
+                                .width = width,
+                                .height = height,
+                                .format = format,
+                                .threads = encoder.getThreadCount(),
+                                .timeMs = timeMs,
+                                .megaBytesPerSecond = double(pixels.size()) / 1e6 / (timeMs / 1000.0),
+                                .fileSize = std::filesystem::file_size(path)
+                        });
+
+                std::filesystem::remove(path);
+            }
+        }
+    }
+
+    setSpeedups<EncodeBenchmarkResult>(results, [](EncodeBenchmarkResult result) {
+        result.threads = 1;
+        return result;
+    }, [](const EncodeBenchmarkResult &result) { return result.megaBytesPerSecond; });
+
+    return results;
+}
+
+// with and without AVX2, on all hardware threads and on a single one
+std::vector<CpuBenchmarkResult> runCpuBenchmarks(bool quick) {
+    const uint32_t width = quick ? 160 : 320;
+    const uint32_t height = quick ? 90 : 180;
+    const uint32_t renderCalls = 2;
+    const uint32_t samplesPerCall = 4;
+
+    std::vector<CpuBenchmarkResult> results;
+
+    for (int gridSize: quick ? std::vector<int>{11} : std::vector<int>{11, 32}) {
+        const Scene scene = generateRandomScene(gridSize, SCENE_SEED);
+
+        for (bool useBvh: {true, false}) {
+            for (bool simd: {true, false}) {
+                for (uint32_t threadCount: {0u, 1u}) {
+                    VulkanSettings settings = {
+                            .windowWidth = width,
+                            .windowHeight = height,
+                            .headless = true,
+                            .useBvh = useBvh,
+                            .cpuThreads = threadCount,
+                            .cpuSimd = simd
+                    };
+
+                    CpuRenderer renderer(settings, scene);
+
+                    // without AVX2 support both variants would measure the scalar code
+                    if (simd && !renderer.usesAvx2())
+                        continue;
+
+                    for (uint32_t number = 1; number <= renderCalls; number++) {
+                        renderer.render(
+                                {
+                                        .number = number,
+                                        .totalRenderCalls = renderCalls,
+                                        .totalSamples = renderCalls * samplesPerCall
+                                });
+                    }
+
+                    double timeMs = 0.0, rays = 0.0;
+                    for (const RenderCallTiming &timing: renderer.getRenderCallTimings()) {
+                        timeMs += timing.gpuTimeMs;
+                        rays += double(width) * height * timing.samples * timing.averagePathLength;
+                    }
+
+                    const double raysPerSecond = rays / (timeMs / 1000.0);
+
+                    results.push_back(
+                            {
+                                    .width = width,
+                                    .height = height,
+                                    .gridSize = gridSize,
+                                    .useBvh = useBvh,
+                                    .simd = simd,
+                                    .threads = renderer.getThreadCount(),
+                                    .timeMs = timeMs,
+                                    .raysPerSecond = raysPerSecond,
+                                    .raysPerSecondPerThread = raysPerSecond / renderer.getThreadCount()
+                            });
+                }
+            }
+        }
+    }
+
+    setSpeedups<CpuBenchmarkResult>(results, [](CpuBenchmarkResult result) {
+        result.simd = false;
+        return result;
+    }, [](const CpuBenchmarkResult &result) { return result.raysPerSecond; });
+
+    return results;
+}
+
+// From 1K to 10M spheres. The copy into host memory stands in for the one into mapped buffer memory, the file is
+// still in the page cache from writing it, so this is the load time of a warm cache.
+std::vector<SceneLoadBenchmarkResult> runSceneLoadBenchmarks(bool quick) {
+    const std::string path = "scene_benchmark.rts";
+    std::vector<SceneLoadBenchmarkResult> results;
+
+    for (size_t sphereAmount = 1000; sphereAmount <= (quick ? 100000u : 10000000u); sphereAmount *= 10) {
+        auto beginTime = std::chrono::steady_clock::now();
+
+        Scene scene = generateSceneWithSpheres(sphereAmount, {.seed = SCENE_SEED});
+        buildBVH(scene.spheres);
+
+        const double generateTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - beginTime).count();
+
+        beginTime = std::chrono::steady_clock::now();
+        writeSceneFile(path, std::move(scene));
+        const double writeTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - beginTime).count();
+
+        const uintmax_t fileSize = std::filesystem::file_size(path);
+        std::vector<uint8_t> bufferMemory(fileSize);
+
+        beginTime = std::chrono::steady_clock::now();
+        {
+            const SceneFile sceneFile(path);
+            size_t offset = 0;
+
+            for (const std::span<const std::byte> array: {std::as_bytes(sceneFile.getSpheres()),
+                                                          std::as_bytes(sceneFile.getMaterials()),
+                                                          std::as_bytes(sceneFile.getBvhNodes())}) {
+                std::memcpy(bufferMemory.data() + offset, array.data(), array.size());
+                offset += array.size();
+            }
+        }
+        const double loadTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - beginTime).count();
+
+        results.push_back(
+                {
+                        .sphereAmount = sphereAmount,
+                        .generateTimeMs = generateTimeMs,
+                        .writeTimeMs = writeTimeMs,
+                        .loadTimeMs = loadTimeMs,
+                        .megaBytesPerSecond = double(fileSize) / 1e6 / (loadTimeMs / 1000.0),
+                        .fileSize = fileSize
+                });
+
+        std::filesystem::remove(path);
+    }
+
+    return results;
+}
+
+// the same startup twice, with a pipeline cache directory that is only used by the benchmark and is empty at first
+std::vector<StartupBenchmarkResult> runStartupBenchmarks(const BenchmarkOptions &options) {
+    const std::string pipelineCacheDirectory = "startup_benchmark_cache";
+    const Scene scene = generateRandomScene(11, SCENE_SEED);
+    std::vector<StartupBenchmarkResult> results;
+
+    for (RenderMode renderMode: {RenderMode::MEGAKERNEL, RenderMode::WAVEFRONT}) {
+        std::filesystem::remove_all(pipelineCacheDirectory);
+
+        for (bool warm: {false, true}) {
+            const VulkanSettings settings = {
+                    .windowWidth = 640,
+                    .windowHeight = 360,
+                    .computeShaderFile = "shader.comp.spv",
+                    .computeShaderGroupSizeX = 16,
+                    .computeShaderGroupSizeY = 8,
+                    .headless = true,
+                    .physicalDeviceName = options.physicalDeviceName,
+                    .renderMode = renderMode,
+                    .pipelineCacheDirectory = pipelineCacheDirectory
+            };
+
+            const auto beginTime = std::chrono::steady_clock::now();
+
+            Vulkan vulkan(settings, scene);
+            vulkan.render({.number = 1, .totalRenderCalls = 1, .totalSamples = 4});
+
+            const double totalMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - beginTime).count();
+
+            vulkan.waitIdle();
+
+            results.push_back(
+                    {
+                            .renderMode = renderMode,
+                            .warm = warm,
+                            .timings = vulkan.getStartupTimings(),
+                            .totalMs = totalMs
+                    });
+        }
+    }
+
+    std::filesystem::remove_all(pipelineCacheDirectory);
+
+    setSpeedups<StartupBenchmarkResult>(results, [](StartupBenchmarkResult result) {
+        result.warm = false;
+        return result;
+    }, [](const StartupBenchmarkResult &result) { return 1.0 / result.totalMs; });
+
+    return results;
+}
+
+// the same sequence with and without overlapping the frames, the images are deleted afterwards
+std::vector<AnimationBenchmarkResult> runAnimationBenchmarks(const BenchmarkOptions &options) {
+    const std::string outputDirectory = "animation_benchmark";
+    const Scene scene = generateRandomScene(11, SCENE_SEED);
+
+    const VulkanSettings settings = {
+            .windowWidth = 640,
+            .windowHeight = 360,
+            .computeShaderFile = "shader.comp.spv",
+            .computeShaderGroupSizeX = 16,
+            .computeShaderGroupSizeY = 8,
+            .headless = true,
+            .physicalDeviceName = options.physicalDeviceName
+    };
+
+    // one renderer for both runs, so neither of them includes the startup
+    Vulkan vulkan(settings, scene);
+    std::vector<AnimationBenchmarkResult> results;
+
+    for (bool overlap: {false, true}) {
+        const AnimationSettings animationSettings = {
+                .frameCount = options.quick ? 12u : 48u,
+                .renderCallsPerFrame = 4,
+                .samplesPerFrame = 16,
+                .outputPrefix = outputDirectory + "/frame_",
+                .overlap = overlap
+        };
+
+        const AnimationResult result = renderAnimation(vulkan, animationSettings,
+                                                       createOrbitAnimation(scene, animationSettings.frameCount));
+
+        results.push_back(
+                {
+                        .overlapped = overlap,
+                        .frameCount = result.frameCount,
+                        .width = settings.windowWidth,
+                        .height = settings.windowHeight,
+                        .samplesPerFrame = animationSettings.samplesPerFrame,
+                        .timeMs = result.timeMs,
+                        .framesPerHour = result.framesPerHour
+                });
+    }
+
+    std::filesystem::remove_all(outputDirectory);
+
+    setSpeedups<AnimationBenchmarkResult>(results, [](AnimationBenchmarkResult result) {
+        result.overlapped = false;
+        return result;
+    }, [](const AnimationBenchmarkResult &result) { return result.framesPerHour; });
+
+    return results;
+}
+
+// small views, where the fixed cost of every render call and readback and the idle GPU at the end of a small dispatch
+// weigh the most
+std::vector<MultiViewBenchmarkResult> runMultiViewBenchmarks(const BenchmarkOptions &options) {
+    const Scene scene = generateRandomScene(11, SCENE_SEED);
+    const uint32_t samples = 16;
+    const uint32_t rounds = options.quick ? 2 : 8; // every round renders all views once
+
+    std::vector<MultiViewBenchmarkResult> results;
+
+    for (uint32_t viewCount: options.quick ? std::vector<uint32_t>{8} : std::vector<uint32_t>{8, 32}) {
+        const std::vector<Camera> cameras = createOrbitCameras(scene.camera, viewCount);
+
+        for (bool batched: {false, true}) {
+            const VulkanSettings settings = {
+                    .windowWidth = 160,
+                    .windowHeight = 90,
+                    .computeShaderFile = "shader.comp.spv",
+                    .computeShaderGroupSizeX = 16,
+                    .computeShaderGroupSizeY = 8,
+                    .headless = true,
+                    .physicalDeviceName = options.physicalDeviceName,
+                    .viewCount = batched ? viewCount : 1
+            };
+
+            Vulkan vulkan(settings, scene);
+            const RenderCallInfo renderCallInfo = {.number = 1, .totalRenderCalls = 1, .totalSamples = samples};
+
+            // creates the pipeline variant outside of the measurement
+            vulkan.render(renderCallInfo);
+            vulkan.waitIdle();
+
+            const auto beginTime = std::chrono::steady_clock::now();
+
+            for (uint32_t round = 0; round < rounds; round++) {
+                if (batched) {
+                    vulkan.setCameras(cameras);
+                    vulkan.restartAccumulation();
+                    vulkan.render(renderCallInfo);
+                    vulkan.readScreenshotAsync([](const uint8_t*, uint32_t, uint32_t, uint32_t) {});
+                    continue;
+                }
+
+                for (const Camera &camera: cameras) {
+                    vulkan.setCamera(camera);
+                    vulkan.restartAccumulation();
+                    vulkan.render(renderCallInfo);
+                    vulkan.readScreenshotAsync([](const uint8_t*, uint32_t, uint32_t, uint32_t) {});
+                }
+            }
+
+            vulkan.waitIdle();
+            vulkan.waitForScreenshots();
+
+            const double timeMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - beginTime).count();
+
+            results.push_back(
+                    {
+                            .viewCount = viewCount,
+                            .width = settings.windowWidth,
+                            .height = settings.windowHeight,
+                            .samples = samples,
+                            .batched = batched,
+                            .timeMs = timeMs,
+                            .viewsPerSecond = double(viewCount) * rounds / (timeMs / 1000.0)
+                    });
+        }
+    }
+
+    setSpeedups<MultiViewBenchmarkResult>(results, [](MultiViewBenchmarkResult result) {
+        result.batched = false;
+        return result;
+    }, [](const MultiViewBenchmarkResult &result) { return result.viewsPerSecond; });
+
+    return results;
+}
+
+
+// A value of a result, written to the JSON results. Fields with a unit are printed as a column of the tables as well.
+template<typename Result>
+struct ResultField {
+    std::string key;
+    std::function<JsonValue(const Result &)> get;
+    std::string unit;
+    double scale = 1.0; // of the printed value, e.g. 1e-6 for Mrays/s
+};
+
+template<typename Result, typename T>
+ResultField<Result> getField(const std::string &key, T Result::* member, const std::string &unit = "",
+                             double scale = 1.0) {
+    return {
+            .key = key,
+            .get = [member](const Result &result) { return JsonValue(result.*member); },
+            .unit = unit,
+            .scale = scale
+    };
+}
+
+template<typename T>
+ResultField<BenchmarkResult> getConfigurationField(const std::string &key, T BenchmarkConfiguration::* member) {
+    return {
+            .key = key,
+            .get = [member](const BenchmarkResult &result) { return JsonValue(result.configuration.*member); }
+    };
+}
+
+const double MEBIBYTE = 1024.0 * 1024.0;
+
+std::vector<ResultField<BenchmarkResult>> getBenchmarkFields() {
+    return {
+            getConfigurationField("width", &BenchmarkConfiguration::width),
+            getConfigurationField("height", &BenchmarkConfiguration::height),
+            getConfigurationField("samplesPerCall", &BenchmarkConfiguration::samplesPerCall),
+            getConfigurationField("renderCalls", &BenchmarkConfiguration::renderCalls),
+            getField("spheres", &BenchmarkResult::sphereAmount),
+            getConfigurationField("maxDepth", &BenchmarkConfiguration::maxDepth),
+            getConfigurationField("groupSizeX", &BenchmarkConfiguration::groupSizeX),
+            getConfigurationField("groupSizeY", &BenchmarkConfiguration::groupSizeY),
+            getConfigurationField("useBvh", &BenchmarkConfiguration::useBvh),
+            getConfigurationField("specialized", &BenchmarkConfiguration::specialized),
+            getConfigurationField("diffuseOnly", &BenchmarkConfiguration::diffuseOnly),
+            getConfigurationField("wavefront", &BenchmarkConfiguration::wavefront),
+            getConfigurationField("russianRoulette", &BenchmarkConfiguration::russianRoulette),
+            getConfigurationField("adaptiveSampling", &BenchmarkConfiguration::adaptiveSampling),
+            getConfigurationField("tiled", &BenchmarkConfiguration::tiled),
+            getConfigurationField("progressive", &BenchmarkConfiguration::progressive),
+            getConfigurationField("snapshots", &BenchmarkConfiguration::snapshots),
+            getConfigurationField("hostVisibleScene", &BenchmarkConfiguration::hostVisibleScene),
+            getConfigurationField("sceneUpdates", &BenchmarkConfiguration::sceneUpdates),
+            getField("wallTimeMs", &BenchmarkResult::wallTimeMs),
+            getField("primaryRaysPerSecond", &BenchmarkResult::primaryRaysPerSecond, "Mrays/s", 1e-6),
+            getField("gpuTimeMs", &BenchmarkResult::gpuTimeMs, "ms GPU"),
+            getField("averagePathLength", &BenchmarkResult::averagePathLength, "bounces"),
+            getField("sampledPixelFraction", &BenchmarkResult::sampledPixelFraction),
+            getField("maxSubmissionGpuTimeMs", &BenchmarkResult::maxSubmissionGpuTimeMs),
+            getField("estimatedError", &BenchmarkResult::estimatedError),
+            getField("sceneUpdateTimeMs", &BenchmarkResult::sceneUpdateTimeMs),
+            getField("deviceMemoryBytes", &BenchmarkResult::deviceMemory, "MiB", 1.0 / MEBIBYTE)
+    };
+}
+
+std::vector<ResultField<EncodeBenchmarkResult>> getEncodeFields() {
+    return {
+            getField("width", &EncodeBenchmarkResult::width),
+            getField("height", &EncodeBenchmarkResult::height),
+            getField("format", &EncodeBenchmarkResult::format),
+            getField("threads", &EncodeBenchmarkResult::threads),
+            getField("timeMs", &EncodeBenchmarkResult::timeMs, "ms"),
+            getField("megaBytesPerSecond", &EncodeBenchmarkResult::megaBytesPerSecond, "MB/s"),
+            getField("fileSizeBytes", &EncodeBenchmarkResult::fileSize, "MiB", 1.0 / MEBIBYTE),
+            getField("speedup", &EncodeBenchmarkResult::speedup, "x")
+    };
+}
+
+std::vector<ResultField<CpuBenchmarkResult>> getCpuFields() {
+    return {
+            getField("width", &CpuBenchmarkResult::width),
+            getField("height", &CpuBenchmarkResult::height),
+            getField("gridSize", &CpuBenchmarkResult::gridSize),
+            getField("useBvh", &CpuBenchmarkResult::useBvh),
+            getField("simd", &CpuBenchmarkResult::simd),
+            getField("threads", &CpuBenchmarkResult::threads),
+            getField("timeMs", &CpuBenchmarkResult::timeMs),
+            getField("raysPerSecond", &CpuBenchmarkResult::raysPerSecond, "Mrays/s", 1e-6),
+            getField("raysPerSecondPerThread", &CpuBenchmarkResult::raysPerSecondPerThread, "Mrays/s per thread",
+                     1e-6),
+            getField("speedup", &CpuBenchmarkResult::speedup, "x")
+    };
+}
+
+std::vector<ResultField<SceneLoadBenchmarkResult>> getSceneLoadFields() {
+    return {
+            getField("spheres", &SceneLoadBenchmarkResult::sphereAmount),
+            getField("generateTimeMs", &SceneLoadBenchmarkResult::generateTimeMs),
+            getField("writeTimeMs", &SceneLoadBenchmarkResult::writeTimeMs),
+            getField("loadTimeMs", &SceneLoadBenchmarkResult::loadTimeMs, "ms"),
+            getField("megaBytesPerSecond", &SceneLoadBenchmarkResult::megaBytesPerSecond, "MB/s"),
+            getField("fileSizeBytes", &SceneLoadBenchmarkResult::fileSize, "MiB", 1.0 / MEBIBYTE),
+            {
+                    .key = "speedup", // of loading the file over generating the scene and building the BVH
+                    .get = [](const SceneLoadBenchmarkResult &result) {
+                        return JsonValue(result.generateTimeMs / result.loadTimeMs);
+                    },
+                    .unit = "x"
+            }
+    };
+}
+
+std::vector<ResultField<StartupBenchmarkResult>> getStartupFields() {
+    return {
+            {
+                    .key = "wavefront",
+                    .get = [](const StartupBenchmarkResult &result) {
+                        return JsonValue(result.renderMode == RenderMode::WAVEFRONT);
+                    }
+            },
+            {
+                    .key = "warmPipelineCache",
+                    .get = [](const StartupBenchmarkResult &result) {
+                        return JsonValue(result.timings.warmPipelineCache);
+                    }
+            },
+            getField("totalMs", &StartupBenchmarkResult::totalMs, "ms"),
+            getField("speedup", &StartupBenchmarkResult::speedup, "x"),
+            {
+                    .key = "phasesMs",
+                    .get = [](const StartupBenchmarkResult &result) {
+                        JsonValue::Object phases;
+                        for (const StartupPhaseTiming &phase: result.timings.phases) {
+                            phases.emplace_back(phase.name, phase.timeMs);
+                        }
+                        return JsonValue(std::move(phases));
+                    }
+            }
+    };
+}
+
+std::vector<ResultField<AnimationBenchmarkResult>> getAnimationFields() {
+    return {
+            getField("overlapped", &AnimationBenchmarkResult::overlapped),
+            getField("frames", &AnimationBenchmarkResult::frameCount),
+            getField("width", &AnimationBenchmarkResult::width),
+            getField("height", &AnimationBenchmarkResult::height),
+            getField("samplesPerFrame", &AnimationBenchmarkResult::samplesPerFrame),
+            getField("framesPerHour", &AnimationBenchmarkResult::framesPerHour, "frames/h"),
+            getField("timeMs", &AnimationBenchmarkResult::timeMs, "ms"),
+            getField("speedup", &AnimationBenchmarkResult::speedup, "x")
+    };
+}
+
+std::vector<ResultField<MultiViewBenchmarkResult>> getMultiViewFields() {
+    return {
+            getField("views", &MultiViewBenchmarkResult::viewCount),
+            getField("width", &MultiViewBenchmarkResult::width),
+            getField("height", &MultiViewBenchmarkResult::height),
+            getField("samples", &MultiViewBenchmarkResult::samples),
+            getField("batched", &MultiViewBenchmarkResult::batched),
+            getField("viewsPerSecond", &MultiViewBenchmarkResult::viewsPerSecond, "views/s"),
+            getField("timeMs", &MultiViewBenchmarkResult::timeMs, "ms"),
+            getField("speedup", &MultiViewBenchmarkResult::speedup, "x")
+    };
+}
+
+// one object per result, starting with its name
+template<typename Result>
+JsonValue toJson(const std::vector<Result> &results, const std::vector<ResultField<Result>> &fields) {
+    JsonValue::Array array;
+
+    for (const Result &result: results) {
+        JsonValue::Object object = {{"name", result.getName()}};
+
+        for (const ResultField<Result> &field: fields) {
+            object.emplace_back(field.key, field.get(result));
+        }
+
+        array.emplace_back(std::move(object));
+    }
+
+    return array;
+}
+
+void printName(const std::string &name) {
+    std::cout << std::left << std::setw(48) << name << std::right << std::flush;
+}
+
+void printColumn(double value, const std::string &unit) {
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << value << " " << unit;
+}
+
+template<typename Result>
+void printColumns(const Result &result, const std::vector<ResultField<Result>> &fields) {
+    for (const ResultField<Result> &field: fields) {
+        if (!field.unit.empty()) {
+            printColumn(field.get(result).asNumber() * field.scale, field.unit);
+        }
+    }
+}
+
+template<typename Result>
+void printTable(const std::string &title, const std::vector<Result> &results,
+                const std::vector<ResultField<Result>> &fields) {
+    std::cout << std::endl << title << std::endl;
+
+    for (const Result &result: results) {
+        printName(result.getName());
+        printColumns(result, fields);
+        std::cout << std::endl;
+    }
+}
+
+// A GPU result whose flag has the given value is compared against the same configuration with the flag toggled, by
+// the ratio of the metric (by default the throughput).
+struct Comparison {
+    std::string title;
+    bool BenchmarkConfiguration::* flag;
+    bool value = true;
+    double BenchmarkResult::* metric = &BenchmarkResult::primaryRaysPerSecond;
+};
+
+// a value that is only printed for the GPU results whose flag is set
+struct Detail {
+    std::string title;
+    bool BenchmarkConfiguration::* flag;
+    ResultField<BenchmarkResult> field;
+};
+
+std::vector<Comparison> getComparisons() {
+    return {
+            {.title = "Speedup of the specialized shader variants:", .flag = &BenchmarkConfiguration::specialized},
+            {.title = "Speedup of Russian roulette:", .flag = &BenchmarkConfiguration::russianRoulette},
+            {.title = "Speedup of adaptive sampling:", .flag = &BenchmarkConfiguration::adaptiveSampling},
+            {.title = "Speedup of tiled rendering:", .flag = &BenchmarkConfiguration::tiled},
+            {
+                    .title = "Longest submission of tiled rendering relative to a single dispatch per render call:",
+                    .flag = &BenchmarkConfiguration::tiled,
+                    .metric = &BenchmarkResult::maxSubmissionGpuTimeMs
+            },
+            {.title = "Speedup of the progressive mode:", .flag = &BenchmarkConfiguration::progressive},
+            {.title = "Speedup with screenshots during rendering:", .flag = &BenchmarkConfiguration::snapshots},
+            {.title = "Speedup of the wavefront path tracer:", .flag = &BenchmarkConfiguration::wavefront},
+            {
+                    .title = "Speedup of device-local scene memory:",
+                    .flag = &BenchmarkConfiguration::hostVisibleScene,
+                    .value = false
+            },
+            {
+                    .title = "Speedup with 1 % of the spheres updated before every render call:",
+                    .flag = &BenchmarkConfiguration::sceneUpdates
+            }
+    };
+}
+
+std::vector<Detail> getDetails() {
+    const VulkanSettings defaults = {};
+    std::stringstream adaptiveTitle, tiledTitle, progressiveTitle;
+
+    adaptiveTitle << "Samples saved by adaptive sampling (relative error of skipped pixels below "
+                  << defaults.adaptiveSamplingThreshold << "):";
+    tiledTitle << "Longest submission of tiled rendering (GPU time budget: " << defaults.tileTimeBudgetMs << " ms):";
+    progressiveTitle << "Estimated error after the last render call of the progressive mode (target: "
+                     << defaults.progressiveTargetError << "):";
+
+    return {
+            {
+                    .title = adaptiveTitle.str(),
+                    .flag = &BenchmarkConfiguration::adaptiveSampling,
+                    .field = {
+                            .key = "savedSamples",
+                            .get = [](const BenchmarkResult &result) {
+                                return JsonValue(1.0 - result.sampledPixelFraction);
+                            },
+                            .unit = "%",
+                            .scale = 100.0
+                    }
+            },
+            {
+                    .title = tiledTitle.str(),
+                    .flag = &BenchmarkConfiguration::tiled,
+                    .field = getField("maxSubmissionGpuTimeMs", &BenchmarkResult::maxSubmissionGpuTimeMs, "ms")
+            },
+            {
+                    .title = progressiveTitle.str(),
+                    .flag = &BenchmarkConfiguration::progressive,
+                    .field = getField("estimatedError", &BenchmarkResult::estimatedError, "RMS")
+            },
+            {
+                    .title = "Host time to stage the scene updates of a render call:",
+                    .flag = &BenchmarkConfiguration::sceneUpdates,
+                    .field = getField("sceneUpdateTimeMs", &BenchmarkResult::sceneUpdateTimeMs, "ms")
+            }
+    };
+}
+
+void printComparison(const Comparison &comparison, const std::vector<BenchmarkResult> &results) {
+    std::map<std::string, double> metrics;
+    for (const BenchmarkResult &result: results) {
+        metrics[result.getName()] = result.*comparison.metric;
+    }
+
+    bool hasPrintedTitle = false;
+
+    for (const BenchmarkResult &result: results) {
+        if (result.configuration.*comparison.flag != comparison.value)
+            continue;
+
+        BenchmarkConfiguration reference = result.configuration;
+        reference.*comparison.flag = !comparison.value;
+
+        const auto referenceMetric = metrics.find(reference.getName());
+        if (referenceMetric == metrics.end())
+            continue;
+
+        if (!hasPrintedTitle) {
+            std::cout << std::endl << comparison.title << std::endl;
+            hasPrintedTitle = true;
+        }
+
+        printName(result.getName());
+        printColumn(result.*comparison.metric / referenceMetric->second, "x");
+        std::cout << std::endl;
+    }
+}
+
+void printDetail(const Detail &detail, const std::vector<BenchmarkResult> &results) {
+    std::vector<BenchmarkResult> flaggedResults;
+    std::copy_if(results.begin(), results.end(), std::back_inserter(flaggedResults),
+                 [&](const BenchmarkResult &result) { return result.configuration.*detail.flag; });
+
+    if (!flaggedResults.empty()) {
+        printTable(detail.title, flaggedResults, {detail.field});
+    }
+}
+
+void writeResults(const std::string &path, const JsonValue &document) {
+    std::ofstream file(path);
+
+    if (!file.is_open())
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    // one result per line
+    document.write(file, 2);
+}
+
+// the throughput of every GPU result of a file written by writeResults, by name
+std::map<std::string, double> readBaseline(const std::string &path) {
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    const JsonValue document = JsonValue::parse(text.str());
+    if (document["results"].isNull())
+        throw std::runtime_error("[Error] The baseline '" + path + "' has no results!");
+
+    std::map<std::string, double> baseline;
+
+    for (const JsonValue &result: document["results"].asArray()) {
+        // results that couldn't be measured are written as null
+        if (result["primaryRaysPerSecond"].isNumber()) {
+            baseline[result["name"].asString()] = result["primaryRaysPerSecond"].asNumber();
+        }
+    }
+
+    return baseline;
+}
+
+BenchmarkOptions parseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.outputFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            options.baselineFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue) {
+            options.regressionThreshold = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--device") == 0 && hasValue) {
+            options.physicalDeviceName = argv[++i];
+        } else if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--output results.json] [--baseline baseline.json]"
+                      << " [--threshold 0.1] [--device name] [--quick]" << std::endl;
+            std::exit(2);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    const BenchmarkOptions options = parseOptions(argc, argv);
+    const std::vector<BenchmarkConfiguration> configurations = getConfigurations(options.quick);
+    const std::vector<ResultField<BenchmarkResult>> benchmarkFields = getBenchmarkFields();
+
+    std::map<std::string, double> baseline;
+    if (!options.baselineFile.empty()) {
+        baseline = readBaseline(options.baselineFile);
+    }
+
+    std::string deviceName;
+    std::vector<BenchmarkResult> results;
+    uint32_t regressions = 0;
+
+    for (const BenchmarkConfiguration &configuration: configurations) {
+        printName(configuration.getName());
+
+        const BenchmarkResult result = runBenchmark(configuration, options, deviceName);
+        results.push_back(result);
+        printColumns(result, benchmarkFields);
+
+        const auto baselineResult = baseline.find(configuration.getName());
+        if (baselineResult != baseline.end()) {
+            const double change = result.primaryRaysPerSecond / baselineResult->second - 1.0;
+            std::cout << std::showpos << std::setw(10) << change * 100.0 << " %" << std::noshowpos;
+
+            if (change < -options.regressionThreshold) {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+        }
+
+        std::cout << std::endl;
+    }
+
+    for (const Comparison &comparison: getComparisons()) {
+        printComparison(comparison, results);
+    }
+
+    for (const Detail &detail: getDetails()) {
+        printDetail(detail, results);
+    }
+
+    const std::vector<EncodeBenchmarkResult> encodeResults = runEncodeBenchmarks(options.quick);
+    printTable("Screenshot encoding (speedup over a single thread):", encodeResults, getEncodeFields());
+
+    const std::vector<CpuBenchmarkResult> cpuResults = runCpuBenchmarks(options.quick);
+    printTable("CPU reference renderer (speedup of AVX2):", cpuResults, getCpuFields());
+
+    const std::vector<SceneLoadBenchmarkResult> sceneLoadResults = runSceneLoadBenchmarks(options.quick);
+    printTable("Scene files (loading instead of generating the scene and building the BVH):", sceneLoadResults,
+               getSceneLoadFields());
+
+    const std::vector<StartupBenchmarkResult> startupResults = runStartupBenchmarks(options);
+    printTable("Startup until the first render call is submitted (cold: without a pipeline cache):", startupResults,
+               getStartupFields());
+
+    for (const StartupBenchmarkResult &result: startupResults) {
+        std::cout << result.getName() << ":";
+
+        for (const StartupPhaseTiming &phase: result.timings.phases) {
+            std::cout << " " << phase.name << " " << phase.timeMs << " ms" << (phase.concurrent ? " (concurrent)" : "")
+                      << ",";
+        }
+
+        std::cout << std::endl;
+    }
+
+    const std::vector<AnimationBenchmarkResult> animationResults = runAnimationBenchmarks(options);
+    printTable("Animation, frames per hour of a fixed sequence written to numbered images (serial: every frame is "
+               "finished before the next one is updated):", animationResults, getAnimationFields());
+
+    const std::vector<MultiViewBenchmarkResult> multiViewResults = runMultiViewBenchmarks(options);
+    printTable("Multiple views (separate: one render call and readback per view, batched: all views in one "
+               "dispatch):", multiViewResults, getMultiViewFields());
+
+    const JsonValue document = JsonValue::Object{
+            {"device", deviceName},
+            {"seed", SCENE_SEED},
+            {"results", toJson(results, benchmarkFields)},
+            {"encodeResults", toJson(encodeResults, getEncodeFields())},
+            {"cpuResults", toJson(cpuResults, getCpuFields())},
+            {"sceneLoadResults", toJson(sceneLoadResults, getSceneLoadFields())},
+            {"startupResults", toJson(startupResults, getStartupFields())},
+            {"animationResults", toJson(animationResults, getAnimationFields())},
+            {"multiViewResults", toJson(multiViewResults, getMultiViewFields())}
+    };
+
+    writeResults(options.outputFile, document);
+    std::cout << std::endl << "Results of " << deviceName << " written to " << options.outputFile << std::endl;
+
+    if (regressions > 0) {
+        std::cout << regressions << " configuration(s) regressed by more than "
+                  << options.regressionThreshold * 100.0 << " %" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "bvh.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+const uint32_t BIN_AMOUNT = 16;
+const uint32_t MAX_LEAF_SIZE = 4;
+const float TRAVERSAL_COST = 1.0f;
+const float INTERSECTION_COST = 1.0f;
+
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void grow(const glm::vec3 &point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const AABB &aabb) {
+        min = glm::min(min, aabb.min);
+        max = glm::max(max, aabb.max);
+    }
+
+    [[nodiscard]] float surfaceArea() const {
+        const glm::vec3 extent = max - min;
+        return extent.x < 0.0f ? 0.0f : 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+};
+
+struct Bin {
+    AABB bounds;
+    uint32_t sphereAmount = 0;
+};
+
+AABB getSphereBounds(const Sphere &sphere) {
+    return {
+            .min = sphere.center - glm::vec3(sphere.radius),
+            .max = sphere.center + glm::vec3(sphere.radius)
+    };
+}
+
+void buildNode(std::vector<BVHNode> &nodes, std::span<Sphere> spheres, uint32_t first, uint32_t amount,
+               uint32_t depth) {
+    const auto nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({});
+
+    AABB bounds, centroidBounds;
+    for (uint32_t i = first; i < first + amount; i++) {
+        bounds.grow(getSphereBounds(spheres[i]));
+        centroidBounds.grow(spheres[i].center);
+    }
+
+    nodes[nodeIndex].aabbMin = bounds.min;
+    nodes[nodeIndex].aabbMax = bounds.max;
+
+    const auto makeLeaf = [&]() {
+        nodes[nodeIndex].offset = first;
+        nodes[nodeIndex].sphereCount = amount;
+    };
+
+    if (amount <= 1 || depth + 1 >= BVH_MAX_DEPTH) {
+        makeLeaf();
+        return;
+    }
+
+    // evaluate all bin boundaries on all three axes and keep the one with the lowest SAH cost
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        const float scale = float(BIN_AMOUNT) / extent;
+        Bin bins[BIN_AMOUNT] = {};
+
+        for (uint32_t i = first; i < first + amount; i++) {
+            const auto binIndex = std::min(BIN_AMOUNT - 1, static_cast<uint32_t>(
+                    (spheres[i].center[axis] - centroidBounds.min[axis]) * scale));
+            bins[binIndex].bounds.grow(getSphereBounds(spheres[i]));
+            bins[binIndex].sphereAmount++;
+        }
+
+        float leftArea[BIN_AMOUNT - 1], rightArea[BIN_AMOUNT - 1];
+        uint32_t leftAmount[BIN_AMOUNT - 1], rightAmount[BIN_AMOUNT - 1];
+
+        AABB leftBounds, rightBounds;
+        uint32_t leftSum = 0, rightSum = 0;
+
+        for (uint32_t i = 0; i < BIN_AMOUNT - 1; i++) {
+            leftSum += bins[i].sphereAmount;
+            leftBounds.grow(bins[i].bounds);
+            leftAmount[i] = leftSum;
+            leftArea[i] = leftBounds.surfaceArea();
+
+            rightSum += bins[BIN_AMOUNT - 1 - i].sphereAmount;
+            rightBounds.grow(bins[BIN_AMOUNT - 1 - i].bounds);
+            rightAmount[BIN_AMOUNT - 2 - i] = rightSum;
+            rightArea[BIN_AMOUNT - 2 - i] = rightBounds.surfaceArea();
+        }
+
+        for (uint32_t i = 0; i < BIN_AMOUNT - 1; i++) {
+            if (leftAmount[i] == 0 || rightAmount[i] == 0)
+                continue;
+
+            const float cost = leftArea[i] * float(leftAmount[i]) + rightArea[i] * float(rightAmount[i]);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    const float parentArea = bounds.surfaceArea();
+    const float leafCost = INTERSECTION_COST * float(amount);
+    const float splitCost = TRAVERSAL_COST + INTERSECTION_COST * bestCost / std::max(parentArea, 1e-12f);
+
+    if (amount <= MAX_LEAF_SIZE && splitCost >= leafCost) {
+        makeLeaf();
+        return;
+    }
+
+    uint32_t leftAmount;
+
+    if (bestAxis >= 0) {
+        const float scale = float(BIN_AMOUNT) / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+
+        auto middle = std::partition(spheres.begin() + first, spheres.begin() + first + amount,
+                                     [&](const Sphere &sphere) {
+                                         const auto binIndex = std::min(BIN_AMOUNT - 1, static_cast<uint32_t>(
+                                                 (sphere.center[bestAxis] - centroidBounds.min[bestAxis]) * scale));
+                                         return binIndex <= bestSplit;
+                                     });
+
+        leftAmount = static_cast<uint32_t>(middle - (spheres.begin() + first));
+    } else {
+        // all centroids coincide, SAH can't separate them: fall back to an object median split
+        leftAmount = amount / 2;
+    }
+
+    buildNode(nodes, spheres, first, leftAmount, depth + 1);
+
+    nodes[nodeIndex].offset = static_cast<uint32_t>(nodes.size());
+    nodes[nodeIndex].sphereCount = 0;
+
+    buildNode(nodes, spheres, first + leftAmount, amount - leftAmount, depth + 1);
+}
+
+std::vector<BVHNode> buildBVH(std::span<Sphere> spheres) {
+    std::vector<BVHNode> nodes;
+
+    if (spheres.empty()) {
+        // a root node with inverted bounds, which every ray misses before traversal even starts
+        const AABB empty;
+        nodes.push_back({.aabbMin = empty.min, .offset = 0, .aabbMax = empty.max, .sphereCount = 0});
+        return nodes;
+    }
+
+    nodes.reserve(2 * spheres.size());
+    buildNode(nodes, spheres, 0, static_cast<uint32_t>(spheres.size()), 0);
+
+    return nodes;
+}
+
+void validateBVH(std::span<const BVHNode> nodes, size_t sphereCount) {
+    if (nodes.empty())
+        throw std::runtime_error("The BVH has no root node!");
+
+    // the root buildBVH creates for a scene without spheres has no children, its inverted bounds are never hit
+    const BVHNode &root = nodes[0];
+    if (nodes.size() == 1 && root.sphereCount == 0 &&
+        (root.aabbMin.x > root.aabbMax.x || root.aabbMin.y > root.aabbMax.y || root.aabbMin.z > root.aabbMax.z))
+        return;
+
+    struct StackEntry {
+        uint32_t node;
+        uint32_t depth; // 0 for the root
+    };
+
+    std::vector<bool> isVisited(nodes.size(), false);
+    std::vector<StackEntry> stack = {{.node = 0, .depth = 0}};
+    size_t visitedCount = 0;
+
+    while (!stack.empty()) {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+
+        // a second visit means a second parent, which includes every cycle
+        if (isVisited[entry.node])
+            throw std::runtime_error("BVH node " + std::to_string(entry.node) + " has more than one parent!");
+
+        if (entry.depth >= BVH_MAX_DEPTH)
+            throw std::runtime_error("BVH node " + std::to_string(entry.node) + " is deeper than " +
+                                     std::to_string(BVH_MAX_DEPTH) + " levels!");
+
+        isVisited[entry.node] = true;
+        visitedCount++;
+
+        const BVHNode &node = nodes[entry.node];
+
+        if (node.sphereCount > 0) {
+            if (uint64_t(node.offset) + node.sphereCount > sphereCount)
+                throw std::runtime_error("BVH node " + std::to_string(entry.node) + " references spheres " +
+                                         std::to_string(node.offset) + " to " +
+                                         std::to_string(uint64_t(node.offset) + node.sphereCount - 1) +
+                                         ", but the scene only has " + std::to_string(sphereCount) + "!");
+            continue;
+        }
+
+        if (uint64_t(entry.node) + 1 >= nodes.size() || node.offset >= nodes.size())
+            throw std::runtime_error("BVH node " + std::to_string(entry.node) + " references a child beyond the " +
+                                     std::to_string(nodes.size()) + " nodes!");
+
+        stack.push_back({.node = entry.node + 1, .depth = entry.depth + 1});
+        stack.push_back({.node = node.offset, .depth = entry.depth + 1});
+    }
+
+    if (visitedCount != nodes.size())
+        throw std::runtime_error(std::to_string(nodes.size() - visitedCount) +
+                                 " BVH nodes aren't reachable from the root!");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "scene.h"
+
+// the shader traverses the tree with a fixed size stack, so the builder never creates deeper trees than this
+const uint32_t BVH_MAX_DEPTH = 32;
+
+struct BVHNode {
+    alignas(16) glm::vec3 aabbMin;
+    alignas(4) uint32_t offset; // leaf: index of the first sphere, inner node: index of the second child
+    alignas(16) glm::vec3 aabbMax;
+    alignas(4) uint32_t sphereCount; // 0 for inner nodes, the first child always directly follows its parent
+};
+
+
+// Builds a binned SAH bounding volume hierarchy over the spheres. The spheres are reordered in place, so that every
+// leaf references a contiguous range of them. The nodes are returned flattened in depth-first order.
+std::vector<BVHNode> buildBVH(std::span<Sphere> spheres);
+
+// Checks nodes that weren't built by buildBVH, e.g. the ones of a scene file, in a single walk from the root: the
+// spheres of every leaf lie within sphereCount, the children of every inner node within the nodes, every node except
+// the root has exactly one parent and no node is deeper than BVH_MAX_DEPTH levels. A single root without children is
+// only accepted with the inverted bounds of an empty scene. Throws at the first violation.
+void validateBVH(std::span<const BVHNode> nodes, size_t sphereCount);
@@ -0,0 +1,500 @@
+#include "cpu_renderer.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "hdr_image.h"
+
+// the constant of common.glsl
+const float MAX_RAY_COLLISION_DISTANCE = 100000000.0f;
+
+CpuRenderer::CpuRenderer(VulkanSettings settings, Scene scene) :
+        settings(std::move(settings)), scene(std::move(scene)),
+        workStealingPool(this->settings.cpuThreads), imageEncoder(this->settings.encoderThreads) {
+    if (this->settings.adaptiveSampling || this->settings.progressive) {
+        throw std::runtime_error("The CPU renderer doesn't support adaptive sampling or the progressive mode!");
+    }
+
+    // reorders the spheres like the Vulkan renderer, so both test them in the same order
+    bvhNodes = buildBVH(this->scene.spheres);
+    sphereArrays = createSphereArrays(this->scene.spheres);
+
+    const NearestSphereFunction avx2Function = this->settings.cpuSimd ? getAvx2NearestSphereFunction() : nullptr;
+    nearestSphereFunction = avx2Function ? avx2Function : &findNearestSphere;
+    isAvx2Enabled = avx2Function != nullptr;
+
+    viewport = calculateViewport(float(this->settings.windowWidth) / float(this->settings.windowHeight));
+
+    const size_t pixelCount = size_t(this->settings.windowWidth) * this->settings.windowHeight;
+    summedPixelColors.resize(pixelCount, glm::vec3(0.0f));
+    pixels.resize(pixelCount * 4, 0);
+}
+
+CpuRenderer::~CpuRenderer() {
+    waitForScreenshots();
+}
+
+void CpuRenderer::update() {}
+
+void CpuRenderer::render(const RenderCallInfo &renderCallInfo) {
+    const auto beginTime = std::chrono::steady_clock::now();
+    lastRenderCallInfo = renderCallInfo;
+
+    const uint32_t tileColumns = (settings.windowWidth + tileSize - 1) / tileSize;
+    const uint32_t tileRows = (settings.windowHeight + tileSize - 1) / tileSize;
+    std::vector<PathCounters> counters(workStealingPool.getThreadCount());
+
+    workStealingPool.run(tileColumns * tileRows, [&](uint32_t tile, uint32_t worker) {
+        renderTile(tile, renderCallInfo, counters[worker]);
+    });
+
+    const double timeMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - beginTime).count();
+
+    uint64_t paths = 0, bounces = 0;
+    for (const PathCounters &workerCounters: counters) {
+        paths += workerCounters.paths;
+        bounces += workerCounters.bounces;
+    }
+
+    const uint32_t samplesPerPass = renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls;
+
+    renderCallTimings.push_back(
+            {
+                    .number = renderCallInfo.number,
+                    .samples = samplesPerPass,
+                    .gpuTimeMs = timeMs,
+                    .hostOverheadMs = 0.0,
+                    .hostWaitMs = 0.0,
+                    .megaSamplesPerSecond = double(summedPixelColors.size()) * samplesPerPass / (timeMs * 1000.0),
+                    .averagePathLength = paths > 0 ? double(bounces) / double(paths) : 0.0,
+                    .sampledPixelFraction = 1.0,
+                    .estimatedError = 0.0
+            });
+}
+
+void CpuRenderer::waitIdle() {}
+
+const std::vector<RenderCallTiming> &CpuRenderer::getRenderCallTimings() const {
+    return renderCallTimings;
+}
+
+std::vector<ScreenshotTiming> CpuRenderer::getScreenshotTimings() const {
+    const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+    return screenshotTimings;
+}
+
+std::string CpuRenderer::getDeviceName() const {
+    return "CPU (" + std::to_string(getThreadCount()) + " threads, " + (isAvx2Enabled ? "AVX2" : "scalar") + ")";
+}
+
+bool CpuRenderer::hasConverged() const {
+    return false;
+}
+
+void CpuRenderer::writeTimingTrace(const std::string &path) const {
+    ::writeTimingTrace(path, renderCallTimings, getScreenshotTimings());
+}
+
+bool CpuRenderer::shouldExit() const {
+    return true;
+}
+
+void CpuRenderer::saveScreenshot(const std::string &name) {
+    saveScreenshotAsync(name).get();
+}
+
+std::shared_future<void> CpuRenderer::saveScreenshotAsync(const std::string &name) {
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    std::shared_future<void> completion = std::async(std::launch::async, [this, name, beginTime,
+                                                                         image = pixels]() {
+        imageEncoder.write(name, image.data(), settings.windowWidth, settings.windowHeight,
+                           settings.pngCompressionLevel);
+
+        const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+        screenshotTimings.push_back(
+                {
+                        .name = name,
+                        .gpuCopyTimeMs = 0.0,
+                        .hostTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - beginTime).count(),
+                        .hostBlockedMs = 0.0
+                });
+    }).share();
+
+    pendingScreenshots.push_back(completion);
+    return completion;
+}
+
+void CpuRenderer::saveHdrScreenshot(const std::string &name) {
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    writeHdrImage(name, settings.windowWidth, settings.windowHeight, [&](uint32_t y, float* rgb) {
+        resolveRow(y, rgb);
+    });
+
+    const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+    screenshotTimings.push_back(
+            {
+                    .name = name,
+                    .gpuCopyTimeMs = 0.0,
+                    .hostTimeMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - beginTime).count(),
+                    .hostBlockedMs = 0.0
+            });
+}
+
+void CpuRenderer::waitForScreenshots() {
+    for (const std::shared_future<void> &screenshot: pendingScreenshots) {
+        screenshot.wait();
+    }
+
+    pendingScreenshots.clear();
+}
+
+std::vector<float> CpuRenderer::readSummedPixelColors() {
+    std::vector<float> colors;
+    colors.reserve(summedPixelColors.size() * 3);
+
+    for (const glm::vec3 &color: summedPixelColors) {
+        colors.insert(colors.end(), {color.r, color.g, color.b});
+    }
+
+    return colors;
+}
+
+const std::vector<uint8_t> &CpuRenderer::getPixels() const {
+    return pixels;
+}
+
+uint32_t CpuRenderer::getThreadCount() const {
+    return workStealingPool.getThreadCount();
+}
+
+bool CpuRenderer::usesAvx2() const {
+    return isAvx2Enabled;
+}
+
+// the main function of shader.comp for the pixels of a tile
+void CpuRenderer::renderTile(uint32_t tile, const RenderCallInfo &renderCallInfo, PathCounters &counters) {
+    const uint32_t tileColumns = (settings.windowWidth + tileSize - 1) / tileSize;
+    const uint32_t firstX = (tile % tileColumns) * tileSize;
+    const uint32_t firstY = (tile / tileColumns) * tileSize;
+    const uint32_t samplesPerPass = renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls;
+
+    for (uint32_t y = firstY; y < std::min(firstY + tileSize, settings.windowHeight); y++) {
+        for (uint32_t x = firstX; x < std::min(firstX + tileSize, settings.windowWidth); x++) {
+            RandomState randomState = {.pixelX = x, .pixelY = y, .number = renderCallInfo.number, .offset = 0};
+
+            glm::vec3 sampleSum = glm::vec3(0.0f);
+            uint32_t bounces = 0;
+
+            for (uint32_t i = 0; i < samplesPerPass; i++) {
+                const float u = (float(x) + random(randomState)) / float(settings.windowWidth);
+                const float v = (float(y) + random(randomState)) / float(settings.windowHeight);
+                const Ray ray = getCameraRay(u, v, randomState);
+
+                sampleSum += calculateRayColor(ray, bounces, randomState);
+            }
+
+            counters.paths += samplesPerPass;
+            counters.bounces += bounces;
+
+            const size_t pixel = size_t(y) * settings.windowWidth + x;
+            summedPixelColors[pixel] += sampleSum / float(renderCallInfo.totalSamples);
+
+            const glm::vec3 meanColor = summedPixelColors[pixel] * float(renderCallInfo.totalSamples) /
+                                        float(renderCallInfo.number * samplesPerPass);
+
+            // rounded like the conversion to the UNORM render target
+            for (int channel = 0; channel < 3; channel++) {
+                const float color = std::clamp(std::sqrt(meanColor[channel]), 0.0f, 1.0f);
+                pixels[pixel * 4 + channel] = static_cast<uint8_t>(color * 255.0f + 0.5f);
+            }
+
+            pixels[pixel * 4 + 3] = 255;
+        }
+    }
+}
+
+glm::vec3 CpuRenderer::calculateRayColor(Ray ray, uint32_t &bounces, RandomState &randomState) const {
+    glm::vec3 reflectedColor = glm::vec3(1.0f);
+    glm::vec3 lightSourceColor = glm::vec3(0.0f); // black, if ray exceeds bounce limit
+
+    for (uint32_t depth = 0; depth < settings.maxDepth; depth++) {
+        bounces++;
+        const HitRecord record = hitAnySphere(ray, 0.001f, MAX_RAY_COLLISION_DISTANCE);
+
+        if (!record.doesHit) {
+            lightSourceColor = scene.backgroundColor;
+            break;
+        }
+
+        const ScatterRecord scatterRecord = scatter(ray, record, randomState);
+        if (scatterRecord.doesScatter) {
+            reflectedColor *= scatterRecord.attenuation;
+            ray = {.origin = record.point, .direction = glm::normalize(scatterRecord.scatterDirection)};
+        } else {
+            lightSourceColor = glm::vec3(0.0f);
+            break;
+        }
+
+        if (!survivesRussianRoulette(reflectedColor, depth, randomState)) {
+            lightSourceColor = glm::vec3(0.0f);
+            break;
+        }
+    }
+
+    return reflectedColor * lightSourceColor;
+}
+
+CpuRenderer::HitRecord CpuRenderer::hitAnySphere(const Ray &ray, float tMin, float tMax) const {
+    float t = tMax;
+    const int32_t sphereIndex = settings.useBvh
+                                ? findNearestSphereBVH(ray, tMin, t)
+                                : nearestSphereFunction(sphereArrays, ray.origin, ray.direction, 0,
+                                                        static_cast<uint32_t>(scene.spheres.size()), tMin, t);
+
+    if (sphereIndex < 0) {
+        return {.doesHit = false, .t = tMax, .point = {}, .normal = {}, .frontFace = true, .materialIndex = 0};
+    }
+
+    const Sphere &sphere = scene.spheres[sphereIndex];
+    const glm::vec3 point = ray.origin + t * ray.direction;
+    const glm::vec3 outwardNormal = glm::normalize(point - sphere.center);
+    const bool frontFace = glm::dot(ray.direction, outwardNormal) < 0.0f;
+
+    return {
+            .doesHit = true,
+            .t = t,
+            .point = point,
+            .normal = frontFace ? outwardNormal : -outwardNormal,
+            .frontFace = frontFace,
+            .materialIndex = sphere.materialIndex
+    };
+}
+
+namespace {
+    // returns the entry distance of the ray into the box, or MAX_RAY_COLLISION_DISTANCE if it misses the box
+    float hitAABB(const glm::vec3 &origin, const glm::vec3 &inverseDirection, const BVHNode &node, float tMin,
+                  float tMax) {
+        const glm::vec3 t0 = (node.aabbMin - origin) * inverseDirection;
+        const glm::vec3 t1 = (node.aabbMax - origin) * inverseDirection;
+        const glm::vec3 tSmaller = glm::min(t0, t1);
+        const glm::vec3 tBigger = glm::max(t0, t1);
+
+        const float tNear = std::max(tMin, std::max(tSmaller.x, std::max(tSmaller.y, tSmaller.z)));
+        const float tFar = std::min(tMax, std::min(tBigger.x, std::min(tBigger.y, tBigger.z)));
+
+        return tNear <= tFar ? tNear : MAX_RAY_COLLISION_DISTANCE;
+    }
+}
+
+int32_t CpuRenderer::findNearestSphereBVH(const Ray &ray, float tMin, float &tMax) const {
+    const glm::vec3 inverseDirection = 1.0f / ray.direction;
+    int32_t nearest = -1;
+
+    if (hitAABB(ray.origin, inverseDirection, bvhNodes[0], tMin, tMax) == MAX_RAY_COLLISION_DISTANCE)
+        return nearest;
+
+    uint32_t stack[BVH_MAX_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+
+    while (true) {
+        const BVHNode &node = bvhNodes[nodeIndex];
+
+        if (node.sphereCount > 0) {
+            const int32_t sphereIndex = nearestSphereFunction(sphereArrays, ray.origin, ray.direction, node.offset,
+                                                              node.sphereCount, tMin, tMax);
+            if (sphereIndex >= 0) {
+                nearest = sphereIndex;
+            }
+
+        } else {
+            // visit the nearer child first and postpone the other one, so that tMax shrinks as early as possible
+            uint32_t nearChild = nodeIndex + 1;
+            uint32_t farChild = node.offset;
+
+            float tNear = hitAABB(ray.origin, inverseDirection, bvhNodes[nearChild], tMin, tMax);
+            float tFar = hitAABB(ray.origin, inverseDirection, bvhNodes[farChild], tMin, tMax);
+
+            if (tFar < tNear) {
+                std::swap(nearChild, farChild);
+                std::swap(tNear, tFar);
+            }
+
+            if (tNear != MAX_RAY_COLLISION_DISTANCE) {
+                if (tFar != MAX_RAY_COLLISION_DISTANCE) {
+                    stack[stackSize++] = farChild;
+                }
+
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+
+        nodeIndex = stack[--stackSize];
+    }
+
+    return nearest;
+}
+
+CpuRenderer::ScatterRecord CpuRenderer::scatter(const Ray &ray, const HitRecord &record,
+                                                RandomState &randomState) const {
+    const Material &material = scene.materials[record.materialIndex];
+
+    glm::vec3 color = material.colors[0].color;
+    if (material.textureType == TextureType::CHECKERED) {
+        const float size = 6.0f;
+        const float sines = std::sin(size * record.point.x) * std::sin(size * record.point.y) *
+                            std::sin(size * record.point.z);
+        color = material.colors[sines > 0.0f ? 0 : 1].color;
+    }
+
+    if (material.type == MaterialType::DIFFUSE) {
+        glm::vec3 scatterDirection = record.normal + randomUnitVector(randomState);
+
+        const float s = 1e-8f;
+        if (std::abs(scatterDirection.x) < s && std::abs(scatterDirection.y) < s && std::abs(scatterDirection.z) < s) {
+            scatterDirection = record.normal;
+        }
+
+        return {.doesScatter = true, .attenuation = color, .scatterDirection = scatterDirection};
+
+    } else if (material.type == MaterialType::METAL) {
+        const glm::vec3 reflectedDirection = glm::reflect(ray.direction, record.normal);
+        const glm::vec3 fuzzDirection = material.specificAttribute * randomUnitVector(randomState);
+        const glm::vec3 scatterDirection = glm::normalize(reflectedDirection + fuzzDirection);
+
+        const bool doesScatter = glm::dot(scatterDirection, record.normal) > 0.0f;
+        return {.doesScatter = doesScatter, .attenuation = color, .scatterDirection = scatterDirection};
+
+    } else if (material.type == MaterialType::REFRACTIVE) {
+        const float eta = record.frontFace ? (1.0f / material.specificAttribute) : material.specificAttribute;
+
+        const float cosTheta = glm::dot(-ray.direction, record.normal);
+        const bool canRefract = eta * std::sqrt(1.0f - cosTheta * cosTheta) <= 1.0f;
+
+        // only draws a random number if the ray can refract, like the short-circuit evaluation in the shader
+        bool doesRefract = false;
+        if (canRefract) {
+            const float r = std::pow((1.0f - eta) / (1.0f + eta), 2.0f);
+            const float reflectanceFactor = r + (1.0f - r) * std::pow(1.0f - cosTheta, 5.0f);
+            doesRefract = reflectanceFactor < random(randomState);
+        }
+
+        const glm::vec3 scatterDirection = doesRefract ? glm::refract(ray.direction, record.normal, eta)
+                                                       : glm::reflect(ray.direction, record.normal);
+        return {.doesScatter = true, .attenuation = color, .scatterDirection = scatterDirection};
+    }
+
+    return {.doesScatter = false, .attenuation = glm::vec3(0.0f), .scatterDirection = glm::vec3(0.0f)};
+}
+
+bool CpuRenderer::survivesRussianRoulette(glm::vec3 &throughput, uint32_t depth, RandomState &randomState) const {
+    if (!settings.russianRoulette || depth < settings.russianRouletteMinDepth)
+        return true;
+
+    const float survivalProbability = std::min(std::max(throughput.r, std::max(throughput.g, throughput.b)), 1.0f);
+    if (random(randomState) >= survivalProbability)
+        return false;
+
+    throughput /= survivalProbability;
+    return true;
+}
+
+CpuRenderer::Viewport CpuRenderer::calculateViewport(float aspectRatio) const {
+    const Camera &camera = scene.camera;
+    const float viewportHeight = std::tan(glm::radians(camera.fov) / 2.0f) * 2.0f;
+    const float viewportWidth = aspectRatio * viewportHeight;
+
+    const glm::vec3 cameraForward = glm::normalize(camera.lookAt - camera.lookFrom);
+    const glm::vec3 cameraRight = glm::normalize(glm::cross(camera.up, cameraForward));
+    const glm::vec3 cameraUp = glm::normalize(glm::cross(cameraForward, cameraRight));
+
+    const glm::vec3 horizontal = viewportWidth * cameraRight * camera.focusDistance;
+    const glm::vec3 vertical = viewportHeight * cameraUp * camera.focusDistance;
+    const glm::vec3 upperLeftCorner = camera.lookFrom - horizontal / 2.0f + vertical / 2.0f +
+                                      cameraForward * camera.focusDistance;
+
+    return {
+            .horizontal = horizontal,
+            .vertical = vertical,
+            .upperLeftCorner = upperLeftCorner,
+            .cameraUp = cameraUp,
+            .cameraRight = cameraRight
+    };
+}
+
+CpuRenderer::Ray CpuRenderer::getCameraRay(float u, float v, RandomState &randomState) const {
+    const Camera &camera = scene.camera;
+
+    // separate statements, the shader draws the x coordinate first
+    const float randomX = randomInInterval(-1.0f, 1.0f, randomState);
+    const float randomY = randomInInterval(-1.0f, 1.0f, randomState);
+    const glm::vec2 lensOffset = (camera.aperture / 2.0f) * glm::normalize(glm::vec2(randomX, randomY));
+    const glm::vec3 offset = viewport.cameraRight * lensOffset.x + viewport.cameraUp * lensOffset.y;
+
+    const glm::vec3 from = camera.lookFrom + offset;
+    const glm::vec3 to = viewport.upperLeftCorner + viewport.horizontal * u - viewport.vertical * v;
+
+    return {.origin = from, .direction = glm::normalize(to - from)};
+}
+
+namespace {
+    uint32_t hash(uint32_t x) {
+        x += (x << 10u);
+        x ^= (x >> 6u);
+        x += (x << 3u);
+        x ^= (x >> 11u);
+        x += (x << 15u);
+        return x;
+    }
+}
+
+// the shader hashes the bits of the inputs converted to floats
+float CpuRenderer::random(RandomState &state) {
+    state.offset += 1;
+
+    const uint32_t x = std::bit_cast<uint32_t>(float(state.pixelX));
+    const uint32_t y = std::bit_cast<uint32_t>(float(state.pixelY));
+    const uint32_t z = std::bit_cast<uint32_t>(float(state.number));
+    const uint32_t w = std::bit_cast<uint32_t>(float(state.offset));
+
+    uint32_t m = hash(x ^ hash(y) ^ hash(z) ^ hash(w));
+    m &= 0x007FFFFFu;
+    m |= 0x3F800000u;
+    return std::bit_cast<float>(m) - 1.0f;
+}
+
+float CpuRenderer::randomInInterval(float min, float max, RandomState &state) {
+    return random(state) * (max - min) + min;
+}
+
+glm::vec3 CpuRenderer::randomUnitVector(RandomState &state) {
+    const float x = randomInInterval(-1.0f, 1.0f, state);
+    const float y = randomInInterval(-1.0f, 1.0f, state);
+    const float z = randomInInterval(-1.0f, 1.0f, state);
+    return glm::normalize(glm::vec3(x, y, z));
+}
+
+void CpuRenderer::resolveRow(uint32_t y, float* rgb) const {
+    const uint32_t samplesPerPass = lastRenderCallInfo.totalRenderCalls > 0
+                                    ? lastRenderCallInfo.totalSamples / lastRenderCallInfo.totalRenderCalls : 0;
+    const float sampleCount = float(lastRenderCallInfo.number * samplesPerPass);
+    const float scale = sampleCount > 0.0f ? float(lastRenderCallInfo.totalSamples) / sampleCount : 0.0f;
+
+    for (uint32_t x = 0; x < settings.windowWidth; x++) {
+        const glm::vec3 &summedColor = summedPixelColors[size_t(y) * settings.windowWidth + x];
+
+        for (int channel = 0; channel < 3; channel++) {
+            rgb[x * 3 + channel] = summedColor[channel] * scale;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <mutex>
+#include "renderer.h"
+#include "vulkan_settings.h"
+#include "scene.h"
+#include "bvh.h"
+#include "cpu_sphere_intersection.h"
+#include "work_stealing_pool.h"
+#include "image_encoder.h"
+
+// Traces the scene on the CPU with the algorithm of shader.comp: the same camera, materials, BVH traversal and hash
+// based random numbers, so its images match the ones of the GPU up to floating point differences. It renders tiles of
+// the image on a work-stealing thread pool and intersects 8 spheres at a time with AVX2 if the CPU supports it.
+// Adaptive sampling and the progressive mode aren't supported, the GPU scheduling options are ignored.
+class CpuRenderer : public Renderer {
+public:
+    CpuRenderer(VulkanSettings settings, Scene scene);
+
+    ~CpuRenderer() override;
+
+    void update() override;
+
+    // blocks until the render call is done
+    void render(const RenderCallInfo &renderCallInfo) override;
+
+    void waitIdle() override;
+
+    // gpuTimeMs holds the duration of the render call
+    [[nodiscard]] const std::vector<RenderCallTiming> &getRenderCallTimings() const override;
+
+    [[nodiscard]] std::vector<ScreenshotTiming> getScreenshotTimings() const override;
+
+    [[nodiscard]] std::string getDeviceName() const override;
+
+    [[nodiscard]] bool hasConverged() const override;
+
+    void writeTimingTrace(const std::string &path) const override;
+
+    // there is no window
+    [[nodiscard]] bool shouldExit() const override;
+
+    void saveScreenshot(const std::string &name) override;
+
+    // the image is copied, so the next render calls can continue while it is encoded
+    std::shared_future<void> saveScreenshotAsync(const std::string &name) override;
+
+    void saveHdrScreenshot(const std::string &name) override;
+
+    void waitForScreenshots() override;
+
+    [[nodiscard]] std::vector<float> readSummedPixelColors() override;
+
+    // RGBA8, like the render target of the GPU
+    [[nodiscard]] const std::vector<uint8_t> &getPixels() const;
+
+    [[nodiscard]] uint32_t getThreadCount() const;
+
+    // false if VulkanSettings::cpuSimd isn't set or the CPU doesn't support AVX2
+    [[nodiscard]] bool usesAvx2() const;
+
+private:
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 direction;
+    };
+
+    struct HitRecord {
+        bool doesHit;
+        float t;
+        glm::vec3 point;
+        glm::vec3 normal;
+        bool frontFace;
+        uint32_t materialIndex;
+    };
+
+    struct ScatterRecord {
+        bool doesScatter;
+        glm::vec3 attenuation;
+        glm::vec3 scatterDirection;
+    };
+
+    struct Viewport {
+        glm::vec3 horizontal;
+        glm::vec3 vertical;
+        glm::vec3 upperLeftCorner;
+        glm::vec3 cameraUp;
+        glm::vec3 cameraRight;
+    };
+
+    // the inputs of random() in common.glsl
+    struct RandomState {
+        uint32_t pixelX, pixelY;
+        uint32_t number;
+        uint32_t offset;
+    };
+
+    // per worker, so the threads never write to the same cache line
+    struct alignas(64) PathCounters {
+        uint64_t paths = 0;
+        uint64_t bounces = 0;
+    };
+
+    const uint32_t tileSize = 16;
+
+    VulkanSettings settings;
+    Scene scene;
+    std::vector<BVHNode> bvhNodes;
+    SphereArrays sphereArrays;
+    NearestSphereFunction nearestSphereFunction;
+    bool isAvx2Enabled;
+    Viewport viewport;
+
+    WorkStealingPool workStealingPool;
+    ImageEncoder imageEncoder;
+
+    std::vector<glm::vec3> summedPixelColors; // like the summed pixel color image, in full precision
+    std::vector<uint8_t> pixels;
+    RenderCallInfo lastRenderCallInfo = {};
+
+    std::vector<RenderCallTiming> renderCallTimings;
+    std::vector<ScreenshotTiming> screenshotTimings;
+    mutable std::mutex screenshotTimingsMutex;
+    std::vector<std::shared_future<void>> pendingScreenshots;
+
+    void renderTile(uint32_t tile, const RenderCallInfo &renderCallInfo, PathCounters &counters);
+
+    [[nodiscard]] glm::vec3 calculateRayColor(Ray ray, uint32_t &bounces, RandomState &randomState) const;
+
+    [[nodiscard]] HitRecord hitAnySphere(const Ray &ray, float tMin, float tMax) const;
+
+    // the index of the nearest sphere like the traversal of hitAnySphereBVH in common.glsl, see NearestSphereFunction
+    [[nodiscard]] int32_t findNearestSphereBVH(const Ray &ray, float tMin, float &tMax) const;
+
+    [[nodiscard]] ScatterRecord scatter(const Ray &ray, const HitRecord &record, RandomState &randomState) const;
+
+    [[nodiscard]] bool survivesRussianRoulette(glm::vec3 &throughput, uint32_t depth, RandomState &randomState) const;
+
+    [[nodiscard]] Viewport calculateViewport(float aspectRatio) const;
+
+    [[nodiscard]] Ray getCameraRay(float u, float v, RandomState &randomState) const;
+
+    [[nodiscard]] static float random(RandomState &state);
+
+    [[nodiscard]] static float randomInInterval(float min, float max, RandomState &state);
+
+    [[nodiscard]] static glm::vec3 randomUnitVector(RandomState &state);
+
+    // mean linear RGB colors of a row, from the summed colors
+    void resolveRow(uint32_t y, float* rgb) const;
+};
@@ -0,0 +1,55 @@
+#include "cpu_sphere_intersection.h"
+#include <cmath>
+
+SphereArrays createSphereArrays(const std::vector<Sphere> &spheres) {
+    SphereArrays arrays;
+
+    for (const Sphere &sphere: spheres) {
+        arrays.centerX.push_back(sphere.center.x);
+        arrays.centerY.push_back(sphere.center.y);
+        arrays.centerZ.push_back(sphere.center.z);
+        arrays.radiusSquared.push_back(sphere.radius * sphere.radius);
+    }
+
+    for (int i = 0; i < 7; i++) {
+        arrays.centerX.push_back(0.0f);
+        arrays.centerY.push_back(0.0f);
+        arrays.centerZ.push_back(0.0f);
+        arrays.radiusSquared.push_back(0.0f);
+    }
+
+    return arrays;
+}
+
+int32_t findNearestSphere(const SphereArrays &spheres, const glm::vec3 &origin, const glm::vec3 &direction,
+                          uint32_t first, uint32_t count, float tMin, float &tMax) {
+    const float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+    int32_t nearest = -1;
+
+    for (uint32_t i = first; i < first + count; i++) {
+        const float coX = origin.x - spheres.centerX[i];
+        const float coY = origin.y - spheres.centerY[i];
+        const float coZ = origin.z - spheres.centerZ[i];
+
+        const float halfB = coX * direction.x + coY * direction.y + coZ * direction.z;
+        const float c = (coX * coX + coY * coY + coZ * coZ) - spheres.radiusSquared[i];
+        const float D = halfB * halfB - a * c;
+
+        if (!(D >= 0.0f))
+            continue;
+
+        const float root = std::sqrt(D);
+        const float t1 = (-halfB - root) / a;
+        const float t2 = (-halfB + root) / a;
+
+        // the far intersection is only needed if the near one is behind the origin (inside of the sphere)
+        const float t = t1 >= tMin ? t1 : t2;
+
+        if (t >= tMin && t <= tMax) {
+            tMax = t;
+            nearest = static_cast<int32_t>(i);
+        }
+    }
+
+    return nearest;
+}
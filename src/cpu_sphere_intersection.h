@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "scene.h"
+
+// The spheres of the scene as a structure of arrays, so 8 of them can be loaded into AVX registers at once. Every
+// array is padded by 7 elements, the last (partial) batch of a range can be loaded without reading past the end.
+struct SphereArrays {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radiusSquared;
+};
+
+[[nodiscard]] SphereArrays createSphereArrays(const std::vector<Sphere> &spheres);
+
+// Returns the index of the sphere in [first, first + count) that the ray hits at the smallest distance in
+// [tMin, tMax], and sets tMax to that distance. Like the loop over the spheres in common.glsl, the later sphere wins
+// if two are hit at the same distance. -1 if no sphere is hit.
+using NearestSphereFunction = int32_t (*)(const SphereArrays &spheres, const glm::vec3 &origin,
+                                          const glm::vec3 &direction, uint32_t first, uint32_t count, float tMin,
+                                          float &tMax);
+
+// one sphere at a time, with the same operations as hitSphere in common.glsl
+int32_t findNearestSphere(const SphereArrays &spheres, const glm::vec3 &origin, const glm::vec3 &direction,
+                          uint32_t first, uint32_t count, float tMin, float &tMax);
+
+// 8 spheres at a time with the same operations, so the results are identical to findNearestSphere. Null if the CPU
+// doesn't support AVX2 or the renderer was built for a different architecture.
+[[nodiscard]] NearestSphereFunction getAvx2NearestSphereFunction();
@@ -0,0 +1,116 @@
+#include "cpu_sphere_intersection.h"
+
+// compiled with AVX2 enabled (see CMakeLists.txt), but only called once the CPU is known to support it
+
+#ifdef __AVX2__
+
+#include <bit>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    bool isAvx2Supported() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // the OS has to save the AVX registers on context switches
+        __cpuid(info, 1);
+        const bool hasAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+        if (!hasAvx || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 5);
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    float getHorizontalMinimum(__m256 values) {
+        __m128 minimum = _mm_min_ps(_mm256_castps256_ps128(values), _mm256_extractf128_ps(values, 1));
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(minimum);
+    }
+
+    int32_t findNearestSphereAvx2(const SphereArrays &spheres, const glm::vec3 &origin, const glm::vec3 &direction,
+                                  uint32_t first, uint32_t count, float tMin, float &tMax) {
+        const __m256 originX = _mm256_set1_ps(origin.x);
+        const __m256 originY = _mm256_set1_ps(origin.y);
+        const __m256 originZ = _mm256_set1_ps(origin.z);
+        const __m256 directionX = _mm256_set1_ps(direction.x);
+        const __m256 directionY = _mm256_set1_ps(direction.y);
+        const __m256 directionZ = _mm256_set1_ps(direction.z);
+        const __m256 a = _mm256_set1_ps(direction.x * direction.x + direction.y * direction.y +
+                                        direction.z * direction.z);
+        const __m256 minimumT = _mm256_set1_ps(tMin);
+        const __m256 signBit = _mm256_set1_ps(-0.0f);
+        const __m256 infinity = _mm256_set1_ps(INFINITY);
+        const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+        int32_t nearest = -1;
+
+        for (uint32_t batch = 0; batch < count; batch += 8) {
+            const uint32_t index = first + batch;
+
+            const __m256 coX = _mm256_sub_ps(originX, _mm256_loadu_ps(&spheres.centerX[index]));
+            const __m256 coY = _mm256_sub_ps(originY, _mm256_loadu_ps(&spheres.centerY[index]));
+            const __m256 coZ = _mm256_sub_ps(originZ, _mm256_loadu_ps(&spheres.centerZ[index]));
+
+            const __m256 halfB = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(coX, directionX),
+                                                             _mm256_mul_ps(coY, directionY)),
+                                               _mm256_mul_ps(coZ, directionZ));
+            const __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(coX, coX),
+                                                                       _mm256_mul_ps(coY, coY)),
+                                                         _mm256_mul_ps(coZ, coZ)),
+                                           _mm256_loadu_ps(&spheres.radiusSquared[index]));
+            const __m256 D = _mm256_sub_ps(_mm256_mul_ps(halfB, halfB), _mm256_mul_ps(a, c));
+
+            // negative discriminants result in NaN, those lanes are masked out below
+            const __m256 root = _mm256_sqrt_ps(D);
+            const __m256 negativeHalfB = _mm256_xor_ps(halfB, signBit);
+            const __m256 t1 = _mm256_div_ps(_mm256_sub_ps(negativeHalfB, root), a);
+            const __m256 t2 = _mm256_div_ps(_mm256_add_ps(negativeHalfB, root), a);
+            const __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, minimumT, _CMP_GE_OQ));
+
+            const __m256 isInRange = _mm256_cmp_ps(lanes, _mm256_set1_ps(float(count - batch)), _CMP_LT_OQ);
+            const __m256 isHit = _mm256_and_ps(
+                    _mm256_and_ps(isInRange, _mm256_cmp_ps(D, _mm256_setzero_ps(), _CMP_GE_OQ)),
+                    _mm256_and_ps(_mm256_cmp_ps(t, minimumT, _CMP_GE_OQ),
+                                  _mm256_cmp_ps(t, _mm256_set1_ps(tMax), _CMP_LE_OQ)));
+
+            if (_mm256_testz_ps(isHit, isHit))
+                continue;
+
+            const __m256 hitT = _mm256_blendv_ps(infinity, t, isHit);
+            const float batchMinimum = getHorizontalMinimum(hitT);
+
+            // the last lane with the smallest distance, like the sequential loop
+            const auto nearestLanes = static_cast<uint32_t>(_mm256_movemask_ps(
+                    _mm256_and_ps(isHit, _mm256_cmp_ps(hitT, _mm256_set1_ps(batchMinimum), _CMP_EQ_OQ))));
+
+            tMax = batchMinimum;
+            nearest = static_cast<int32_t>(index + 31 - std::countl_zero(nearestLanes));
+        }
+
+        return nearest;
+    }
+}
+
+NearestSphereFunction getAvx2NearestSphereFunction() {
+    return isAvx2Supported() ? &findNearestSphereAvx2 : nullptr;
+}
+
+#else
+
+NearestSphereFunction getAvx2NearestSphereFunction() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,313 @@
+#include "distributed.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include "socket.h"
+
+// The messages are sent as they are in memory, coordinator and workers have to use the same byte order.
+//
+//   coordinator -> worker: JobMessage
+//   worker -> coordinator: HelloMessage, followed by the name of the device
+//   coordinator -> worker: AssignmentMessage          \ repeated until an assignment without render calls
+//   worker -> coordinator: ResultMessage + colors     /
+
+namespace {
+    const uint32_t PROTOCOL_MAGIC = 0x52545732; // "RTW2"
+
+    struct JobMessage {
+        uint32_t magic;
+        uint32_t width, height;
+        uint32_t totalRenderCalls;
+        uint32_t totalSamples;
+        uint32_t maxDepth;
+        uint32_t useBvh;
+        uint32_t russianRoulette;
+        uint32_t russianRouletteMinDepth;
+        uint32_t sceneSeed;
+        int32_t gridSize;
+        float density;
+        float diffuseShare, metalShare, refractiveShare;
+    };
+
+    struct HelloMessage {
+        uint32_t magic;
+        uint32_t deviceNameLength;
+    };
+
+    // the render calls [firstRenderCall, firstRenderCall + renderCallCount), none to end the job
+    struct AssignmentMessage {
+        uint32_t firstRenderCall;
+        uint32_t renderCallCount;
+    };
+
+    // followed by the summed colors of all render calls of the worker so far, width * height * 3 floats
+    struct ResultMessage {
+        uint32_t firstRenderCall;
+        uint32_t renderCallCount;
+    };
+
+    struct CoordinatorState {
+        std::mutex mutex;
+        std::condition_variable condition; // notified when an assignment is done or handed back
+        std::deque<AssignmentMessage> pendingAssignments;
+        uint32_t completedRenderCalls = 0;
+        std::vector<float> summedColors; // of the workers that have finished
+        uint32_t summedRenderCalls = 0;
+        uint32_t workerCount = 0;
+        uint32_t droppedWorkerCount = 0;
+    };
+
+    void serveWorker(Socket socket, uint32_t worker, const CoordinatorSettings &settings, CoordinatorState &state) {
+        const RenderJob &job = settings.job;
+        const std::string peerName = socket.getPeerName();
+
+        // replaced as a whole by every result, as it covers all render calls of the worker so far
+        std::vector<float> summedColors;
+        uint32_t renderCalls = 0;
+        std::optional<AssignmentMessage> assignment;
+
+        try {
+            socket.setReceiveTimeout(settings.workerTimeoutSeconds);
+
+            const JobMessage jobMessage = {
+                    .magic = PROTOCOL_MAGIC,
+                    .width = job.width,
+                    .height = job.height,
+                    .totalRenderCalls = job.totalRenderCalls,
+                    .totalSamples = job.totalSamples,
+                    .maxDepth = job.maxDepth,
+                    .useBvh = job.useBvh,
+                    .russianRoulette = job.russianRoulette,
+                    .russianRouletteMinDepth = job.russianRouletteMinDepth,
+                    .sceneSeed = job.scene.seed,
+                    .gridSize = job.scene.gridSize,
+                    .density = job.scene.density,
+                    .diffuseShare = job.scene.diffuseShare,
+                    .metalShare = job.scene.metalShare,
+                    .refractiveShare = job.scene.refractiveShare
+            };
+            socket.send(&jobMessage, sizeof(jobMessage));
+
+            HelloMessage hello = {};
+            socket.receive(&hello, sizeof(hello));
+
+            if (hello.magic != PROTOCOL_MAGIC || hello.deviceNameLength > 1024)
+                throw std::runtime_error("[Error] " + peerName + " isn't a render worker!");
+
+            std::string deviceName(hello.deviceNameLength, '\0');
+            socket.receive(deviceName.data(), deviceName.size());
+            std::cout << "Worker " << worker << " connected from " << peerName << " (" << deviceName << ")"
+                      << std::endl;
+
+            const size_t colorCount = size_t(job.width) * job.height * 3;
+            std::vector<float> receivedColors(colorCount);
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.condition.wait(lock, [&]() {
+                        return !state.pendingAssignments.empty() || state.completedRenderCalls == job.totalRenderCalls;
+                    });
+
+                    if (state.pendingAssignments.empty())
+                        break;
+
+                    assignment = state.pendingAssignments.front();
+                    state.pendingAssignments.pop_front();
+                }
+
+                socket.send(&*assignment, sizeof(AssignmentMessage));
+
+                ResultMessage result = {};
+                socket.receive(&result, sizeof(result));
+
+                if (result.firstRenderCall != assignment->firstRenderCall ||
+                    result.renderCallCount != assignment->renderCallCount)
+                    throw std::runtime_error("[Error] Worker " + std::to_string(worker) + " sent the wrong result!");
+
+                // into a separate buffer, so a connection lost in the middle leaves the previous sums intact
+                socket.receive(receivedColors.data(), colorCount * sizeof(float));
+                std::swap(summedColors, receivedColors);
+                receivedColors.resize(colorCount);
+
+                renderCalls += assignment->renderCallCount;
+
+                const std::lock_guard<std::mutex> lock(state.mutex);
+                state.completedRenderCalls += assignment->renderCallCount;
+                std::cout << "Worker " << worker << " traced render calls " << assignment->firstRenderCall << " to "
+                          << assignment->firstRenderCall + assignment->renderCallCount - 1 << " ("
+                          << state.completedRenderCalls << " / " << job.totalRenderCalls << ")" << std::endl;
+
+                assignment.reset();
+                state.condition.notify_all();
+            }
+
+            const AssignmentMessage end = {.firstRenderCall = 0, .renderCallCount = 0};
+            socket.send(&end, sizeof(end));
+
+        } catch (const std::exception &exception) {
+            const std::lock_guard<std::mutex> lock(state.mutex);
+            std::cout << "Worker " << worker << " dropped: " << exception.what() << std::endl;
+            state.droppedWorkerCount++;
+
+            if (assignment) {
+                state.pendingAssignments.push_front(*assignment);
+                state.condition.notify_all();
+            }
+        }
+
+        if (renderCalls == 0)
+            return;
+
+        const std::lock_guard<std::mutex> lock(state.mutex);
+
+        if (state.summedColors.empty()) {
+            state.summedColors = std::move(summedColors);
+        } else {
+            std::transform(state.summedColors.begin(), state.summedColors.end(), summedColors.begin(),
+                           state.summedColors.begin(), std::plus<>());
+        }
+
+        state.summedRenderCalls += renderCalls;
+    }
+}
+
+CoordinatorResult runCoordinator(const CoordinatorSettings &settings) {
+    const RenderJob &job = settings.job;
+    CoordinatorState state;
+
+    if (settings.renderCallsPerAssignment == 0)
+        throw std::runtime_error("[Error] An assignment needs at least one render call!");
+
+    for (uint32_t first = 1; first <= job.totalRenderCalls; first += settings.renderCallsPerAssignment) {
+        state.pendingAssignments.push_back(
+                {
+                        .firstRenderCall = first,
+                        .renderCallCount = std::min(settings.renderCallsPerAssignment,
+                                                    job.totalRenderCalls - first + 1)
+                });
+    }
+
+    const Socket listener = Socket::listen(settings.port);
+    std::cout << "Waiting for workers on port " << settings.port << std::endl;
+
+    std::vector<std::thread> threads;
+
+    while (true) {
+        {
+            const std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.completedRenderCalls == job.totalRenderCalls)
+                break;
+        }
+
+        std::optional<Socket> socket = listener.accept(100);
+        if (!socket)
+            continue;
+
+        const std::lock_guard<std::mutex> lock(state.mutex);
+        threads.emplace_back(serveWorker, std::move(*socket), state.workerCount++, std::cref(settings),
+                             std::ref(state));
+    }
+
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    // every worker sent the sums of its render calls divided by totalSamples
+    const float scale = float(job.totalRenderCalls) / float(state.summedRenderCalls);
+
+    for (float &color: state.summedColors) {
+        color *= scale;
+    }
+
+    return {
+            .colors = std::move(state.summedColors),
+            .workerCount = state.workerCount,
+            .droppedWorkerCount = state.droppedWorkerCount
+    };
+}
+
+void runWorker(const std::string &host, uint16_t port, VulkanSettings settings, const RendererFactory &createRenderer) {
+    // rejected before connecting, instead of failing the first assignment after it has been traced
+    if (settings.progressive)
+        throw std::runtime_error("[Error] Workers don't support the progressive mode!");
+
+    if (settings.viewCount > 1)
+        throw std::runtime_error("[Error] Workers don't support multiple views!");
+
+    const Socket socket = Socket::connect(host, port);
+
+    JobMessage job = {};
+    socket.receive(&job, sizeof(job));
+
+    if (job.magic != PROTOCOL_MAGIC)
+        throw std::runtime_error("[Error] " + host + ":" + std::to_string(port) + " isn't a render coordinator!");
+
+    settings.windowWidth = job.width;
+    settings.windowHeight = job.height;
+    settings.headless = true;
+    settings.maxDepth = job.maxDepth;
+    settings.useBvh = job.useBvh;
+    settings.russianRoulette = job.russianRoulette;
+    settings.russianRouletteMinDepth = job.russianRouletteMinDepth;
+
+    const Scene scene = generateScene(
+            {
+                    .seed = job.sceneSeed,
+                    .gridSize = job.gridSize,
+                    .density = job.density,
+                    .diffuseShare = job.diffuseShare,
+                    .metalShare = job.metalShare,
+                    .refractiveShare = job.refractiveShare
+            });
+
+    const std::unique_ptr<Renderer> renderer = createRenderer(settings, scene);
+
+    const std::string deviceName = renderer->getDeviceName();
+    const HelloMessage hello = {
+            .magic = PROTOCOL_MAGIC,
+            .deviceNameLength = static_cast<uint32_t>(deviceName.size())
+    };
+
+    socket.send(&hello, sizeof(hello));
+    socket.send(deviceName.data(), deviceName.size());
+    std::cout << "Connected to " << host << ":" << port << ", rendering on " << deviceName << std::endl;
+
+    while (true) {
+        AssignmentMessage assignment = {};
+        socket.receive(&assignment, sizeof(assignment));
+
+        if (assignment.renderCallCount == 0)
+            break;
+
+        for (uint32_t i = 0; i < assignment.renderCallCount; i++) {
+            renderer->render(
+                    {
+                            .number = assignment.firstRenderCall + i,
+                            .totalRenderCalls = job.totalRenderCalls,
+                            .totalSamples = job.totalSamples
+                    });
+        }
+
+        // floats, but the Vulkan renderer sums into a 16-bit UNORM image, so their precision is 1 / 65535 of a sum
+        const std::vector<float> summedColors = renderer->readSummedPixelColors();
+        const ResultMessage result = {
+                .firstRenderCall = assignment.firstRenderCall,
+                .renderCallCount = assignment.renderCallCount
+        };
+
+        socket.send(&result, sizeof(result));
+        socket.send(summedColors.data(), summedColors.size() * sizeof(float));
+
+        std::cout << "Render calls " << assignment.firstRenderCall << " to "
+                  << assignment.firstRenderCall + assignment.renderCallCount - 1 << " sent" << std::endl;
+    }
+
+    std::cout << "Job done" << std::endl;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "renderer.h"
+#include "vulkan_settings.h"
+#include "scene.h"
+
+// What the coordinator sends to every worker. The workers generate the scene from its settings themselves, so only a
+// few bytes have to be transferred.
+struct RenderJob {
+    uint32_t width, height;
+    uint32_t totalRenderCalls;
+    uint32_t totalSamples;
+    uint32_t maxDepth;
+    bool useBvh;
+    bool russianRoulette;
+    uint32_t russianRouletteMinDepth;
+    SceneGeneratorSettings scene; // the thread count isn't transferred, every worker uses all of its threads
+};
+
+struct CoordinatorSettings {
+    uint16_t port;
+    RenderJob job;
+    uint32_t renderCallsPerAssignment = 10; // render calls a worker gets at once, at least one
+    uint32_t workerTimeoutSeconds = 600; // a worker that doesn't report back within this time is dropped
+};
+
+struct CoordinatorResult {
+    std::vector<float> colors; // the mean linear RGB color of every pixel
+    uint32_t workerCount; // that connected during the job
+    uint32_t droppedWorkerCount; // that lost the connection or timed out, their assignments were handed out again
+};
+
+// Listens for workers and hands out ranges of render calls until every render call has been traced. Each worker sends
+// back the summed colors of all its render calls after every assignment, so when a worker drops out, only its current
+// assignment is lost and given to another worker. The sums of all workers are merged once the job is done.
+[[nodiscard]] CoordinatorResult runCoordinator(const CoordinatorSettings &settings);
+
+using RendererFactory = std::function<std::unique_ptr<Renderer>(const VulkanSettings &settings, const Scene &scene)>;
+
+// Connects to a coordinator and renders the assigned render calls until it ends the job. The size of the image, the
+// scene and the sampling parameters of the settings are replaced by the ones of the job. The progressive mode and
+// multiple views aren't supported, as there are no summed colors of the whole image to send back.
+void runWorker(const std::string &host, uint16_t port, VulkanSettings settings, const RendererFactory &createRenderer);
@@ -0,0 +1,148 @@
+#include "hdr_image.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "mapped_file.h"
+
+namespace {
+    void appendLittleEndian(std::vector<uint8_t> &output, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            output.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void storeLittleEndian(uint8_t* destination, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            destination[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    // every stride-th value, starting at the first one, as little endian floats
+    void storeFloats(uint8_t* destination, const float* values, size_t count, size_t stride) {
+        for (size_t i = 0; i < count; i++) {
+            if constexpr (std::endian::native == std::endian::little) {
+                std::memcpy(destination + i * 4, values + i * stride, 4);
+            } else {
+                storeLittleEndian(destination + i * 4, std::bit_cast<uint32_t>(values[i * stride]), 4);
+            }
+        }
+    }
+
+    // name, type, size and value of an OpenEXR header attribute
+    void appendExrAttribute(std::vector<uint8_t> &header, const std::string &name, const std::string &type,
+                            const std::vector<uint8_t> &value) {
+        header.insert(header.end(), name.begin(), name.end());
+        header.push_back(0);
+        header.insert(header.end(), type.begin(), type.end());
+        header.push_back(0);
+        appendLittleEndian(header, value.size(), 4);
+        header.insert(header.end(), value.begin(), value.end());
+    }
+
+    std::vector<uint8_t> getExrHeader(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> header;
+        appendLittleEndian(header, 20000630, 4); // magic number
+        appendLittleEndian(header, 2, 4); // version 2, single part scan line file
+
+        // sorted by name, as they are stored in the scan lines
+        std::vector<uint8_t> channels;
+        for (const char channel: {'B', 'G', 'R'}) {
+            channels.insert(channels.end(), {uint8_t(channel), 0});
+            appendLittleEndian(channels, 2, 4); // FLOAT
+            appendLittleEndian(channels, 0, 4); // not perceptually linear, 3 reserved bytes
+            appendLittleEndian(channels, 1, 4); // x sampling
+            appendLittleEndian(channels, 1, 4); // y sampling
+        }
+        channels.push_back(0);
+
+        std::vector<uint8_t> window;
+        for (const uint32_t value: {0u, 0u, width - 1, height - 1}) {
+            appendLittleEndian(window, value, 4);
+        }
+
+        std::vector<uint8_t> one;
+        appendLittleEndian(one, std::bit_cast<uint32_t>(1.0f), 4);
+
+        appendExrAttribute(header, "channels", "chlist", channels);
+        appendExrAttribute(header, "compression", "compression", {0}); // NO_COMPRESSION
+        appendExrAttribute(header, "dataWindow", "box2i", window);
+        appendExrAttribute(header, "displayWindow", "box2i", window);
+        appendExrAttribute(header, "lineOrder", "lineOrder", {0}); // INCREASING_Y
+        appendExrAttribute(header, "pixelAspectRatio", "float", one);
+        appendExrAttribute(header, "screenWindowCenter", "v2f", std::vector<uint8_t>(8, 0));
+        appendExrAttribute(header, "screenWindowWidth", "float", one);
+        header.push_back(0);
+
+        return header;
+    }
+
+    // the rows are stored from the bottom, a negative scale means little endian floats
+    void writePfm(const std::string &path, uint32_t width, uint32_t height, const HdrRowFunction &getRow) {
+        const std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n" +
+                                   (std::endian::native == std::endian::little ? "-1.0" : "1.0") + "\n";
+        const size_t rowSize = size_t(width) * 3 * sizeof(float);
+
+        MappedFile file(path, header.size() + rowSize * height);
+        std::memcpy(file.getData(), header.data(), header.size());
+
+        std::vector<float> row(size_t(width) * 3);
+        for (uint32_t y = 0; y < height; y++) {
+            getRow(y, row.data());
+            std::memcpy(file.getData() + header.size() + (height - 1 - y) * rowSize, row.data(), rowSize);
+        }
+    }
+
+    // every scan line is its own block: y, size of the data and the channels one after another
+    void writeExr(const std::string &path, uint32_t width, uint32_t height, const HdrRowFunction &getRow) {
+        const std::vector<uint8_t> header = getExrHeader(width, height);
+        const size_t offsetTableSize = size_t(height) * sizeof(uint64_t);
+        const size_t channelSize = size_t(width) * sizeof(float);
+        const size_t blockSize = 8 + 3 * channelSize;
+
+        MappedFile file(path, header.size() + offsetTableSize + blockSize * height);
+        uint8_t* data = file.getData();
+        std::memcpy(data, header.data(), header.size());
+
+        std::vector<float> row(size_t(width) * 3);
+        for (uint32_t y = 0; y < height; y++) {
+            const size_t blockOffset = header.size() + offsetTableSize + y * blockSize;
+            storeLittleEndian(data + header.size() + y * sizeof(uint64_t), blockOffset, 8);
+
+            uint8_t* block = data + blockOffset;
+            storeLittleEndian(block, y, 4);
+            storeLittleEndian(block + 4, 3 * channelSize, 4);
+
+            getRow(y, row.data());
+            storeFloats(block + 8, row.data() + 2, width, 3);
+            storeFloats(block + 8 + channelSize, row.data() + 1, width, 3);
+            storeFloats(block + 8 + 2 * channelSize, row.data(), width, 3);
+        }
+    }
+}
+
+HdrImageFormat getHdrImageFormat(const std::string &path) {
+    return path.ends_with(".exr") ? HdrImageFormat::EXR : HdrImageFormat::PFM;
+}
+
+void writeHdrImage(const std::string &path, uint32_t width, uint32_t height, const HdrRowFunction &getRow) {
+    if (getHdrImageFormat(path) == HdrImageFormat::EXR) {
+        writeExr(path, width, height, getRow);
+    } else {
+        writePfm(path, width, height, getRow);
+    }
+}
+
+std::vector<uint8_t> convertToRenderTargetPixels(const std::vector<float> &rgb) {
+    std::vector<uint8_t> pixels(rgb.size() / 3 * 4, 255);
+
+    for (size_t pixel = 0; pixel < rgb.size() / 3; pixel++) {
+        for (size_t channel = 0; channel < 3; channel++) {
+            const float color = std::clamp(std::sqrt(rgb[pixel * 3 + channel]), 0.0f, 1.0f);
+            pixels[pixel * 4 + channel] = static_cast<uint8_t>(color * 255.0f + 0.5f);
+        }
+    }
+
+    return pixels;
+}
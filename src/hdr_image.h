@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class HdrImageFormat {
+    PFM, // portable float map, RGB 32-bit floats
+    EXR // OpenEXR scan lines of uncompressed 32-bit float R, G and B channels
+};
+
+// fills a row of linear RGB values (width * 3 floats), rows are counted from the top
+using HdrRowFunction = std::function<void(uint32_t y, float* rgb)>;
+
+// ".exr" files are written as OpenEXR, everything else as PFM
+[[nodiscard]] HdrImageFormat getHdrImageFormat(const std::string &path);
+
+// the rows are requested one at a time and copied into the memory-mapped file, so the image is never held in memory
+void writeHdrImage(const std::string &path, uint32_t width, uint32_t height, const HdrRowFunction &getRow);
+
+// linear RGB colors to RGBA8 pixels with the gamma correction and rounding of the render target
+[[nodiscard]] std::vector<uint8_t> convertToRenderTargetPixels(const std::vector<float> &rgb);
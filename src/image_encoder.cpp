@@ -0,0 +1,635 @@
+#include "image_encoder.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+// PNG: every strip is filtered and compressed on its own into an IDAT chunk. The deflate blocks of a strip end on a
+// byte boundary (with an empty stored block), so the strips concatenate to a single zlib stream whose Adler-32 checksum
+// is combined from the checksums of the strips. Matches never reach into the strip above, which costs little.
+//
+// QOI: the encoder state at the start of a strip (the previous pixel and the last pixel of every hash) only depends on
+// the pixels above it, so it is gathered in a first parallel pass and the strips are encoded in a second one.
+
+namespace {
+    const uint32_t ADLER_BASE = 65521;
+
+    // the deflate symbols of the lengths 3 to 258 and distances 1 to 32768, starting at 257 and 0
+    const std::array<uint32_t, 29> LENGTH_BASES = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195,
+            227, 258
+    };
+    const std::array<uint32_t, 29> LENGTH_EXTRA_BITS = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    const std::array<uint32_t, 30> DISTANCE_BASES = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577
+    };
+    const std::array<uint32_t, 30> DISTANCE_EXTRA_BITS = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+
+    const uint32_t WINDOW_SIZE = 32768;
+    const uint32_t MAX_MATCH_LENGTH = 258;
+    const uint32_t HASH_BITS = 15;
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t> &output) : output(output) {}
+
+        // least significant bit first
+        void write(uint32_t bits, uint32_t count) {
+            buffer |= uint64_t(bits) << bitCount;
+            bitCount += count;
+
+            while (bitCount >= 8) {
+                output.push_back(static_cast<uint8_t>(buffer));
+                buffer >>= 8;
+                bitCount -= 8;
+            }
+        }
+
+        // Huffman codes are stored most significant bit first
+        void writeHuffman(uint32_t code, uint32_t length) {
+            uint32_t reversed = 0;
+            for (uint32_t i = 0; i < length; i++) {
+                reversed |= ((code >> i) & 1) << (length - 1 - i);
+            }
+
+            write(reversed, length);
+        }
+
+        void alignToByte() {
+            if (bitCount > 0) {
+                write(0, 8 - bitCount);
+            }
+        }
+
+        // only after alignToByte
+        void writeBytes(const uint8_t* data, size_t size) {
+            output.insert(output.end(), data, data + size);
+        }
+
+    private:
+        std::vector<uint8_t> &output;
+        uint64_t buffer = 0;
+        uint32_t bitCount = 0;
+    };
+
+    void writeFixedLiteral(BitWriter &bits, uint32_t symbol) {
+        if (symbol < 144) {
+            bits.writeHuffman(0x30 + symbol, 8);
+        } else if (symbol < 256) {
+            bits.writeHuffman(0x190 + symbol - 144, 9);
+        } else if (symbol < 280) {
+            bits.writeHuffman(symbol - 256, 7);
+        } else {
+            bits.writeHuffman(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    void writeFixedMatch(BitWriter &bits, uint32_t length, uint32_t distance) {
+        const size_t lengthCode = std::upper_bound(LENGTH_BASES.begin(), LENGTH_BASES.end(), length) -
+                                  LENGTH_BASES.begin() - 1;
+        writeFixedLiteral(bits, 257 + static_cast<uint32_t>(lengthCode));
+        bits.write(length - LENGTH_BASES[lengthCode], LENGTH_EXTRA_BITS[lengthCode]);
+
+        const size_t distanceCode = std::upper_bound(DISTANCE_BASES.begin(), DISTANCE_BASES.end(), distance) -
+                                    DISTANCE_BASES.begin() - 1;
+        bits.writeHuffman(static_cast<uint32_t>(distanceCode), 5);
+        bits.write(distance - DISTANCE_BASES[distanceCode], DISTANCE_EXTRA_BITS[distanceCode]);
+    }
+
+    uint32_t hashBytes(const uint8_t* data) {
+        return ((uint32_t(data[0]) << 16 | uint32_t(data[1]) << 8 | data[2]) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // a non-final block with the fixed Huffman codes, the longer the hash chains the better the compression
+    void deflateFixedBlock(BitWriter &bits, const uint8_t* data, size_t size, uint32_t maxChainLength) {
+        std::vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+        std::vector<int32_t> previous(size);
+
+        const auto insert = [&](size_t position) {
+            const uint32_t hash = hashBytes(data + position);
+            previous[position] = head[hash];
+            head[hash] = static_cast<int32_t>(position);
+        };
+
+        bits.write(0, 1);
+        bits.write(1, 2);
+
+        size_t position = 0;
+        while (position < size) {
+            uint32_t bestLength = 0, bestDistance = 0;
+
+            if (position + 3 <= size) {
+                const uint32_t maxLength = static_cast<uint32_t>(std::min<size_t>(MAX_MATCH_LENGTH, size - position));
+                int32_t candidate = head[hashBytes(data + position)];
+
+                for (uint32_t chain = 0; candidate >= 0 && chain < maxChainLength; chain++) {
+                    const uint32_t distance = static_cast<uint32_t>(position - candidate);
+                    if (distance > WINDOW_SIZE)
+                        break;
+
+                    uint32_t length = 0;
+                    while (length < maxLength && data[candidate + length] == data[position + length]) {
+                        length++;
+                    }
+
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+
+                        if (length == maxLength)
+                            break;
+                    }
+
+                    candidate = previous[candidate];
+                }
+
+                insert(position);
+            }
+
+            if (bestLength >= 3) {
+                writeFixedMatch(bits, bestLength, bestDistance);
+
+                for (size_t skipped = position + 1; skipped < position + bestLength && skipped + 3 <= size; skipped++) {
+                    insert(skipped);
+                }
+
+                position += bestLength;
+            } else {
+                writeFixedLiteral(bits, data[position]);
+                position++;
+            }
+        }
+
+        // end of block, followed by an empty stored block to end on a byte boundary
+        writeFixedLiteral(bits, 256);
+        bits.write(0, 3);
+        bits.alignToByte();
+        bits.write(0x0000, 16);
+        bits.write(0xFFFF, 16);
+    }
+
+    void deflateStoredBlocks(BitWriter &bits, const uint8_t* data, size_t size) {
+        for (size_t offset = 0; offset < size; offset += 0xFFFF) {
+            const uint32_t length = static_cast<uint32_t>(std::min<size_t>(0xFFFF, size - offset));
+
+            bits.write(0, 3);
+            bits.alignToByte();
+            bits.write(length, 16);
+            bits.write(~length & 0xFFFF, 16);
+
+            bits.writeBytes(data + offset, length);
+        }
+    }
+
+    uint32_t calculateAdler32(const uint8_t* data, size_t size) {
+        uint32_t a = 1, b = 0;
+
+        // the sums can't overflow within 5552 bytes
+        while (size > 0) {
+            const size_t blockSize = std::min<size_t>(size, 5552);
+
+            for (size_t i = 0; i < blockSize; i++) {
+                a += data[i];
+                b += a;
+            }
+
+            a %= ADLER_BASE;
+            b %= ADLER_BASE;
+            data += blockSize;
+            size -= blockSize;
+        }
+
+        return b << 16 | a;
+    }
+
+    // the checksum of two concatenated parts, from the checksums of both and the size of the second one
+    uint32_t combineAdler32(uint32_t first, uint32_t second, size_t secondSize) {
+        const uint32_t remainder = static_cast<uint32_t>(secondSize % ADLER_BASE);
+
+        uint32_t a = first & 0xFFFF;
+        uint32_t b = static_cast<uint32_t>((uint64_t(remainder) * a) % ADLER_BASE);
+        a += (second & 0xFFFF) + ADLER_BASE - 1;
+        b += (first >> 16) + (second >> 16) + ADLER_BASE - remainder;
+
+        if (a >= ADLER_BASE) a -= ADLER_BASE;
+        if (a >= ADLER_BASE) a -= ADLER_BASE;
+        if (b >= ADLER_BASE * 2) b -= ADLER_BASE * 2;
+        if (b >= ADLER_BASE) b -= ADLER_BASE;
+
+        return b << 16 | a;
+    }
+
+    uint32_t calculateCrc32(const uint8_t* data, size_t size) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> entries = {};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void appendBigEndian(std::vector<uint8_t> &output, uint32_t value) {
+        output.push_back(static_cast<uint8_t>(value >> 24));
+        output.push_back(static_cast<uint8_t>(value >> 16));
+        output.push_back(static_cast<uint8_t>(value >> 8));
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    // the data of the chunk follows its 8 byte header in the output
+    void finishPngChunk(std::vector<uint8_t> &chunk) {
+        const uint32_t dataSize = static_cast<uint32_t>(chunk.size() - 8);
+        for (int i = 0; i < 4; i++) {
+            chunk[i] = static_cast<uint8_t>(dataSize >> (24 - 8 * i));
+        }
+
+        appendBigEndian(chunk, calculateCrc32(chunk.data() + 4, chunk.size() - 4));
+    }
+
+    // the size is filled in by finishPngChunk
+    std::vector<uint8_t> beginPngChunk(const char* type) {
+        return {0, 0, 0, 0, uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3])};
+    }
+
+    void writeBytes(std::ofstream &file, const std::vector<uint8_t> &bytes) {
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    uint8_t predictPaeth(int left, int above, int aboveLeft) {
+        const int estimate = left + above - aboveLeft;
+        const int distanceLeft = std::abs(estimate - left);
+        const int distanceAbove = std::abs(estimate - above);
+        const int distanceAboveLeft = std::abs(estimate - aboveLeft);
+
+        if (distanceLeft <= distanceAbove && distanceLeft <= distanceAboveLeft)
+            return static_cast<uint8_t>(left);
+        if (distanceAbove <= distanceAboveLeft)
+            return static_cast<uint8_t>(above);
+        return static_cast<uint8_t>(aboveLeft);
+    }
+
+    // writes the filter type followed by the filtered row, the row above is null for the first row of the image
+    void filterPngRow(const uint8_t* row, const uint8_t* above, size_t rowSize, uint8_t filter, uint8_t* output) {
+        const size_t pixelSize = 4;
+        output[0] = filter;
+
+        for (size_t i = 0; i < rowSize; i++) {
+            const int left = i >= pixelSize ? row[i - pixelSize] : 0;
+            const int up = above ? above[i] : 0;
+            const int upLeft = above && i >= pixelSize ? above[i - pixelSize] : 0;
+
+            int prediction = 0;
+            switch (filter) {
+                case 1:
+                    prediction = left;
+                    break;
+                case 2:
+                    prediction = up;
+                    break;
+                case 3:
+                    prediction = (left + up) / 2;
+                    break;
+                case 4:
+                    prediction = predictPaeth(left, up, upLeft);
+                    break;
+                default:
+                    break;
+            }
+
+            output[1 + i] = static_cast<uint8_t>(row[i] - prediction);
+        }
+    }
+
+    // the usual heuristic: the filter with the smallest sum of the filtered bytes as signed values
+    void filterPngRowAdaptively(const uint8_t* row, const uint8_t* above, size_t rowSize, uint8_t* output,
+                                std::vector<uint8_t> &candidate) {
+        uint64_t bestSum = UINT64_MAX;
+
+        for (uint8_t filter = 0; filter <= 4; filter++) {
+            filterPngRow(row, above, rowSize, filter, candidate.data());
+
+            uint64_t sum = 0;
+            for (size_t i = 1; i <= rowSize; i++) {
+                sum += std::abs(static_cast<int8_t>(candidate[i]));
+            }
+
+            if (sum < bestSum) {
+                bestSum = sum;
+                std::copy(candidate.begin(), candidate.end(), output);
+            }
+        }
+    }
+
+    struct PngStrip {
+        std::vector<uint8_t> chunk; // a whole IDAT chunk
+        uint32_t adler32;
+        size_t filteredSize;
+    };
+
+    void encodePngStrip(PngStrip &strip, const uint8_t* pixels, uint32_t width, uint32_t firstRow, uint32_t rowCount,
+                        uint32_t compressionLevel) {
+        const size_t rowSize = size_t(width) * 4;
+        std::vector<uint8_t> filtered((rowSize + 1) * rowCount);
+        std::vector<uint8_t> candidate(rowSize + 1);
+
+        for (uint32_t i = 0; i < rowCount; i++) {
+            const uint32_t y = firstRow + i;
+            const uint8_t* row = pixels + y * rowSize;
+            const uint8_t* above = y > 0 ? row - rowSize : nullptr;
+            uint8_t* output = filtered.data() + i * (rowSize + 1);
+
+            // filtering only pays off when the result is compressed
+            if (compressionLevel == 0) {
+                filterPngRow(row, above, rowSize, 0, output);
+            } else {
+                filterPngRowAdaptively(row, above, rowSize, output, candidate);
+            }
+        }
+
+        strip.chunk = beginPngChunk("IDAT");
+        strip.chunk.reserve(filtered.size() / (compressionLevel == 0 ? 1 : 2) + 64);
+
+        BitWriter bits(strip.chunk);
+        if (compressionLevel == 0) {
+            deflateStoredBlocks(bits, filtered.data(), filtered.size());
+        } else {
+            deflateFixedBlock(bits, filtered.data(), filtered.size(), 1u << (compressionLevel + 1));
+        }
+
+        finishPngChunk(strip.chunk);
+
+        strip.adler32 = calculateAdler32(filtered.data(), filtered.size());
+        strip.filteredSize = filtered.size();
+    }
+
+    struct QoiPixel {
+        uint8_t r, g, b, a;
+
+        bool operator==(const QoiPixel &other) const = default;
+
+        [[nodiscard]] uint32_t getHash() const {
+            return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+        }
+    };
+
+    struct QoiState {
+        QoiPixel previous = {.r = 0, .g = 0, .b = 0, .a = 255};
+        std::array<QoiPixel, 64> index = {};
+        std::array<bool, 64> isIndexed = {}; // only used while gathering the state
+    };
+
+    void encodeQoiStrip(std::vector<uint8_t> &output, const QoiPixel* pixels, size_t pixelCount, QoiState state) {
+        output.reserve(pixelCount * 2);
+        uint32_t run = 0;
+
+        for (size_t i = 0; i < pixelCount; i++) {
+            const QoiPixel pixel = pixels[i];
+
+            if (pixel == state.previous) {
+                run++;
+
+                // runs end at the end of the strip, the next strip starts a new one
+                if (run == 62 || i + 1 == pixelCount) {
+                    output.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+                    run = 0;
+                }
+
+                continue;
+            }
+
+            if (run > 0) {
+                output.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+                run = 0;
+            }
+
+            const uint32_t hash = pixel.getHash();
+
+            if (state.index[hash] == pixel) {
+                output.push_back(static_cast<uint8_t>(hash));
+            } else if (pixel.a == state.previous.a) {
+                state.index[hash] = pixel;
+
+                const int8_t dr = static_cast<int8_t>(pixel.r - state.previous.r);
+                const int8_t dg = static_cast<int8_t>(pixel.g - state.previous.g);
+                const int8_t db = static_cast<int8_t>(pixel.b - state.previous.b);
+                const int drDg = dr - dg, dbDg = db - dg;
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    output.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                } else if (drDg >= -8 && drDg <= 7 && dg >= -32 && dg <= 31 && dbDg >= -8 && dbDg <= 7) {
+                    output.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+                    output.push_back(static_cast<uint8_t>((drDg + 8) << 4 | (dbDg + 8)));
+                } else {
+                    output.insert(output.end(), {0xFE, pixel.r, pixel.g, pixel.b});
+                }
+            } else {
+                state.index[hash] = pixel;
+                output.insert(output.end(), {0xFF, pixel.r, pixel.g, pixel.b, pixel.a});
+            }
+
+            state.previous = pixel;
+        }
+    }
+}
+
+ImageEncoder::ImageEncoder(uint32_t threadCount) : threadPool(threadCount) {}
+
+ImageFormat ImageEncoder::getImageFormat(const std::string &path) {
+    return path.ends_with(".qoi") ? ImageFormat::QOI : ImageFormat::PNG;
+}
+
+void ImageEncoder::write(const std::string &path, const uint8_t* pixels, uint32_t width, uint32_t height,
+                         uint32_t pngCompressionLevel) {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    if (getImageFormat(path) == ImageFormat::QOI) {
+        writeQoi(file, pixels, width, height);
+    } else {
+        writePng(file, pixels, width, height, std::min(pngCompressionLevel, 9u));
+    }
+
+    if (!file.good())
+        throw std::runtime_error("[Error] Failed to write file at '" + path + "'!");
+}
+
+uint32_t ImageEncoder::getThreadCount() const {
+    return threadPool.getThreadCount();
+}
+
+uint32_t ImageEncoder::getStripHeight(uint32_t height) const {
+    // a few strips per thread balance the load, too small strips would compress worse
+    const uint32_t stripCount = 4 * threadPool.getThreadCount();
+    return std::max((height + stripCount - 1) / stripCount, 16u);
+}
+
+void ImageEncoder::writePng(std::ofstream &file, const uint8_t* pixels, uint32_t width, uint32_t height,
+                            uint32_t compressionLevel) {
+    const uint32_t stripHeight = getStripHeight(height);
+    const uint32_t stripCount = (height + stripHeight - 1) / stripHeight;
+
+    std::vector<PngStrip> strips(stripCount);
+    std::vector<std::future<void>> encodedStrips;
+
+    for (uint32_t i = 0; i < stripCount; i++) {
+        const uint32_t firstRow = i * stripHeight;
+        const uint32_t rowCount = std::min(stripHeight, height - firstRow);
+
+        encodedStrips.push_back(threadPool.submit([&, i, firstRow, rowCount] {
+            encodePngStrip(strips[i], pixels, width, firstRow, rowCount, compressionLevel);
+        }));
+    }
+
+    // the strips reference the pixels and each other, so all of them have to finish before anything is thrown
+    const auto waitForStrips = [&] {
+        for (std::future<void> &encodedStrip: encodedStrips) {
+            if (encodedStrip.valid()) {
+                encodedStrip.wait();
+            }
+        }
+    };
+
+    try {
+        const std::vector<uint8_t> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        writeBytes(file, signature);
+
+        // 8 bits per channel, RGBA, no interlacing
+        std::vector<uint8_t> header = beginPngChunk("IHDR");
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+        finishPngChunk(header);
+        writeBytes(file, header);
+
+        // zlib header with a 32 KiB window
+        std::vector<uint8_t> zlibHeader = beginPngChunk("IDAT");
+        zlibHeader.insert(zlibHeader.end(), {0x78, 0x01});
+        finishPngChunk(zlibHeader);
+        writeBytes(file, zlibHeader);
+
+        uint32_t adler32 = 1;
+        for (uint32_t i = 0; i < stripCount; i++) {
+            encodedStrips[i].get();
+            writeBytes(file, strips[i].chunk);
+
+            adler32 = combineAdler32(adler32, strips[i].adler32, strips[i].filteredSize);
+            strips[i].chunk = {};
+        }
+
+        // an empty final block with the fixed Huffman codes
+        std::vector<uint8_t> zlibTrailer = beginPngChunk("IDAT");
+        zlibTrailer.insert(zlibTrailer.end(), {0x03, 0x00});
+        appendBigEndian(zlibTrailer, adler32);
+        finishPngChunk(zlibTrailer);
+        writeBytes(file, zlibTrailer);
+
+        std::vector<uint8_t> end = beginPngChunk("IEND");
+        finishPngChunk(end);
+        writeBytes(file, end);
+    } catch (...) {
+        waitForStrips();
+        throw;
+    }
+}
+
+void ImageEncoder::writeQoi(std::ofstream &file, const uint8_t* pixels, uint32_t width, uint32_t height) {
+    const uint32_t stripHeight = getStripHeight(height);
+    const uint32_t stripCount = (height + stripHeight - 1) / stripHeight;
+    const size_t stripPixels = size_t(width) * stripHeight;
+    const size_t pixelCount = size_t(width) * height;
+
+    static_assert(sizeof(QoiPixel) == 4);
+    const auto* qoiPixels = reinterpret_cast<const QoiPixel*>(pixels);
+
+    // the last pixel of every hash within each strip
+    std::vector<QoiState> states(stripCount);
+    std::vector<std::future<void>> tasks;
+
+    for (uint32_t i = 0; i < stripCount; i++) {
+        tasks.push_back(threadPool.submit([&, i] {
+            const size_t end = std::min(pixelCount, (i + 1) * stripPixels);
+            for (size_t pixel = i * stripPixels; pixel < end; pixel++) {
+                const uint32_t hash = qoiPixels[pixel].getHash();
+                states[i].index[hash] = qoiPixels[pixel];
+                states[i].isIndexed[hash] = true;
+            }
+        }));
+    }
+
+    const auto waitForTasks = [&] {
+        for (std::future<void> &task: tasks) {
+            if (task.valid()) {
+                task.wait();
+            }
+        }
+    };
+
+    try {
+        for (std::future<void> &task: tasks) {
+            task.get();
+        }
+
+        // the state at the start of a strip is the one of the previous strip, updated by the pixels of that strip
+        QoiState state;
+        for (uint32_t i = 0; i < stripCount; i++) {
+            const QoiState stripPixelsState = states[i];
+            states[i] = state;
+
+            for (uint32_t hash = 0; hash < 64; hash++) {
+                if (stripPixelsState.isIndexed[hash]) {
+                    state.index[hash] = stripPixelsState.index[hash];
+                }
+            }
+
+            state.previous = qoiPixels[std::min(pixelCount, (i + 1) * stripPixels) - 1];
+        }
+
+        std::vector<std::vector<uint8_t>> strips(stripCount);
+        tasks.clear();
+
+        for (uint32_t i = 0; i < stripCount; i++) {
+            tasks.push_back(threadPool.submit([&, i] {
+                const size_t begin = i * stripPixels;
+                encodeQoiStrip(strips[i], qoiPixels + begin, std::min(pixelCount - begin, stripPixels), states[i]);
+            }));
+        }
+
+        // width, height, 4 channels, sRGB with linear alpha
+        std::vector<uint8_t> header = {'q', 'o', 'i', 'f'};
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        header.insert(header.end(), {4, 0});
+        writeBytes(file, header);
+
+        for (uint32_t i = 0; i < stripCount; i++) {
+            tasks[i].get();
+            writeBytes(file, strips[i]);
+            strips[i] = {};
+        }
+
+        writeBytes(file, {0, 0, 0, 0, 0, 0, 0, 1});
+    } catch (...) {
+        waitForTasks();
+        throw;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include "thread_pool.h"
+
+enum class ImageFormat {
+    PNG, // fixed Huffman deflate, or stored (uncompressed) at compression level 0
+    QOI // https://qoiformat.org, much faster to encode than PNG at a slightly bigger size
+};
+
+
+// Encodes RGBA8 images in strips of rows on a thread pool. Every strip is written to the file as soon as it and all
+// strips above it are encoded, so writing overlaps with encoding and only the encoded strips are kept in memory.
+class ImageEncoder {
+public:
+    explicit ImageEncoder(uint32_t threadCount); // 0: one thread per hardware thread
+
+    // ".qoi" files are written as QOI, everything else as PNG
+    [[nodiscard]] static ImageFormat getImageFormat(const std::string &path);
+
+    // the rows of the pixels are tightly packed, the compression level (0 to 9) only applies to PNG
+    void write(const std::string &path, const uint8_t* pixels, uint32_t width, uint32_t height,
+               uint32_t pngCompressionLevel = 6);
+
+    [[nodiscard]] uint32_t getThreadCount() const;
+
+private:
+    ThreadPool threadPool;
+
+    [[nodiscard]] uint32_t getStripHeight(uint32_t height) const;
+
+    void writePng(std::ofstream &file, const uint8_t* pixels, uint32_t width, uint32_t height,
+                  uint32_t compressionLevel);
+
+    void writeQoi(std::ofstream &file, const uint8_t* pixels, uint32_t width, uint32_t height);
+};
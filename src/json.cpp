@@ -0,0 +1,357 @@
+#include "json.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+    class JsonParser {
+    public:
+        explicit JsonParser(std::string_view text) : text(text) {}
+
+        JsonValue parseDocument() {
+            JsonValue value = parseValue();
+            skipWhitespace();
+
+            if (position != text.size())
+                fail("unexpected text after the value");
+
+            return value;
+        }
+
+    private:
+        std::string_view text;
+        size_t position = 0;
+
+        [[noreturn]] void fail(const std::string &reason) const {
+            throw std::runtime_error("Invalid JSON at offset " + std::to_string(position) + ": " + reason + "!");
+        }
+
+        void skipWhitespace() {
+            const std::string_view whitespace = " \t\n\r";
+
+            while (position < text.size() && whitespace.find(text[position]) != std::string_view::npos) {
+                position++;
+            }
+        }
+
+        bool consume(std::string_view token) {
+            if (text.substr(position, token.size()) != token)
+                return false;
+
+            position += token.size();
+            return true;
+        }
+
+        void expect(char character) {
+            skipWhitespace();
+
+            if (position >= text.size() || text[position] != character)
+                fail(std::string("expected '") + character + "'");
+
+            position++;
+        }
+
+        JsonValue parseValue() {
+            skipWhitespace();
+
+            if (position >= text.size())
+                fail("unexpected end");
+
+            switch (text[position]) {
+                case '{':
+                    return parseObject();
+                case '[':
+                    return parseArray();
+                case '"':
+                    return parseString();
+                default:
+                    break;
+            }
+
+            if (consume("true"))
+                return true;
+            if (consume("false"))
+                return false;
+            if (consume("null"))
+                return {};
+
+            return parseNumber();
+        }
+
+        JsonValue parseObject() {
+            JsonValue::Object object;
+            expect('{');
+            skipWhitespace();
+
+            if (consume("}"))
+                return object;
+
+            do {
+                skipWhitespace();
+                if (position >= text.size() || text[position] != '"')
+                    fail("expected a member name");
+
+                std::string key = parseString();
+                expect(':');
+                object.emplace_back(std::move(key), parseValue());
+                skipWhitespace();
+            } while (consume(","));
+
+            expect('}');
+            return object;
+        }
+
+        JsonValue parseArray() {
+            JsonValue::Array array;
+            expect('[');
+            skipWhitespace();
+
+            if (consume("]"))
+                return array;
+
+            do {
+                array.push_back(parseValue());
+                skipWhitespace();
+            } while (consume(","));
+
+            expect(']');
+            return array;
+        }
+
+        // only the escapes the writer produces and the common ones, \u only for ASCII
+        std::string parseString() {
+            std::string string;
+            position++;
+
+            while (true) {
+                if (position >= text.size())
+                    fail("unterminated string");
+
+                const char character = text[position++];
+                if (character == '"')
+                    return string;
+
+                if (character != '\\') {
+                    string += character;
+                    continue;
+                }
+
+                if (position >= text.size())
+                    fail("unterminated string");
+
+                const char escaped = text[position++];
+                switch (escaped) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        string += escaped;
+                        break;
+                    case 'n':
+                        string += '\n';
+                        break;
+                    case 't':
+                        string += '\t';
+                        break;
+                    case 'r':
+                        string += '\r';
+                        break;
+                    case 'u': {
+                        uint32_t code = 0;
+                        const auto [end, error] = std::from_chars(text.data() + position,
+                                                                  text.data() + std::min(position + 4, text.size()),
+                                                                  code, 16);
+                        if (error != std::errc() || end != text.data() + position + 4 || code > 0x7F)
+                            fail("unsupported \\u escape");
+
+                        string += static_cast<char>(code);
+                        position += 4;
+                        break;
+                    }
+                    default:
+                        fail("unsupported escape");
+                }
+            }
+        }
+
+        JsonValue parseNumber() {
+            double number = 0.0;
+            const auto [end, error] = std::from_chars(text.data() + position, text.data() + text.size(), number);
+
+            if (error != std::errc() || end == text.data() + position)
+                fail("expected a value");
+
+            position = end - text.data();
+            return number;
+        }
+    };
+
+    void writeString(std::ostream &stream, const std::string &string) {
+        stream << '"';
+
+        for (const char character: string) {
+            switch (character) {
+                case '"':
+                    stream << "\\\"";
+                    break;
+                case '\\':
+                    stream << "\\\\";
+                    break;
+                case '\n':
+                    stream << "\\n";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(character) < 0x20) {
+                        const char hex[] = "0123456789abcdef";
+                        stream << "\\u00" << hex[character >> 4] << hex[character & 0xF];
+                    } else {
+                        stream << character;
+                    }
+            }
+        }
+
+        stream << '"';
+    }
+
+    void writeLineBreak(std::ostream &stream, uint32_t depth) {
+        stream << '\n' << std::string(depth * 2, ' ');
+    }
+}
+
+JsonValue::JsonValue(bool value) : value(value) {}
+
+JsonValue::JsonValue(double value) : value(value) {}
+
+JsonValue::JsonValue(int value) : value(double(value)) {}
+
+JsonValue::JsonValue(uint32_t value) : value(double(value)) {}
+
+JsonValue::JsonValue(uint64_t value) : value(double(value)) {}
+
+JsonValue::JsonValue(const char* value) : value(std::string(value)) {}
+
+JsonValue::JsonValue(std::string value) : value(std::move(value)) {}
+
+JsonValue::JsonValue(Array value) : value(std::move(value)) {}
+
+JsonValue::JsonValue(Object value) : value(std::move(value)) {}
+
+JsonValue JsonValue::parse(std::string_view text) {
+    return JsonParser(text).parseDocument();
+}
+
+bool JsonValue::isNull() const {
+    return std::holds_alternative<std::monostate>(value);
+}
+
+bool JsonValue::isNumber() const {
+    return std::holds_alternative<double>(value);
+}
+
+bool JsonValue::asBool() const {
+    if (!std::holds_alternative<bool>(value))
+        throw std::runtime_error("JSON value is not a boolean!");
+
+    return std::get<bool>(value);
+}
+
+double JsonValue::asNumber() const {
+    if (!isNumber())
+        throw std::runtime_error("JSON value is not a number!");
+
+    return std::get<double>(value);
+}
+
+const std::string &JsonValue::asString() const {
+    if (!std::holds_alternative<std::string>(value))
+        throw std::runtime_error("JSON value is not a string!");
+
+    return std::get<std::string>(value);
+}
+
+const JsonValue::Array &JsonValue::asArray() const {
+    if (!std::holds_alternative<Array>(value))
+        throw std::runtime_error("JSON value is not an array!");
+
+    return std::get<Array>(value);
+}
+
+const JsonValue::Object &JsonValue::asObject() const {
+    if (!std::holds_alternative<Object>(value))
+        throw std::runtime_error("JSON value is not an object!");
+
+    return std::get<Object>(value);
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const {
+    static const JsonValue null;
+
+    if (!std::holds_alternative<Object>(value))
+        return null;
+
+    for (const auto &[memberKey, member]: std::get<Object>(value)) {
+        if (memberKey == key)
+            return member;
+    }
+
+    return null;
+}
+
+void JsonValue::write(std::ostream &stream, uint32_t lineBreakDepth) const {
+    write(stream, lineBreakDepth, 0);
+    stream << '\n';
+}
+
+void JsonValue::write(std::ostream &stream, uint32_t lineBreakDepth, uint32_t depth) const {
+    const bool lineBreaks = depth < lineBreakDepth;
+
+    if (isNull()) {
+        stream << "null";
+
+    } else if (std::holds_alternative<bool>(value)) {
+        stream << (std::get<bool>(value) ? "true" : "false");
+
+    } else if (isNumber()) {
+        // the shortest text that parses back to the same number, JSON has no infinity or NaN
+        const double number = std::get<double>(value);
+        char text[32];
+
+        if (std::isfinite(number)) {
+            stream.write(text, std::to_chars(text, text + sizeof(text), number).ptr - text);
+        } else {
+            stream << "null";
+        }
+
+    } else if (std::holds_alternative<std::string>(value)) {
+        writeString(stream, std::get<std::string>(value));
+
+    } else if (std::holds_alternative<Array>(value)) {
+        const Array &array = std::get<Array>(value);
+        stream << '[';
+
+        for (size_t i = 0; i < array.size(); i++) {
+            stream << (i == 0 ? "" : lineBreaks ? "," : ", ");
+            if (lineBreaks) writeLineBreak(stream, depth + 1);
+            array[i].write(stream, lineBreakDepth, depth + 1);
+        }
+
+        if (lineBreaks && !array.empty()) writeLineBreak(stream, depth);
+        stream << ']';
+
+    } else {
+        const Object &object = std::get<Object>(value);
+        stream << '{';
+
+        for (size_t i = 0; i < object.size(); i++) {
+            stream << (i == 0 ? "" : lineBreaks ? "," : ", ");
+            if (lineBreaks) writeLineBreak(stream, depth + 1);
+            writeString(stream, object[i].first);
+            stream << ": ";
+            object[i].second.write(stream, lineBreakDepth, depth + 1);
+        }
+
+        if (lineBreaks && !object.empty()) writeLineBreak(stream, depth);
+        stream << '}';
+    }
+}
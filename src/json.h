@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// A JSON document as written and read by the benchmark. Objects keep the order of their members.
+class JsonValue {
+public:
+    using Array = std::vector<JsonValue>;
+    using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+    JsonValue() = default; // null
+
+    JsonValue(bool value);
+
+    JsonValue(double value);
+
+    JsonValue(int value);
+
+    JsonValue(uint32_t value);
+
+    JsonValue(uint64_t value);
+
+    JsonValue(const char* value);
+
+    JsonValue(std::string value);
+
+    JsonValue(Array value);
+
+    JsonValue(Object value);
+
+    // throws if the text isn't a single valid JSON value
+    [[nodiscard]] static JsonValue parse(std::string_view text);
+
+    [[nodiscard]] bool isNull() const;
+
+    [[nodiscard]] bool isNumber() const;
+
+    // the accessors throw if the value has a different type
+    [[nodiscard]] bool asBool() const;
+
+    [[nodiscard]] double asNumber() const;
+
+    [[nodiscard]] const std::string &asString() const;
+
+    [[nodiscard]] const Array &asArray() const;
+
+    [[nodiscard]] const Object &asObject() const;
+
+    // the member of an object with the given key, null if there is none or this isn't an object
+    [[nodiscard]] const JsonValue &operator[](std::string_view key) const;
+
+    // Objects and arrays nested less than lineBreakDepth deep put every member on its own line, deeper ones are
+    // written on a single line, e.g. 2 for an object of arrays with one result object per line.
+    void write(std::ostream &stream, uint32_t lineBreakDepth = 2) const;
+
+private:
+    std::variant<std::monostate, bool, double, std::string, Array, Object> value;
+
+    void write(std::ostream &stream, uint32_t lineBreakDepth, uint32_t depth) const;
+};
@@ -1,60 +1,420 @@
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <thread>
 #include "vulkan.h"
+#include "cpu_renderer.h"
+#include "multi_device_renderer.h"
+#include "distributed.h"
+#include "image_encoder.h"
+#include "hdr_image.h"
+#include "scene_file.h"
+#include "animation.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     // SETUP
     const uint32_t renderCalls = 200;
     const uint32_t samples = 10000;
 
+    bool headless = false;
+    bool autotune = false;
+    bool wavefront = false;
+    bool russianRoulette = false;
+    bool adaptiveSampling = false;
+    bool tiledRendering = false;
+    bool progressive = false;
+    bool cpu = false;
+    bool multiDevice = false;
+    uint32_t devicesPerPhysicalDevice = 1; // e.g. several logical devices on a single software device for testing
+    uint16_t coordinatorPort = 0; // hands out the render calls to workers instead of rendering, 0 for none
+    std::string coordinatorHost; // renders the render calls handed out by this coordinator, empty for none
+    uint16_t workerPort = 0;
+    uint32_t renderCallsPerAssignment = 10; // handed to a worker at once by the coordinator
+    uint32_t snapshotInterval = 0; // render calls between intermediate screenshots, 0 for none
+    uint32_t animationFrames = 0; // renders an orbit around the scene into numbered images instead, 0 for none
+    uint32_t viewCount = 1; // views around the scene rendered by every dispatch, each one written to its own image
+    std::string traceFile;
+    std::string imageExtension = ".png"; // ".qoi" encodes much faster
+    std::string hdrFile; // linear colors as PFM or OpenEXR, in addition to the PNG
+    std::string sceneFilePath; // written by RayTracingGPUSceneConverter, instead of the random scene
+    SceneGeneratorSettings sceneSettings = {.seed = std::random_device()()};
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (std::strcmp(argv[i], "--autotune") == 0) {
+            autotune = true;
+        } else if (std::strcmp(argv[i], "--wavefront") == 0) {
+            wavefront = true;
+        } else if (std::strcmp(argv[i], "--russian-roulette") == 0) {
+            russianRoulette = true;
+        } else if (std::strcmp(argv[i], "--adaptive") == 0) {
+            adaptiveSampling = true;
+        } else if (std::strcmp(argv[i], "--tiled") == 0) {
+            tiledRendering = true;
+        } else if (std::strcmp(argv[i], "--progressive") == 0) {
+            progressive = true;
+        } else if (std::strcmp(argv[i], "--cpu") == 0) {
+            cpu = true;
+        } else if (std::strcmp(argv[i], "--multi-device") == 0) {
+            multiDevice = true;
+        } else if (std::strcmp(argv[i], "--devices-per-gpu") == 0 && i + 1 < argc) {
+            devicesPerPhysicalDevice = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--coordinator") == 0 && i + 1 < argc) {
+            coordinatorPort = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--worker") == 0 && i + 2 < argc) {
+            coordinatorHost = argv[++i];
+            workerPort = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--assignment") == 0 && i + 1 < argc) {
+            renderCallsPerAssignment = static_cast<uint32_t>(std::stoul(argv[++i]));
+
+            if (renderCallsPerAssignment == 0) {
+                std::cout << "An assignment needs at least one render call" << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--snapshots") == 0 && i + 1 < argc) {
+            snapshotInterval = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--animation") == 0 && i + 1 < argc) {
+            animationFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--views") == 0 && i + 1 < argc) {
+            viewCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--qoi") == 0) {
+            imageExtension = ".qoi";
+        } else if (std::strcmp(argv[i], "--hdr") == 0 && i + 1 < argc) {
+            hdrFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            sceneSettings.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            sceneSettings.gridSize = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            sceneSettings.density = std::stof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            sceneFilePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        }
+    }
+
     VulkanSettings settings = {
             .windowWidth = 1920,
             .windowHeight = 1080,
             .computeShaderFile = "shader.comp.spv",
             .computeShaderGroupSizeX = 16,
-            .computeShaderGroupSizeY = 8
+            .computeShaderGroupSizeY = 8,
+            .headless = headless,
+            .devicesPerPhysicalDevice = devicesPerPhysicalDevice,
+            .autotuneWorkgroupSize = autotune,
+            .russianRoulette = russianRoulette,
+            .collectPathStatistics = true,
+            .adaptiveSampling = adaptiveSampling,
+            .tiledRendering = tiledRendering,
+            .progressive = progressive,
+            .viewCount = viewCount,
+            .renderMode = wavefront ? RenderMode::WAVEFRONT : RenderMode::MEGAKERNEL
     };
 
-    Vulkan vulkan(settings, generateRandomScene());
+    // printed, so a scene can be rendered again with --seed
+    if (sceneFilePath.empty() && coordinatorHost.empty()) {
+        std::cout << "Scene seed: " << sceneSettings.seed << std::endl;
+    }
+
+    // DISTRIBUTED RENDERING
+    // the summed colors the workers send back aren't available in the progressive mode or with several views
+    if ((progressive || viewCount > 1) && (coordinatorPort > 0 || !coordinatorHost.empty())) {
+        std::cout << "The progressive mode and multiple views aren't supported by distributed rendering" << std::endl;
+        return 1;
+    }
+
+    // rejected before rendering, the HDR readback only copies the summed colors of a single view
+    if (viewCount > 1 && !hdrFile.empty()) {
+        std::cout << "HDR images aren't supported with multiple views" << std::endl;
+        return 1;
+    }
+
+    if (coordinatorPort > 0) {
+        const auto beginTime = std::chrono::steady_clock::now();
+
+        const CoordinatorResult result = runCoordinator(
+                {
+                        .port = coordinatorPort,
+                        .job = {
+                                .width = settings.windowWidth,
+                                .height = settings.windowHeight,
+                                .totalRenderCalls = renderCalls,
+                                .totalSamples = samples,
+                                .maxDepth = settings.maxDepth,
+                                .useBvh = settings.useBvh,
+                                .russianRoulette = settings.russianRoulette,
+                                .russianRouletteMinDepth = settings.russianRouletteMinDepth,
+                                .scene = sceneSettings
+                        },
+                        .renderCallsPerAssignment = renderCallsPerAssignment
+                });
+
+        auto renderTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - beginTime).count();
+        std::cout << "Rendering completed: " << samples << " samples rendered in " << renderTime << " ms by "
+                  << result.workerCount << " worker(s), " << result.droppedWorkerCount << " dropped out" << std::endl;
+
+        const std::vector<uint8_t> pixels = convertToRenderTargetPixels(result.colors);
+        ImageEncoder(settings.encoderThreads).write("render" + imageExtension, pixels.data(), settings.windowWidth,
+                                                    settings.windowHeight, settings.pngCompressionLevel);
+        std::cout << "Screenshot saved" << std::endl;
+
+        if (!hdrFile.empty()) {
+            writeHdrImage(hdrFile, settings.windowWidth, settings.windowHeight, [&](uint32_t y, float* rgb) {
+                std::copy_n(&result.colors[size_t(y) * settings.windowWidth * 3], settings.windowWidth * 3, rgb);
+            });
+            std::cout << "HDR image saved to " << hdrFile << std::endl;
+        }
+
+        return 0;
+    }
+
+    // only mapped for rendering locally, the workers render the scene of the job
+    std::optional<SceneFile> sceneFile;
+
+    // the Vulkan renderer (on all devices with --multi-device), or the CPU renderer with --cpu or without a device
+    const RendererFactory createRenderer = [&](const VulkanSettings &rendererSettings,
+                                               const Scene &rendererScene) -> std::unique_ptr<Renderer> {
+        if (!cpu && multiDevice)
+            return std::make_unique<MultiDeviceRenderer>(rendererSettings,
+                                                         sceneFile ? sceneFile->toScene() : rendererScene);
+
+        if (!cpu) {
+            try {
+                // uploads a scene file straight from the mapped file
+                auto vulkan = sceneFile ? std::make_unique<Vulkan>(rendererSettings, *sceneFile)
+                                        : std::make_unique<Vulkan>(rendererSettings, rendererScene);
+
+                const WorkgroupSize workgroupSize = vulkan->getWorkgroupSize();
+                std::cout << "Work group size: " << workgroupSize.x << "x" << workgroupSize.y << std::endl;
+
+                return vulkan;
+            } catch (const VulkanUnavailableError &exception) {
+                // any other failure (e.g. invalid settings or shader files) is reported instead of rendering for hours
+                std::cout << "Vulkan isn't available (" << exception.what() << "), falling back to the CPU"
+                          << std::endl;
+            }
+        }
+
+        return std::make_unique<CpuRenderer>(rendererSettings, sceneFile ? sceneFile->toScene() : rendererScene);
+    };
+
+    if (!coordinatorHost.empty()) {
+        runWorker(coordinatorHost, workerPort, settings, createRenderer);
+        return 0;
+    }
+
+    if (!sceneFilePath.empty()) {
+        const auto loadBeginTime = std::chrono::steady_clock::now();
+        sceneFile.emplace(sceneFilePath);
+        std::cout << "Scene file with " << sceneFile->getSpheres().size() << " spheres mapped in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadBeginTime).count()
+                  << " ms" << std::endl;
+    }
+
+    const Scene scene = sceneFile ? Scene() : generateScene(sceneSettings);
+    const std::unique_ptr<Renderer> renderer = createRenderer(settings, scene);
+
+    const Camera camera = sceneFile ? sceneFile->getCamera() : scene.camera;
+
+    // the spheres of the scene file are copied before it is unmapped
+    const Animation animation = animationFrames > 0
+                                ? createOrbitAnimation(sceneFile ? sceneFile->toScene() : scene, animationFrames)
+                                : Animation();
+
+    // the renderer has uploaded or copied the scene once it is created
+    sceneFile.reset();
+    const auto* multiDeviceRenderer = dynamic_cast<const MultiDeviceRenderer*>(renderer.get());
+
+    // only the Vulkan renderer on a single device has a window
+    if (!dynamic_cast<const Vulkan*>(renderer.get())) {
+        settings.headless = true;
+    }
+
+    std::cout << "Rendering on " << renderer->getDeviceName() << std::endl;
+
+    // a turntable: the views are spread evenly around the look at point
+    if (viewCount > 1) {
+        auto* vulkan = dynamic_cast<Vulkan*>(renderer.get());
+        if (!vulkan) {
+            std::cout << "Multiple views are only supported by the Vulkan renderer on a single device" << std::endl;
+            return 1;
+        }
+
+        vulkan->setCameras(createOrbitCameras(camera, viewCount));
+        std::cout << "Rendering " << viewCount << " views per dispatch" << std::endl;
+    }
+
+
+    // ANIMATION
+    if (animationFrames > 0) {
+        auto* vulkan = dynamic_cast<Vulkan*>(renderer.get());
+        if (!vulkan) {
+            std::cout << "Animations are only supported by the Vulkan renderer on a single device" << std::endl;
+            return 1;
+        }
+
+        const AnimationSettings animationSettings = {.frameCount = animationFrames, .extension = imageExtension};
+        std::cout << "Rendering " << animationFrames << " frames with " << animationSettings.samplesPerFrame
+                  << " samples each to " << animationSettings.outputPrefix << "*" << imageExtension << std::endl;
+
+        const AnimationResult result = renderAnimation(*vulkan, animationSettings, animation);
+        std::cout << "Animation completed: " << result.frameCount << " frames rendered in " << result.timeMs
+                  << " ms (" << result.framesPerHour << " frames per hour)" << std::endl;
+
+        if (!traceFile.empty()) {
+            renderer->writeTimingTrace(traceFile);
+            std::cout << "Timing trace written to " << traceFile << std::endl;
+        }
+
+        return 0;
+    }
 
 
     // RENDERING
     auto renderBeginTime = std::chrono::steady_clock::now();
 
-    for (uint32_t number = 1; number <= renderCalls; number++) {
+    // the progressive mode keeps rendering with the same samples per pass until the image has converged
+    uint32_t number = 1;
+    const auto isRendering = [&] {
+        return progressive ? !renderer->hasConverged() && number <= settings.progressiveMaxRenderCalls
+                           : number <= renderCalls;
+    };
+
+    for (; isRendering(); number++) {
         RenderCallInfo renderCallInfo = {
                 .number = number,
                 .totalRenderCalls = renderCalls,
                 .totalSamples = samples
         };
 
-        std::cout << "Render call " << number << " / " << renderCalls << " (" << (number * samples / renderCalls)
-                  << " / " << samples << " samples)";
+        if (progressive) {
+            const std::vector<RenderCallTiming> &timings = renderer->getRenderCallTimings();
+            std::cout << "Render call " << number << " (" << (number * samples / renderCalls) << " samples, error "
+                      << (timings.empty() ? 1.0 : timings.back().estimatedError) << ")";
+        } else {
+            std::cout << "Render call " << number << " / " << renderCalls << " (" << (number * samples / renderCalls)
+                      << " / " << samples << " samples)";
+        }
+
         auto renderCallBeginTime = std::chrono::steady_clock::now();
 
-        vulkan.render(renderCallInfo);
+        renderer->render(renderCallInfo);
 
+        // copied and written while the next render calls are traced
+        if (snapshotInterval > 0 && number % snapshotInterval == 0) {
+            renderer->saveScreenshotAsync("render_" + std::to_string(number) + imageExtension);
+        }
+
+        // render() returns as soon as the call is queued, the GPU keeps tracing while the next one is submitted
         auto renderCallTime = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - renderCallBeginTime).count();
-        std::cout << " - Completed in " << renderCallTime << " ms" << std::endl;
+        std::cout << " - Queued in " << renderCallTime << " ms" << std::endl;
+
+        renderer->update();
 
-        vulkan.update();
+        if (!settings.headless && renderer->shouldExit())
+            break;
     }
 
+    renderer->waitIdle();
+
+    // the progressive mode only notices convergence once the last frames in flight have finished
+    const uint32_t renderedCalls = progressive ? number - 1 : renderCalls;
+    const uint32_t renderedSamples = renderedCalls * (samples / renderCalls);
+
     auto renderTime = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - renderBeginTime).count();
-    std::cout << "Rendering completed: " << samples << " samples rendered in " << renderTime << " ms"
-              << std::endl << std::endl;
+    std::cout << "Rendering completed: " << renderedSamples << " samples rendered in " << renderTime << " ms"
+              << std::endl;
+
+    double gpuTime = 0.0, hostOverhead = 0.0, pathLengthSum = 0.0, sampledFractionSum = 0.0, tracedSamples = 0.0;
+    for (const RenderCallTiming &timing: renderer->getRenderCallTimings()) {
+        gpuTime += timing.gpuTimeMs;
+        // the throughput of a render call covers every view and only the pixels that were traced
+        tracedSamples += timing.megaSamplesPerSecond * timing.gpuTimeMs * 1000.0;
+        hostOverhead += timing.hostOverheadMs;
+        // weighted by the traced pixels, as adaptive sampling and tiled rendering only trace part of the image
+        pathLengthSum += timing.averagePathLength * timing.sampledPixelFraction;
+        sampledFractionSum += timing.sampledPixelFraction;
+    }
+
+    const double pathLength = sampledFractionSum > 0.0 ? pathLengthSum / sampledFractionSum : 0.0;
+    const double sampledFraction = renderedCalls > 0 ? sampledFractionSum / double(renderedCalls) : 0.0;
+
+    std::cout << "GPU time: " << gpuTime << " ms ("
+              << (gpuTime > 0.0 ? tracedSamples / (gpuTime * 1000.0) : 0.0) << " Msamples/s), "
+              << "host overhead: " << hostOverhead << " ms" << std::endl;
+    std::cout << "Average path length: " << pathLength << " bounces" << std::endl;
+
+    if (multiDeviceRenderer) {
+        const std::vector<uint32_t> renderCallsPerDevice = multiDeviceRenderer->getRenderCallsPerDevice();
+        std::cout << "Render calls per device:";
+
+        for (uint32_t deviceRenderCalls: renderCallsPerDevice) {
+            std::cout << " " << deviceRenderCalls;
+        }
+
+        std::cout << std::endl;
+    }
+
+    // the phases of the construction, followed by the pipeline variant compiled by the first render call
+    if (const auto* vulkan = dynamic_cast<const Vulkan*>(renderer.get())) {
+        const StartupTimings &startupTimings = vulkan->getStartupTimings();
+        std::cout << "Startup: " << startupTimings.totalMs << " ms ("
+                  << (startupTimings.warmPipelineCache ? "warm" : "cold") << " pipeline cache)";
+
+        for (const StartupPhaseTiming &phase: startupTimings.phases) {
+            std::cout << ", " << phase.name << " " << phase.timeMs << " ms" << (phase.concurrent ? " (concurrent)" : "");
+        }
+
+        std::cout << std::endl;
+    }
+
+    if (settings.adaptiveSampling) {
+        std::cout << "Adaptive sampling: " << (1.0 - sampledFraction) * 100.0 << " % of the samples saved, "
+                  << "skipped pixels have a relative error below " << settings.adaptiveSamplingThreshold << std::endl;
+    }
+
+    if (progressive) {
+        std::cout << "Progressive: estimated error of " << renderer->getRenderCallTimings().back().estimatedError
+                  << " after " << renderedSamples << " samples (target " << settings.progressiveTargetError
+                  << ", fixed budget " << samples << " samples)" << std::endl;
+
+        if (renderedCalls >= settings.progressiveMaxRenderCalls && !renderer->hasConverged()) {
+            std::cout << "Progressive: stopped at " << settings.progressiveMaxRenderCalls
+                      << " render calls before reaching the target error" << std::endl;
+        }
+    }
+
+    std::cout << std::endl;
 
     std::cout << "Saving screenshot..." << std::endl;
-    vulkan.saveScreenshot("render.png");
+    renderer->saveScreenshot("render" + imageExtension);
     std::cout << "Screenshot saved" << std::endl;
 
+    if (!hdrFile.empty()) {
+        renderer->saveHdrScreenshot(hdrFile);
+        std::cout << "HDR image saved to " << hdrFile << std::endl;
+    }
+
+    renderer->waitForScreenshots();
+
+    if (!traceFile.empty()) {
+        renderer->writeTimingTrace(traceFile);
+        std::cout << "Timing trace written to " << traceFile << std::endl;
+    }
+
 
     // WINDOW
-    while (!vulkan.shouldExit()) {
-        vulkan.update();
+    while (!renderer->shouldExit()) {
+        renderer->update();
         std::this_thread::sleep_for(std::chrono::milliseconds(20));
     }
 }
@@ -0,0 +1,116 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path, size_t size) : size(size) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                       nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+    }
+
+    // the mapping extends the file to its size
+    const auto size64 = static_cast<uint64_t>(size);
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                 static_cast<DWORD>(size64), nullptr);
+    if (mapping) {
+        data = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size));
+    }
+#else
+    file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    if (ftruncate(file, static_cast<off_t>(size)) == 0) {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        data = memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>(memory);
+    }
+#endif
+
+    if (!data) {
+        close();
+        throw std::runtime_error("[Error] Failed to map file at '" + path + "'!");
+    }
+}
+
+MappedFile::MappedFile(const std::string &path) : size(0) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        size = static_cast<size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+
+    if (mapping) {
+        data = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size));
+    }
+#else
+    file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    struct stat status = {};
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        size = static_cast<size_t>(status.st_size);
+        void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        data = memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>(memory);
+    }
+
+    // the file is read front to back once, read ahead aggressively
+    if (data) {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (!data) {
+        close();
+        throw std::runtime_error("[Error] Failed to map file at '" + path + "'!");
+    }
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+uint8_t* MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data) munmap(data, size);
+    if (file >= 0) ::close(file);
+    file = -1;
+#endif
+
+    data = nullptr;
+}
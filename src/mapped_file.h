@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file of a fixed size that is mapped into memory for writing, so its contents can be produced in place instead of
+// being copied through a stream buffer. The pages are written back by the OS once the file is unmapped.
+// Existing files can also be mapped read-only, their pages are then only read from disk once they are accessed.
+class MappedFile {
+public:
+    // creates the file, or truncates an existing one, with the given size (which has to be above 0)
+    MappedFile(const std::string &path, size_t size);
+
+    // maps an existing (non-empty) file read-only, the data must not be written to
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] uint8_t* getData() const;
+
+    [[nodiscard]] size_t getSize() const;
+
+private:
+    uint8_t* data = nullptr;
+    size_t size;
+
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int file = -1;
+#endif
+
+    void close();
+};
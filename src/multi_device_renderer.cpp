@@ -0,0 +1,276 @@
+#include "multi_device_renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include "hdr_image.h"
+
+MultiDeviceRenderer::MultiDeviceRenderer(VulkanSettings settings, const Scene &scene) :
+        settings(std::move(settings)), imageEncoder(this->settings.encoderThreads) {
+    // the per pixel sample counts and errors of the devices would have to be merged after every render call
+    if (this->settings.adaptiveSampling || this->settings.tiledRendering || this->settings.progressive) {
+        throw std::runtime_error(
+                "Adaptive sampling, tiled rendering and the progressive mode aren't supported on multiple devices!");
+    }
+
+    // the summed colors the devices are merged from only cover a single view
+    if (this->settings.viewCount > 1)
+        throw std::runtime_error("Multiple views aren't supported on multiple devices!");
+
+    this->settings.headless = true;
+
+    // the first device tells how many suitable ones there are
+    VulkanSettings deviceSettings = this->settings;
+    deviceSettings.physicalDeviceIndex = 0;
+    devices.push_back({.vulkan = std::make_unique<Vulkan>(deviceSettings, scene)});
+
+    const uint32_t physicalDeviceCount = devices.front().vulkan->getSuitablePhysicalDeviceCount();
+
+    // the others are created in parallel, as every one builds its own pipelines
+    std::vector<std::future<std::unique_ptr<Vulkan>>> creations;
+
+    for (uint32_t index = 0; index < physicalDeviceCount; index++) {
+        for (uint32_t copy = index == 0 ? 1 : 0; copy < this->settings.devicesPerPhysicalDevice; copy++) {
+            deviceSettings.physicalDeviceIndex = index;
+
+            creations.push_back(std::async(std::launch::async, [deviceSettings, &scene]() {
+                return std::make_unique<Vulkan>(deviceSettings, scene);
+            }));
+        }
+    }
+
+    for (std::future<std::unique_ptr<Vulkan>> &creation: creations) {
+        devices.push_back({.vulkan = creation.get()});
+    }
+}
+
+MultiDeviceRenderer::~MultiDeviceRenderer() {
+    waitForScreenshots();
+}
+
+void MultiDeviceRenderer::update() {}
+
+void MultiDeviceRenderer::render(const RenderCallInfo &renderCallInfo) {
+    Device &device = devices[pickDevice()];
+
+    // only blocks if all frames of the device are still in flight
+    device.vulkan->render(renderCallInfo);
+    device.submittedRenderCalls++;
+
+    submittedRenderCalls++;
+    lastRenderCallInfo = renderCallInfo;
+
+    collectRenderCallTimings();
+}
+
+void MultiDeviceRenderer::waitIdle() {
+    for (const Device &device: devices) {
+        device.vulkan->waitIdle();
+    }
+
+    collectRenderCallTimings();
+}
+
+const std::vector<RenderCallTiming> &MultiDeviceRenderer::getRenderCallTimings() const {
+    return renderCallTimings;
+}
+
+std::vector<ScreenshotTiming> MultiDeviceRenderer::getScreenshotTimings() const {
+    const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+    return screenshotTimings;
+}
+
+std::string MultiDeviceRenderer::getDeviceName() const {
+    std::string name;
+
+    for (const Device &device: devices) {
+        name += (name.empty() ? "" : ", ") + device.vulkan->getDeviceName();
+    }
+
+    return name;
+}
+
+bool MultiDeviceRenderer::hasConverged() const {
+    return false;
+}
+
+void MultiDeviceRenderer::writeTimingTrace(const std::string &path) const {
+    ::writeTimingTrace(path, renderCallTimings, getScreenshotTimings());
+}
+
+bool MultiDeviceRenderer::shouldExit() const {
+    return true;
+}
+
+void MultiDeviceRenderer::saveScreenshot(const std::string &name) {
+    saveScreenshotAsync(name).get();
+}
+
+std::shared_future<void> MultiDeviceRenderer::saveScreenshotAsync(const std::string &name) {
+    const auto beginTime = std::chrono::steady_clock::now();
+    std::vector<float> colors = mergeSummedPixelColors();
+
+    const double hostBlockedMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - beginTime).count();
+
+    std::shared_future<void> completion = std::async(std::launch::async, [this, name, beginTime, hostBlockedMs,
+                                                                         colors = std::move(colors)]() {
+        const std::vector<uint8_t> pixels = convertToRenderTargetPixels(colors);
+        imageEncoder.write(name, pixels.data(), settings.windowWidth, settings.windowHeight,
+                           settings.pngCompressionLevel);
+
+        const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+        screenshotTimings.push_back(
+                {
+                        .name = name,
+                        .gpuCopyTimeMs = 0.0,
+                        .hostTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - beginTime).count(),
+                        .hostBlockedMs = hostBlockedMs
+                });
+    }).share();
+
+    pendingScreenshots.push_back(completion);
+    return completion;
+}
+
+void MultiDeviceRenderer::saveHdrScreenshot(const std::string &name) {
+    const auto beginTime = std::chrono::steady_clock::now();
+    const std::vector<float> colors = mergeSummedPixelColors();
+
+    writeHdrImage(name, settings.windowWidth, settings.windowHeight, [&](uint32_t y, float* rgb) {
+        std::copy_n(&colors[size_t(y) * settings.windowWidth * 3], settings.windowWidth * 3, rgb);
+    });
+
+    const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+    screenshotTimings.push_back(
+            {
+                    .name = name,
+                    .gpuCopyTimeMs = 0.0,
+                    .hostTimeMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - beginTime).count(),
+                    .hostBlockedMs = 0.0
+            });
+}
+
+void MultiDeviceRenderer::waitForScreenshots() {
+    for (const std::shared_future<void> &screenshot: pendingScreenshots) {
+        screenshot.wait();
+    }
+
+    pendingScreenshots.clear();
+
+    for (const Device &device: devices) {
+        device.vulkan->waitForScreenshots();
+    }
+}
+
+uint32_t MultiDeviceRenderer::getDeviceCount() const {
+    return static_cast<uint32_t>(devices.size());
+}
+
+std::vector<uint32_t> MultiDeviceRenderer::getRenderCallsPerDevice() const {
+    std::vector<uint32_t> renderCalls;
+
+    for (const Device &device: devices) {
+        renderCalls.push_back(device.submittedRenderCalls);
+    }
+
+    return renderCalls;
+}
+
+size_t MultiDeviceRenderer::pickDevice() const {
+    // the GPU time per render call of the devices that have finished some already, devices that haven't are assumed
+    // to be as fast as the average of the measured ones until their first timings arrive
+    std::vector<double> timesPerRenderCallMs(devices.size(), 0.0);
+    double measuredTimeMs = 0.0;
+    uint32_t measuredDevices = 0;
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        const std::vector<RenderCallTiming> &timings = devices[i].vulkan->getRenderCallTimings();
+        if (timings.empty())
+            continue;
+
+        for (const RenderCallTiming &timing: timings) {
+            timesPerRenderCallMs[i] += timing.gpuTimeMs / double(timings.size());
+        }
+
+        measuredTimeMs += timesPerRenderCallMs[i];
+        measuredDevices++;
+    }
+
+    const double defaultTimeMs = measuredDevices > 0 ? measuredTimeMs / measuredDevices : 1.0;
+
+    size_t bestDevice = 0;
+    double bestFinishTimeMs = std::numeric_limits<double>::max();
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        const double timePerRenderCallMs = timesPerRenderCallMs[i] > 0.0 ? timesPerRenderCallMs[i] : defaultTimeMs;
+        const size_t finishedRenderCalls = devices[i].vulkan->getRenderCallTimings().size();
+
+        // including the render call to be submitted
+        const double finishTimeMs = double(devices[i].submittedRenderCalls - finishedRenderCalls + 1) *
+                                    timePerRenderCallMs;
+
+        if (finishTimeMs < bestFinishTimeMs) {
+            bestDevice = i;
+            bestFinishTimeMs = finishTimeMs;
+        }
+    }
+
+    return bestDevice;
+}
+
+void MultiDeviceRenderer::collectRenderCallTimings() {
+    renderCallTimings.clear();
+
+    for (const Device &device: devices) {
+        const std::vector<RenderCallTiming> &timings = device.vulkan->getRenderCallTimings();
+        renderCallTimings.insert(renderCallTimings.end(), timings.begin(), timings.end());
+    }
+
+    std::sort(renderCallTimings.begin(), renderCallTimings.end(),
+              [](const RenderCallTiming &a, const RenderCallTiming &b) {
+                  return a.number < b.number;
+              });
+}
+
+std::vector<float> MultiDeviceRenderer::readSummedPixelColors() {
+    // the copies of all devices run at the same time
+    std::vector<std::future<std::vector<float>>> readbacks;
+
+    for (const Device &device: devices) {
+        readbacks.push_back(std::async(std::launch::async, [&device]() {
+            return device.vulkan->readSummedPixelColors();
+        }));
+    }
+
+    std::vector<float> colors;
+
+    for (std::future<std::vector<float>> &readback: readbacks) {
+        const std::vector<float> deviceColors = readback.get();
+
+        if (colors.empty()) {
+            colors = deviceColors;
+        } else {
+            std::transform(colors.begin(), colors.end(), deviceColors.begin(), colors.begin(), std::plus<>());
+        }
+    }
+
+    return colors;
+}
+
+std::vector<float> MultiDeviceRenderer::mergeSummedPixelColors() {
+    std::vector<float> colors = readSummedPixelColors();
+
+    // every summed color image holds the samples of its render calls divided by totalSamples
+    const float scale = submittedRenderCalls > 0
+                        ? float(lastRenderCallInfo.totalRenderCalls) / float(submittedRenderCalls) : 0.0f;
+
+    for (float &color: colors) {
+        color *= scale;
+    }
+
+    return colors;
+}
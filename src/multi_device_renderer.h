@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include "renderer.h"
+#include "vulkan.h"
+#include "image_encoder.h"
+
+// Renders on every suitable physical device at once, each with its own instance of the Vulkan renderer. Whole render
+// calls are distributed: as the random numbers only depend on the pixel and the number of the render call, every device
+// traces exactly the samples it would have traced alone, and the sum of the summed color images of all devices equals
+// the one of a single device. A render call goes to the device that is expected to finish its queued ones first, based
+// on its measured GPU time per render call, so faster devices take a bigger share.
+// Adaptive sampling, tiled rendering and the progressive mode aren't supported. There is no window.
+class MultiDeviceRenderer : public Renderer {
+public:
+    MultiDeviceRenderer(VulkanSettings settings, const Scene &scene);
+
+    ~MultiDeviceRenderer() override;
+
+    void update() override;
+
+    void render(const RenderCallInfo &renderCallInfo) override;
+
+    void waitIdle() override;
+
+    // of all devices, ordered by the number of the render call
+    [[nodiscard]] const std::vector<RenderCallTiming> &getRenderCallTimings() const override;
+
+    [[nodiscard]] std::vector<ScreenshotTiming> getScreenshotTimings() const override;
+
+    [[nodiscard]] std::string getDeviceName() const override;
+
+    [[nodiscard]] bool hasConverged() const override;
+
+    void writeTimingTrace(const std::string &path) const override;
+
+    [[nodiscard]] bool shouldExit() const override;
+
+    void saveScreenshot(const std::string &name) override;
+
+    // blocks until the summed colors of all devices have been copied and merged, encodes on another thread
+    std::shared_future<void> saveScreenshotAsync(const std::string &name) override;
+
+    void saveHdrScreenshot(const std::string &name) override;
+
+    void waitForScreenshots() override;
+
+    // added up over all devices
+    [[nodiscard]] std::vector<float> readSummedPixelColors() override;
+
+    [[nodiscard]] uint32_t getDeviceCount() const;
+
+    // render calls that have been submitted to each device
+    [[nodiscard]] std::vector<uint32_t> getRenderCallsPerDevice() const;
+
+private:
+    struct Device {
+        std::unique_ptr<Vulkan> vulkan;
+        uint32_t submittedRenderCalls = 0;
+    };
+
+    VulkanSettings settings;
+    std::vector<Device> devices;
+    ImageEncoder imageEncoder;
+
+    RenderCallInfo lastRenderCallInfo = {};
+    uint32_t submittedRenderCalls = 0;
+
+    std::vector<RenderCallTiming> renderCallTimings;
+    std::vector<ScreenshotTiming> screenshotTimings;
+    mutable std::mutex screenshotTimingsMutex;
+    std::vector<std::shared_future<void>> pendingScreenshots;
+
+    [[nodiscard]] size_t pickDevice() const;
+
+    void collectRenderCallTimings();
+
+    // the mean linear RGB color of every pixel over the render calls of all devices
+    [[nodiscard]] std::vector<float> mergeSummedPixelColors();
+};
@@ -0,0 +1,66 @@
+#include "pipeline_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace {
+    std::string toHex(const std::array<uint8_t, 16> &uuid) {
+        const char* digits = "0123456789abcdef";
+        std::string hex;
+
+        for (uint8_t byte: uuid) {
+            hex += digits[byte >> 4];
+            hex += digits[byte & 0xF];
+        }
+
+        return hex;
+    }
+}
+
+std::string getPipelineCachePath(const std::string &directory, const std::array<uint8_t, 16> &deviceUuid,
+                                 const std::array<uint8_t, 16> &driverUuid) {
+    return (std::filesystem::path(directory) / (toHex(deviceUuid) + "-" + toHex(driverUuid) + ".cache")).string();
+}
+
+std::vector<char> readPipelineCache(const std::string &path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    // a missing cache file just means that nothing has been cached yet
+    if (!file.is_open())
+        return {};
+
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+        return {};
+
+    return data;
+}
+
+void writePipelineCache(const std::string &path, const std::vector<char> &data) {
+    const std::filesystem::path parentPath = std::filesystem::path(path).parent_path();
+    if (!parentPath.empty()) {
+        std::filesystem::create_directories(parentPath);
+    }
+
+    const std::string temporaryPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+            throw std::runtime_error("[Error] Failed to open file at '" + temporaryPath + "'!");
+
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporaryPath);
+            throw std::runtime_error("[Error] Failed to write file at '" + temporaryPath + "'!");
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one binary file per device and driver in the directory, named after their UUIDs, so that another GPU or a driver
+// update starts with an empty cache instead of handing the driver data it would have to reject
+std::string getPipelineCachePath(const std::string &directory, const std::array<uint8_t, 16> &deviceUuid,
+                                 const std::array<uint8_t, 16> &driverUuid);
+
+// empty if nothing has been cached yet
+std::vector<char> readPipelineCache(const std::string &path);
+
+// written to a temporary file that replaces the cache, so renderers running at the same time never read a partial one
+void writePipelineCache(const std::string &path, const std::vector<char> &data);
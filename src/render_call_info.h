@@ -2,6 +2,8 @@
 
 #include <memory>
 
+// in the progressive mode only the samples per pass (totalSamples / totalRenderCalls) matter,
+// the number keeps counting past totalRenderCalls until the image has converged
 struct RenderCallInfo {
     uint32_t number;
     uint32_t totalRenderCalls;
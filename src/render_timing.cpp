@@ -0,0 +1,66 @@
+#include "render_timing.h"
+#include <fstream>
+#include <stdexcept>
+
+void writeTimingTraceCsv(std::ofstream &file, const std::vector<RenderCallTiming> &renderCallTimings,
+                         const std::vector<ScreenshotTiming> &screenshotTimings) {
+    file << "type,name,number,samples,gpu_time_ms,host_overhead_ms,host_wait_ms,msamples_per_second,"
+            "average_path_length,sampled_pixel_fraction,estimated_error\n";
+
+    for (const RenderCallTiming &timing: renderCallTimings) {
+        file << "render_call,," << timing.number << "," << timing.samples << "," << timing.gpuTimeMs << ","
+             << timing.hostOverheadMs << "," << timing.hostWaitMs << "," << timing.megaSamplesPerSecond << ","
+             << timing.averagePathLength << "," << timing.sampledPixelFraction << "," << timing.estimatedError << "\n";
+    }
+
+    for (const ScreenshotTiming &timing: screenshotTimings) {
+        file << "screenshot," << timing.name << ",,," << timing.gpuCopyTimeMs << "," << timing.hostTimeMs << ","
+             << timing.hostBlockedMs << ",,,,\n";
+    }
+}
+
+void writeTimingTraceJson(std::ofstream &file, const std::vector<RenderCallTiming> &renderCallTimings,
+                          const std::vector<ScreenshotTiming> &screenshotTimings) {
+    file << "{\n  \"renderCalls\": [";
+
+    for (size_t i = 0; i < renderCallTimings.size(); i++) {
+        const RenderCallTiming &timing = renderCallTimings[i];
+        file << (i == 0 ? "\n" : ",\n")
+             << "    {\"number\": " << timing.number
+             << ", \"samples\": " << timing.samples
+             << ", \"gpuTimeMs\": " << timing.gpuTimeMs
+             << ", \"hostOverheadMs\": " << timing.hostOverheadMs
+             << ", \"hostWaitMs\": " << timing.hostWaitMs
+             << ", \"megaSamplesPerSecond\": " << timing.megaSamplesPerSecond
+             << ", \"averagePathLength\": " << timing.averagePathLength
+             << ", \"sampledPixelFraction\": " << timing.sampledPixelFraction
+             << ", \"estimatedError\": " << timing.estimatedError << "}";
+    }
+
+    file << "\n  ],\n  \"screenshots\": [";
+
+    for (size_t i = 0; i < screenshotTimings.size(); i++) {
+        const ScreenshotTiming &timing = screenshotTimings[i];
+        file << (i == 0 ? "\n" : ",\n")
+             << "    {\"name\": \"" << timing.name << "\""
+             << ", \"gpuCopyTimeMs\": " << timing.gpuCopyTimeMs
+             << ", \"hostTimeMs\": " << timing.hostTimeMs
+             << ", \"hostBlockedMs\": " << timing.hostBlockedMs << "}";
+    }
+
+    file << "\n  ]\n}\n";
+}
+
+void writeTimingTrace(const std::string &path, const std::vector<RenderCallTiming> &renderCallTimings,
+                      const std::vector<ScreenshotTiming> &screenshotTimings) {
+    std::ofstream file(path);
+
+    if (!file.is_open())
+        throw std::runtime_error("[Error] Failed to open file at '" + path + "'!");
+
+    if (path.ends_with(".json")) {
+        writeTimingTraceJson(file, renderCallTimings, screenshotTimings);
+    } else {
+        writeTimingTraceCsv(file, renderCallTimings, screenshotTimings);
+    }
+}
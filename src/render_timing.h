@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RenderCallTiming {
+    uint32_t number;
+    uint32_t samples; // per pixel
+    double gpuTimeMs; // duration of the dispatch, measured with timestamp queries
+    double hostOverheadMs; // time spent in render() for recording and submitting
+    double hostWaitMs; // time render() was blocked because all frames were still in flight
+    double megaSamplesPerSecond; // based on the GPU time
+    double averagePathLength; // bounces per sample, only if VulkanSettings::collectPathStatistics is set
+    double sampledPixelFraction; // pixels (in whole tiles) that were traced, below 1 with adaptive sampling
+    double estimatedError; // progressive mode: root mean square of the relative errors of the traced pixels
+};
+
+struct ScreenshotTiming {
+    std::string name;
+    double gpuCopyTimeMs; // duration of the image to buffer copy, measured with timestamp queries
+    double hostTimeMs; // from the request until the image has been encoded (or the callback has returned)
+    double hostBlockedMs; // time the requesting thread was blocked, waiting for a free staging buffer and submitting
+};
+
+struct StartupPhaseTiming {
+    std::string name;
+    double timeMs;
+    bool concurrent; // ran on its own thread, overlapping the other phases
+};
+
+struct StartupTimings {
+    // the sequential ones in their order, followed by the concurrent ones and the pipeline variants that the render
+    // calls have created since
+    std::vector<StartupPhaseTiming> phases;
+    double totalMs; // of the construction, without the pipeline variants created by the first render calls
+    bool warmPipelineCache; // the pipeline cache of a previous run was loaded
+};
+
+
+// writes JSON if the path ends with ".json" and CSV otherwise
+void writeTimingTrace(const std::string &path, const std::vector<RenderCallTiming> &renderCallTimings,
+                      const std::vector<ScreenshotTiming> &screenshotTimings);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <vector>
+#include "render_call_info.h"
+#include "render_timing.h"
+
+// The interface main() renders through: the Vulkan renderer, or the CPU reference renderer if no device is available.
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    // handles window events
+    virtual void update() = 0;
+
+    virtual void render(const RenderCallInfo &renderCallInfo) = 0;
+
+    // blocks until all render calls have finished and collects their timings
+    virtual void waitIdle() = 0;
+
+    [[nodiscard]] virtual const std::vector<RenderCallTiming> &getRenderCallTimings() const = 0;
+
+    // a copy, as screenshots that are still being written append to the timings from other threads
+    [[nodiscard]] virtual std::vector<ScreenshotTiming> getScreenshotTimings() const = 0;
+
+    [[nodiscard]] virtual std::string getDeviceName() const = 0;
+
+    // progressive mode: the estimated error of the latest finished render call is below the target
+    [[nodiscard]] virtual bool hasConverged() const = 0;
+
+    // CSV, or JSON if the path ends with ".json"
+    virtual void writeTimingTrace(const std::string &path) const = 0;
+
+    [[nodiscard]] virtual bool shouldExit() const = 0;
+
+    // blocks until the image has been written, PNG or QOI depending on the extension
+    virtual void saveScreenshot(const std::string &name) = 0;
+
+    virtual std::shared_future<void> saveScreenshotAsync(const std::string &name) = 0;
+
+    // mean linear colors as PFM, or OpenEXR if the path ends with ".exr"
+    virtual void saveHdrScreenshot(const std::string &name) = 0;
+
+    virtual void waitForScreenshots() = 0;
+
+    // the sum of the samples of every pixel divided by totalSamples as linear RGB, blocks until all submitted render
+    // calls have finished. The sums of renderers that traced different render calls can simply be added up.
+    [[nodiscard]] virtual std::vector<float> readSummedPixelColors() = 0;
+};
@@ -1,109 +1,264 @@
 #include "scene.h"
-#include <random>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "work_stealing_pool.h"
 
-float randomFloat(float min, float max) {
-    std::random_device rd;
-    std::mt19937 engine(rd());
-    std::uniform_real_distribution<float> distribution(min, max);
-    return distribution(engine);
-}
-
-float randomFloat() {
-    return randomFloat(0.0f, 1.0f);
-}
+namespace {
+    // below this amount of cells the scene is generated on the calling thread, starting the threads would take longer
+    const uint64_t PARALLEL_CELL_COUNT = 1 << 16;
 
-// https://www.codespeedy.com/hsv-to-rgb-in-cpp/
-glm::vec3 getRandomColor() {
-    float h = std::floor(randomFloat(0.0f, 360.0f));
-    float s = 0.75f, v = 0.45f;
-
-    float C = s * v;
-    float X = C * (1.0f - std::fabs(std::fmod(h / 60.0f, 2.0f) - 1.0f));
-    float m = v - C;
-
-    float r, g, b;
-
-    if (h >= 0 && h < 60) {
-        r = C, g = X, b = 0;
-    } else if (h >= 60 && h < 120) {
-        r = X, g = C, b = 0;
-    } else if (h >= 120 && h < 180) {
-        r = 0, g = C, b = X;
-    } else if (h >= 180 && h < 240) {
-        r = 0, g = X, b = C;
-    } else if (h >= 240 && h < 300) {
-        r = X, g = 0, b = C;
-    } else {
-        r = C, g = 0, b = X;
+    // the finalizer of SplitMix64, a bijection that mixes every input bit into all output bits
+    uint64_t mixBits(uint64_t x) {
+        x ^= x >> 30u;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27u;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31u;
+        return x;
     }
 
-    return {r + m, g + m, b + m};
-}
+    // The random numbers of a grid cell. The n-th number only depends on the seed, the cell and n, no state is carried
+    // from one cell to the next.
+    class CellRandom {
+    public:
+        CellRandom(uint32_t seed, uint64_t cell) : key(mixBits(mixBits(seed) ^ cell)) {}
 
-Scene generateRandomScene() {
-    Scene scene = {
-            .sphereAmount = 4,
-            .spheres = {},
-            .materials = {},
+        // in [0, 1), from the upper 24 bits of the hash, which a float holds exactly
+        float next() {
+            counter++;
+            return float(mixBits(key + counter * 0x9E3779B97F4A7C15ull) >> 40u) * 0x1.0p-24f;
+        }
+
+        float next(float min, float max) {
+            return min + next() * (max - min);
+        }
+
+    private:
+        uint64_t key;
+        uint64_t counter = 0;
     };
 
-    scene.materials[0] = {MaterialType::DIFFUSE, TextureType::CHECKERED,
-                          {glm::vec3(0.05f, 0.05f, 0.05f), glm::vec3(0.95f, 0.95f, 0.95f)}, 0.0f};
-    scene.materials[1] = {MaterialType::DIFFUSE, TextureType::SOLID, {glm::vec3(0.6f, 0.3f, 0.1f)}, 0.0f};
-    scene.materials[2] = {MaterialType::METAL, TextureType::SOLID, {glm::vec3(0.7f, 0.6f, 0.5f)}, 0.0f};
-    scene.materials[3] = {MaterialType::REFRACTIVE, TextureType::SOLID, {glm::vec3(1.0f, 1.0f, 1.0f)}, 1.5f};
-
-    scene.spheres[0] = {glm::vec3(0.0f, -1000.0f, 1.0f), 1000.0f, 0};
-    scene.spheres[1] = {glm::vec3(-4.0f, 1.0f, 0.0f), 1.0f, 1};
-    scene.spheres[2] = {glm::vec3(4.0f, 1.0f, 0.0f), 1.0f, 2};
-    scene.spheres[3] = {glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, 3};
-
-    uint32_t sphereIndex = 4;
-
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            glm::vec3 sphereCenter = glm::vec3(float(a) + 0.9f * randomFloat(), 0.2f, float(b) + 0.9f * randomFloat());
-
-            const float materialProbability = randomFloat();
-            Material material = {};
-
-            if (materialProbability < 0.7) {
-                const glm::vec3 albedo = getRandomColor();
-                material = {
-                        .type = MaterialType::DIFFUSE,
-                        .textureType = TextureType::SOLID,
-                        .colors = {albedo},
-                        .specificAttribute = 0.0f
-                };
-
-            } else if (materialProbability < 0.85) {
-                const glm::vec3 albedo = glm::vec3(randomFloat(0.5f, 1.0f), randomFloat(0.5f, 1.0f),
-                                                   randomFloat(0.5f, 1.0f));
-                const float fuzz = 0.0f;
-
-                material = {
-                        .type = MaterialType::METAL,
-                        .textureType = TextureType::SOLID,
-                        .colors = {albedo},
-                        .specificAttribute = fuzz
-                };
-
-            } else {
-                material = {
-                        .type = MaterialType::REFRACTIVE,
-                        .textureType = TextureType::SOLID,
-                        .colors = {glm::vec3(1.0f, 1.0f, 1.0f)},
-                        .specificAttribute = 1.5f
-                };
+    // https://www.codespeedy.com/hsv-to-rgb-in-cpp/
+    glm::vec3 getRandomColor(CellRandom &random) {
+        float h = std::floor(random.next(0.0f, 360.0f));
+        float s = 0.75f, v = 0.45f;
+
+        float C = s * v;
+        float X = C * (1.0f - std::fabs(std::fmod(h / 60.0f, 2.0f) - 1.0f));
+        float m = v - C;
+
+        float r, g, b;
+
+        if (h >= 0 && h < 60) {
+            r = C, g = X, b = 0;
+        } else if (h >= 60 && h < 120) {
+            r = X, g = C, b = 0;
+        } else if (h >= 120 && h < 180) {
+            r = 0, g = C, b = X;
+        } else if (h >= 180 && h < 240) {
+            r = 0, g = X, b = C;
+        } else if (h >= 240 && h < 300) {
+            r = X, g = 0, b = C;
+        } else {
+            r = C, g = 0, b = X;
+        }
+
+        return {r + m, g + m, b + m};
+    }
+
+    // the first random number of every cell decides whether it holds a sphere
+    bool isCellOccupied(CellRandom &random, const SceneGeneratorSettings &settings) {
+        return random.next() < settings.density;
+    }
+
+    // the grid has as many columns as rows
+    uint32_t getRowCount(const SceneGeneratorSettings &settings) {
+        return static_cast<uint32_t>(2 * std::max(settings.gridSize, 0));
+    }
+
+    uint64_t getCellIndex(const SceneGeneratorSettings &settings, uint32_t row, uint32_t column) {
+        return uint64_t(row) * getRowCount(settings) + column;
+    }
+
+    // the rows of the grid are the tasks of the threads
+    void forEachRow(const SceneGeneratorSettings &settings, const std::function<void(uint32_t row)> &function) {
+        const uint32_t rowCount = getRowCount(settings);
 
+        if (uint64_t(rowCount) * rowCount < PARALLEL_CELL_COUNT) {
+            for (uint32_t row = 0; row < rowCount; row++) {
+                function(row);
             }
 
-            scene.materials[sphereIndex] = material;
-            scene.spheres[sphereIndex] = {sphereCenter, 0.2f, sphereIndex};
-            sphereIndex++;
+            return;
+        }
+
+        WorkStealingPool pool(settings.threadCount);
+        pool.run(rowCount, [&](uint32_t row, uint32_t) { function(row); });
+    }
+
+    // the index of the first sphere of every row, followed by the total amount of spheres
+    std::vector<size_t> getRowOffsets(const SceneGeneratorSettings &settings) {
+        const uint32_t rowCount = getRowCount(settings);
+
+        // the amount of spheres in every row at first
+        std::vector<size_t> offsets(rowCount + 1, rowCount);
+
+        if (settings.density < 1.0f) {
+            forEachRow(settings, [&](uint32_t row) {
+                size_t count = 0;
+
+                for (uint32_t column = 0; column < rowCount; column++) {
+                    CellRandom random(settings.seed, getCellIndex(settings, row, column));
+                    count += isCellOccupied(random, settings) ? 1 : 0;
+                }
+
+                offsets[row] = count;
+            });
         }
+
+        // the 4 large spheres come first
+        size_t offset = 4;
+        for (size_t &rowOffset: offsets) {
+            offset += std::exchange(rowOffset, offset);
+        }
+
+        return offsets;
     }
 
-    scene.sphereAmount = sphereIndex;
+    Material generateMaterial(CellRandom &random, const SceneGeneratorSettings &settings) {
+        const float shareSum = settings.diffuseShare + settings.metalShare + settings.refractiveShare;
+        const float materialProbability = random.next() * shareSum;
+
+        if (materialProbability < settings.diffuseShare) {
+            return {
+                    .type = MaterialType::DIFFUSE,
+                    .textureType = TextureType::SOLID,
+                    .colors = {getRandomColor(random)},
+                    .specificAttribute = 0.0f
+            };
+        }
+
+        if (materialProbability < settings.diffuseShare + settings.metalShare) {
+            // separate statements, so the order the random numbers are drawn in doesn't depend on the compiler
+            glm::vec3 albedo;
+            albedo.x = random.next(0.5f, 1.0f);
+            albedo.y = random.next(0.5f, 1.0f);
+            albedo.z = random.next(0.5f, 1.0f);
+            const float fuzz = 0.0f;
+
+            return {
+                    .type = MaterialType::METAL,
+                    .textureType = TextureType::SOLID,
+                    .colors = {albedo},
+                    .specificAttribute = fuzz
+            };
+        }
+
+        return {
+                .type = MaterialType::REFRACTIVE,
+                .textureType = TextureType::SOLID,
+                .colors = {glm::vec3(1.0f, 1.0f, 1.0f)},
+                .specificAttribute = 1.5f
+        };
+    }
+}
+
+size_t getGeneratedSphereCount(const SceneGeneratorSettings &settings) {
+    return getRowOffsets(settings).back();
+}
+
+void generateScene(const SceneGeneratorSettings &settings, std::span<Sphere> spheres, std::span<Material> materials) {
+    if (settings.diffuseShare + settings.metalShare + settings.refractiveShare <= 0.0f)
+        throw std::runtime_error("[Error] The material shares of the scene add up to 0!");
+
+    const std::vector<size_t> rowOffsets = getRowOffsets(settings);
+
+    if (spheres.size() != rowOffsets.back() || materials.size() != rowOffsets.back())
+        throw std::runtime_error("[Error] The scene has " + std::to_string(rowOffsets.back()) + " spheres, but the "
+                                 "arrays hold " + std::to_string(spheres.size()) + " and " +
+                                 std::to_string(materials.size()) + "!");
+
+    materials[0] = {MaterialType::DIFFUSE, TextureType::CHECKERED,
+                    {glm::vec3(0.05f, 0.05f, 0.05f), glm::vec3(0.95f, 0.95f, 0.95f)}, 0.0f};
+    materials[1] = {MaterialType::DIFFUSE, TextureType::SOLID, {glm::vec3(0.6f, 0.3f, 0.1f)}, 0.0f};
+    materials[2] = {MaterialType::METAL, TextureType::SOLID, {glm::vec3(0.7f, 0.6f, 0.5f)}, 0.0f};
+    materials[3] = {MaterialType::REFRACTIVE, TextureType::SOLID, {glm::vec3(1.0f, 1.0f, 1.0f)}, 1.5f};
+
+    spheres[0] = {glm::vec3(0.0f, -1000.0f, 1.0f), 1000.0f, 0};
+    spheres[1] = {glm::vec3(-4.0f, 1.0f, 0.0f), 1.0f, 1};
+    spheres[2] = {glm::vec3(4.0f, 1.0f, 0.0f), 1.0f, 2};
+    spheres[3] = {glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, 3};
+
+    forEachRow(settings, [&](uint32_t row) {
+        const int a = static_cast<int>(row) - settings.gridSize;
+        size_t index = rowOffsets[row];
+
+        for (uint32_t column = 0; column < getRowCount(settings); column++) {
+            CellRandom random(settings.seed, getCellIndex(settings, row, column));
+            if (!isCellOccupied(random, settings))
+                continue;
+
+            const int b = static_cast<int>(column) - settings.gridSize;
+            const float offsetX = random.next();
+            const float offsetZ = random.next();
+            const glm::vec3 sphereCenter = glm::vec3(float(a) + 0.9f * offsetX, 0.2f, float(b) + 0.9f * offsetZ);
+
+            spheres[index] = {sphereCenter, 0.2f, static_cast<uint32_t>(index)};
+            materials[index] = generateMaterial(random, settings);
+            index++;
+        }
+    });
+}
+
+Scene generateScene(const SceneGeneratorSettings &settings) {
+    Scene scene;
+
+    const size_t sphereCount = getGeneratedSphereCount(settings);
+    scene.spheres.resize(sphereCount);
+    scene.materials.resize(sphereCount);
+
+    generateScene(settings, scene.spheres, scene.materials);
     return scene;
 }
+
+Scene generateRandomScene(int gridSize, uint32_t seed) {
+    return generateScene({.seed = seed, .gridSize = gridSize});
+}
+
+Scene generateSceneWithSpheres(size_t sphereCount, SceneGeneratorSettings settings) {
+    sphereCount = std::max(sphereCount, size_t(4));
+
+    if (settings.density <= 0.0f && sphereCount > 4)
+        throw std::runtime_error("[Error] A scene with a density of 0 only has the 4 large spheres!");
+
+    // the expected grid size, which is only too small if fewer cells than expected are occupied
+    const double density = std::clamp(double(settings.density), 1e-3, 1.0);
+    settings.gridSize = static_cast<int>(std::ceil(std::sqrt(double(sphereCount - 4) / (4.0 * density))));
+
+    while (getGeneratedSphereCount(settings) < sphereCount) {
+        settings.gridSize++;
+    }
+
+    // every small sphere has its own material, which directly follows the ones of the spheres before it
+    Scene scene = generateScene(settings);
+    scene.spheres.resize(sphereCount);
+    scene.materials.resize(sphereCount);
+
+    return scene;
+}
+
+void validateMaterials(std::span<const Material> materials) {
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (materials[i].type > MaterialType::REFRACTIVE)
+            throw std::runtime_error("Material " + std::to_string(i) + " has the unknown type " +
+                                     std::to_string(materials[i].type) + "!");
+
+        if (materials[i].textureType > TextureType::CHECKERED)
+            throw std::runtime_error("Material " + std::to_string(i) + " has the unknown texture type " +
+                                     std::to_string(materials[i].textureType) + "!");
+    }
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
 #include <glm/glm.hpp>
 
 enum MaterialType {
@@ -30,11 +35,60 @@ struct Material {
     alignas(4) float specificAttribute;
 };
 
+struct Camera {
+    float fov; // vertical, in degrees
+    float aperture;
+    float focusDistance;
+    glm::vec3 lookFrom;
+    glm::vec3 lookAt;
+    glm::vec3 up;
+};
+
+// both arrays are uploaded as-is into std430 storage buffers, spheres reference materials by index
 struct Scene {
-    alignas(4) uint32_t sphereAmount;
-    Sphere spheres[500];
-    Material materials[500];
+    std::vector<Sphere> spheres;
+    std::vector<Material> materials;
+    Camera camera = {
+            .fov = 25.0f,
+            .aperture = 0.0f,
+            .focusDistance = 10.0f,
+            .lookFrom = glm::vec3(13.0f, 2.0f, -3.0f),
+            .lookAt = glm::vec3(0.0f),
+            .up = glm::vec3(0.0f, 1.0f, 0.0f)
+    };
+    glm::vec3 backgroundColor = glm::vec3(0.70f, 0.80f, 1.00f);
+};
+
+
+// The small spheres are placed on a (2 * gridSize) x (2 * gridSize) grid around the origin, one sphere in each cell
+// that is occupied. Every random number is a hash of the seed, the cell and the index of the number within the cell, so
+// the cells are generated in parallel and the same settings always result in the same scene, on any amount of threads.
+struct SceneGeneratorSettings {
+    uint32_t seed = 42;
+    int gridSize = 11;
+    float density = 1.0f; // probability of a cell to hold a sphere
+    // shares of the small spheres, normalized by their sum
+    float diffuseShare = 0.7f;
+    float metalShare = 0.15f;
+    float refractiveShare = 0.15f;
+    uint32_t threadCount = 0; // 0: one thread per hardware thread
 };
 
+// the amount of spheres (and materials, every sphere has its own one) the settings result in, the 4 large ones included
+size_t getGeneratedSphereCount(const SceneGeneratorSettings &settings);
+
+// Writes the spheres and their materials straight into the arrays, which have to hold getGeneratedSphereCount()
+// elements each, e.g. the mapped memory of the scene buffers. The camera and background color are the ones of Scene.
+void generateScene(const SceneGeneratorSettings &settings, std::span<Sphere> spheres, std::span<Material> materials);
+
+Scene generateScene(const SceneGeneratorSettings &settings);
+
+// the scene of the default settings with the given grid size and seed
+Scene generateRandomScene(int gridSize = 11, uint32_t seed = std::random_device()());
+
+// the scene of the smallest grid size that results in sphereCount spheres (at least 4), cut off after the last of them
+Scene generateSceneWithSpheres(size_t sphereCount, SceneGeneratorSettings settings);
 
-Scene generateRandomScene();
\ No newline at end of file
+// Checks materials that weren't generated, e.g. the ones of a scene file or an update: the shaders select the material
+// queues and branches by type without any bounds checks. Throws at the first unknown type or texture type.
+void validateMaterials(std::span<const Material> materials);
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "scene_file.h"
+
+// Writes a random scene into a scene file for `RayTracingGPU --scene`, e.g.
+//   RayTracingGPUSceneConverter scene.rts --spheres 1000000 --seed 42
+// or prints the header of an existing one with --info.
+int main(int argc, char* argv[]) {
+    std::string path;
+    SceneGeneratorSettings sceneSettings;
+    size_t sphereCount = 0; // replaces the grid size, 0 for none
+    bool info = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            sceneSettings.gridSize = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spheres") == 0 && i + 1 < argc) {
+            sphereCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            sceneSettings.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            sceneSettings.density = std::stof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--info") == 0) {
+            info = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path.empty()) {
+        std::cout << "Usage: RayTracingGPUSceneConverter <file> [--grid <size> | --spheres <count>] [--seed <seed>]"
+                  << " [--density <0-1>]"
+                  << std::endl << "       RayTracingGPUSceneConverter <file> --info" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (!info) {
+            auto beginTime = std::chrono::steady_clock::now();
+            Scene scene = sphereCount > 0 ? generateSceneWithSpheres(sphereCount, sceneSettings)
+                                          : generateScene(sceneSettings);
+
+            auto generateTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - beginTime).count();
+            std::cout << "Scene with " << scene.spheres.size() << " spheres generated in " << generateTime << " ms"
+                      << std::endl;
+
+            beginTime = std::chrono::steady_clock::now();
+            writeSceneFile(path, std::move(scene));
+
+            auto writeTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - beginTime).count();
+            std::cout << "BVH built and written to " << path << " in " << writeTime << " ms" << std::endl;
+        }
+
+        const SceneFile sceneFile(path);
+        std::cout << path << ": version " << SCENE_FILE_VERSION << ", " << sceneFile.getSpheres().size()
+                  << " spheres, " << sceneFile.getMaterials().size() << " materials, "
+                  << sceneFile.getBvhNodes().size() << " BVH nodes" << std::endl;
+    } catch (const std::exception &exception) {
+        std::cout << exception.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "scene_file.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char SCENE_FILE_MAGIC[8] = "RTSCENE";
+    const uint64_t ARRAY_ALIGNMENT = 64;
+
+    uint64_t alignOffset(uint64_t offset) {
+        return (offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+    }
+}
+
+void writeSceneFile(const std::string &path, Scene scene) {
+    const std::vector<BVHNode> bvhNodes = buildBVH(scene.spheres);
+
+    SceneFileHeader header = {
+            .magic = {},
+            .version = SCENE_FILE_VERSION,
+            .headerSize = sizeof(SceneFileHeader),
+            .sphereSize = sizeof(Sphere),
+            .materialSize = sizeof(Material),
+            .bvhNodeSize = sizeof(BVHNode),
+            .padding = 0,
+            .sphereOffset = alignOffset(sizeof(SceneFileHeader)),
+            .sphereCount = scene.spheres.size(),
+            .materialOffset = 0,
+            .materialCount = scene.materials.size(),
+            .bvhNodeOffset = 0,
+            .bvhNodeCount = bvhNodes.size(),
+            .camera = scene.camera,
+            .backgroundColor = scene.backgroundColor
+    };
+
+    std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+    header.materialOffset = alignOffset(header.sphereOffset + header.sphereCount * sizeof(Sphere));
+    header.bvhNodeOffset = alignOffset(header.materialOffset + header.materialCount * sizeof(Material));
+
+    const MappedFile file(path, header.bvhNodeOffset + header.bvhNodeCount * sizeof(BVHNode));
+    uint8_t* data = file.getData();
+
+    // the gaps between the arrays are already zero, as the file is newly created
+    std::memcpy(data, &header, sizeof(header));
+    std::memcpy(data + header.sphereOffset, scene.spheres.data(), header.sphereCount * sizeof(Sphere));
+    std::memcpy(data + header.materialOffset, scene.materials.data(), header.materialCount * sizeof(Material));
+    std::memcpy(data + header.bvhNodeOffset, bvhNodes.data(), header.bvhNodeCount * sizeof(BVHNode));
+}
+
+SceneFile::SceneFile(const std::string &path) : file(path), header(nullptr) {
+    if (file.getSize() < sizeof(SceneFileHeader) ||
+        std::memcmp(file.getData(), SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0)
+        throw std::runtime_error("[Error] '" + path + "' isn't a scene file!");
+
+    header = reinterpret_cast<const SceneFileHeader*>(file.getData());
+
+    if (header->version != SCENE_FILE_VERSION || header->headerSize != sizeof(SceneFileHeader))
+        throw std::runtime_error("[Error] Scene file '" + path + "' has version " + std::to_string(header->version) +
+                                 ", expected " + std::to_string(SCENE_FILE_VERSION) + "!");
+
+    if (header->sphereSize != sizeof(Sphere) || header->materialSize != sizeof(Material) ||
+        header->bvhNodeSize != sizeof(BVHNode))
+        throw std::runtime_error("[Error] Scene file '" + path + "' was written with a different memory layout!");
+
+    const auto fitsIntoFile = [&](uint64_t offset, uint64_t count, uint64_t elementSize) {
+        return offset % ARRAY_ALIGNMENT == 0 && offset <= file.getSize() &&
+               count <= (file.getSize() - offset) / elementSize;
+    };
+
+    // the sphere count also has to fit into the 32 bit offsets of the BVH nodes
+    if (header->sphereCount > UINT32_MAX ||
+        !fitsIntoFile(header->sphereOffset, header->sphereCount, sizeof(Sphere)) ||
+        !fitsIntoFile(header->materialOffset, header->materialCount, sizeof(Material)) ||
+        !fitsIntoFile(header->bvhNodeOffset, header->bvhNodeCount, sizeof(BVHNode)))
+        throw std::runtime_error("[Error] Scene file '" + path + "' is truncated or corrupted!");
+
+    // the shader follows the nodes without any bounds checks, files without a BVH get a freshly built one
+    if (header->bvhNodeCount > 0) {
+        try {
+            validateBVH(getBvhNodes(), header->sphereCount);
+        } catch (const std::runtime_error &error) {
+            throw std::runtime_error("[Error] Scene file '" + path + "' has an invalid BVH: " + error.what());
+        }
+    }
+
+    try {
+        validateMaterials(getMaterials());
+    } catch (const std::runtime_error &error) {
+        throw std::runtime_error("[Error] Scene file '" + path + "' has an invalid material: " + error.what());
+    }
+}
+
+template<typename T>
+std::span<const T> SceneFile::getArray(uint64_t offset, uint64_t count) const {
+    return {reinterpret_cast<const T*>(file.getData() + offset), static_cast<size_t>(count)};
+}
+
+std::span<const Sphere> SceneFile::getSpheres() const {
+    return getArray<Sphere>(header->sphereOffset, header->sphereCount);
+}
+
+std::span<const Material> SceneFile::getMaterials() const {
+    return getArray<Material>(header->materialOffset, header->materialCount);
+}
+
+std::span<const BVHNode> SceneFile::getBvhNodes() const {
+    return getArray<BVHNode>(header->bvhNodeOffset, header->bvhNodeCount);
+}
+
+const Camera &SceneFile::getCamera() const {
+    return header->camera;
+}
+
+glm::vec3 SceneFile::getBackgroundColor() const {
+    return header->backgroundColor;
+}
+
+Scene SceneFile::toScene() const {
+    const std::span<const Sphere> spheres = getSpheres();
+    const std::span<const Material> materials = getMaterials();
+
+    return {
+            .spheres = std::vector<Sphere>(spheres.begin(), spheres.end()),
+            .materials = std::vector<Material>(materials.begin(), materials.end()),
+            .camera = header->camera,
+            .backgroundColor = header->backgroundColor
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include "bvh.h"
+#include "mapped_file.h"
+#include "scene.h"
+
+const uint32_t SCENE_FILE_VERSION = 1;
+
+// The header at the start of a scene file. The arrays follow at their offsets (aligned to 64 bytes) and are laid out
+// exactly like the storage buffers of the shader, which the structs of scene.h and bvh.h already mirror, so they can
+// be copied into buffer memory as they are. The spheres are stored in the order of the leaves of the BVH.
+// All values are little-endian.
+struct SceneFileHeader {
+    char magic[8]; // "RTSCENE" followed by a null byte
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t sphereSize, materialSize, bvhNodeSize; // of the structs, files of incompatible builds are rejected
+    uint32_t padding;
+    uint64_t sphereOffset, sphereCount;
+    uint64_t materialOffset, materialCount;
+    uint64_t bvhNodeOffset, bvhNodeCount; // 0 nodes: the BVH is built when the scene is loaded
+    Camera camera;
+    glm::vec3 backgroundColor;
+};
+
+
+// builds the BVH (which reorders the spheres) and writes the scene through a memory-mapped file
+void writeSceneFile(const std::string &path, Scene scene);
+
+// A scene file mapped read-only. Only the header and the BVH are checked, the arrays point straight into the mapped
+// file and are neither parsed nor copied until they are uploaded.
+class SceneFile {
+public:
+    explicit SceneFile(const std::string &path);
+
+    [[nodiscard]] std::span<const Sphere> getSpheres() const;
+
+    [[nodiscard]] std::span<const Material> getMaterials() const;
+
+    // empty if the file has no BVH
+    [[nodiscard]] std::span<const BVHNode> getBvhNodes() const;
+
+    [[nodiscard]] const Camera &getCamera() const;
+
+    [[nodiscard]] glm::vec3 getBackgroundColor() const;
+
+    // a copy of the arrays, e.g. for the CPU renderer, which builds its own BVH
+    [[nodiscard]] Scene toScene() const;
+
+private:
+    MappedFile file;
+    const SceneFileHeader* header;
+
+    template<typename T>
+    [[nodiscard]] std::span<const T> getArray(uint64_t offset, uint64_t count) const;
+};
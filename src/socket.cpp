@@ -0,0 +1,213 @@
+#include "socket.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+namespace {
+    // Winsock has to be initialized once per process before any other call
+    struct WinsockInitializer {
+        WinsockInitializer() {
+            WSADATA data;
+            WSAStartup(MAKEWORD(2, 2), &data);
+        }
+
+        ~WinsockInitializer() {
+            WSACleanup();
+        }
+    };
+
+    const WinsockInitializer winsockInitializer;
+
+    int closeHandle(SocketHandle handle) {
+        return closesocket(handle);
+    }
+
+    int pollHandles(pollfd* handles, size_t count, int timeoutMs) {
+        return WSAPoll(handles, static_cast<ULONG>(count), timeoutMs);
+    }
+
+    const int SEND_FLAGS = 0;
+}
+
+#else
+
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+namespace {
+    int closeHandle(SocketHandle handle) {
+        return ::close(handle);
+    }
+
+    int pollHandles(pollfd* handles, size_t count, int timeoutMs) {
+        return poll(handles, count, timeoutMs);
+    }
+
+    // a closed connection results in an error instead of terminating the process with SIGPIPE
+#ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    const int SEND_FLAGS = 0;
+#endif
+}
+
+#endif
+
+Socket::Socket(SocketHandle handle) : handle(handle) {}
+
+Socket::~Socket() {
+    close();
+}
+
+Socket::Socket(Socket &&other) noexcept: handle(std::exchange(other.handle, invalidHandle)) {}
+
+Socket &Socket::operator=(Socket &&other) noexcept {
+    if (this != &other) {
+        close();
+        handle = std::exchange(other.handle, invalidHandle);
+    }
+
+    return *this;
+}
+
+void Socket::close() {
+    if (handle != invalidHandle) {
+        closeHandle(handle);
+        handle = invalidHandle;
+    }
+}
+
+Socket Socket::connect(const std::string &host, uint16_t port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+        throw std::runtime_error("[Error] Failed to resolve '" + host + "'!");
+
+    for (const addrinfo* address = addresses; address; address = address->ai_next) {
+        Socket socket(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (socket.handle == invalidHandle)
+            continue;
+
+        if (::connect(socket.handle, address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) == 0) {
+            freeaddrinfo(addresses);
+
+            // the messages are sent as header and payload, which shouldn't wait for each other
+            const int noDelay = 1;
+            setsockopt(socket.handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay),
+                       sizeof(noDelay));
+
+            return socket;
+        }
+    }
+
+    freeaddrinfo(addresses);
+    throw std::runtime_error("[Error] Failed to connect to '" + host + ":" + std::to_string(port) + "'!");
+}
+
+Socket Socket::listen(uint16_t port) {
+    Socket socket(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (socket.handle == invalidHandle)
+        throw std::runtime_error("[Error] Failed to create a socket!");
+
+    // a restarted coordinator can listen on the same port right away
+    const int reuseAddress = 1;
+    setsockopt(socket.handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress),
+               sizeof(reuseAddress));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(socket.handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(socket.handle, SOMAXCONN) != 0)
+        throw std::runtime_error("[Error] Failed to listen on port " + std::to_string(port) + "!");
+
+    return socket;
+}
+
+std::optional<Socket> Socket::accept(uint32_t timeoutMs) const {
+    pollfd pollHandle = {.fd = handle, .events = POLLIN, .revents = 0};
+
+    if (pollHandles(&pollHandle, 1, static_cast<int>(timeoutMs)) <= 0)
+        return std::nullopt;
+
+    Socket socket(::accept(handle, nullptr, nullptr));
+    if (socket.handle == invalidHandle)
+        return std::nullopt;
+
+    const int noDelay = 1;
+    setsockopt(socket.handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+    return socket;
+}
+
+void Socket::send(const void* data, size_t size) const {
+    const auto* bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        const int chunkSize = static_cast<int>(std::min<size_t>(size, 1 << 30));
+        const auto sentSize = ::send(handle, bytes, chunkSize, SEND_FLAGS);
+
+        if (sentSize <= 0)
+            throw std::runtime_error("[Error] Failed to send to " + getPeerName() + "!");
+
+        bytes += sentSize;
+        size -= size_t(sentSize);
+    }
+}
+
+void Socket::receive(void* data, size_t size) const {
+    auto* bytes = static_cast<char*>(data);
+
+    while (size > 0) {
+        const int chunkSize = static_cast<int>(std::min<size_t>(size, 1 << 30));
+        const auto receivedSize = ::recv(handle, bytes, chunkSize, 0);
+
+        if (receivedSize <= 0)
+            throw std::runtime_error("[Error] Connection to " + getPeerName() + " lost!");
+
+        bytes += receivedSize;
+        size -= size_t(receivedSize);
+    }
+}
+
+void Socket::setReceiveTimeout(uint32_t seconds) const {
+#ifdef _WIN32
+    const DWORD timeout = seconds * 1000;
+#else
+    const timeval timeout = {.tv_sec = static_cast<time_t>(seconds), .tv_usec = 0};
+#endif
+
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+std::string Socket::getPeerName() const {
+    sockaddr_storage address = {};
+    socklen_t addressSize = sizeof(address);
+
+    if (getpeername(handle, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0)
+        return "unknown peer";
+
+    char host[NI_MAXHOST], service[NI_MAXSERV];
+    if (getnameinfo(reinterpret_cast<const sockaddr*>(&address), addressSize, host, sizeof(host), service,
+                    sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+        return "unknown peer";
+
+    return std::string(host) + ":" + service;
+}
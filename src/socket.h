@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+// A blocking TCP socket on top of Winsock or BSD sockets. Errors and closed connections throw std::runtime_error.
+class Socket {
+public:
+    Socket() = default;
+
+    ~Socket();
+
+    Socket(Socket &&other) noexcept;
+
+    Socket &operator=(Socket &&other) noexcept;
+
+    Socket(const Socket &) = delete;
+
+    Socket &operator=(const Socket &) = delete;
+
+    [[nodiscard]] static Socket connect(const std::string &host, uint16_t port);
+
+    // on all interfaces
+    [[nodiscard]] static Socket listen(uint16_t port);
+
+    // empty if no connection arrived within the timeout
+    [[nodiscard]] std::optional<Socket> accept(uint32_t timeoutMs) const;
+
+    // all of the bytes, or throws
+    void send(const void* data, size_t size) const;
+
+    // exactly size bytes, or throws (also if the other side closed the connection or the timeout elapsed)
+    void receive(void* data, size_t size) const;
+
+    // 0: wait forever
+    void setReceiveTimeout(uint32_t seconds) const;
+
+    // the address of the other side, e.g. "127.0.0.1:51234"
+    [[nodiscard]] std::string getPeerName() const;
+
+private:
+    SocketHandle handle = invalidHandle;
+
+#ifdef _WIN32
+    static constexpr SocketHandle invalidHandle = ~SocketHandle(0);
+#else
+    static constexpr SocketHandle invalidHandle = -1;
+#endif
+
+    explicit Socket(SocketHandle handle);
+
+    void close();
+};
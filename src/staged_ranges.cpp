@@ -0,0 +1,62 @@
+#include "staged_ranges.h"
+#include <iterator>
+
+void StagedRanges::add(uint64_t sourceOffset, uint64_t destinationOffset, uint64_t size) {
+    if (size == 0)
+        return;
+
+    const uint64_t end = destinationOffset + size;
+
+    // the range before the first one starting within the new range may reach into it
+    auto range = ranges.lower_bound(destinationOffset);
+    if (range != ranges.begin()) {
+        const StagedRange &previous = std::prev(range)->second;
+        if (previous.destinationOffset + previous.size > destinationOffset) {
+            range = std::prev(range);
+        }
+    }
+
+    std::vector<StagedRange> remainders;
+
+    while (range != ranges.end() && range->first < end) {
+        const StagedRange overlapped = range->second;
+        const uint64_t overlappedEnd = overlapped.destinationOffset + overlapped.size;
+        range = ranges.erase(range);
+
+        if (overlapped.destinationOffset < destinationOffset) {
+            remainders.push_back(
+                    {
+                            .sourceOffset = overlapped.sourceOffset,
+                            .destinationOffset = overlapped.destinationOffset,
+                            .size = destinationOffset - overlapped.destinationOffset
+                    });
+        }
+
+        if (overlappedEnd > end) {
+            remainders.push_back(
+                    {
+                            .sourceOffset = overlapped.sourceOffset + (end - overlapped.destinationOffset),
+                            .destinationOffset = end,
+                            .size = overlappedEnd - end
+                    });
+        }
+    }
+
+    for (const StagedRange &remainder: remainders) {
+        ranges.emplace(remainder.destinationOffset, remainder);
+    }
+
+    ranges.emplace(destinationOffset,
+                   StagedRange{.sourceOffset = sourceOffset, .destinationOffset = destinationOffset, .size = size});
+}
+
+std::vector<StagedRange> StagedRanges::getRanges() const {
+    std::vector<StagedRange> sortedRanges;
+    sortedRanges.reserve(ranges.size());
+
+    for (const auto &[destinationOffset, range]: ranges) {
+        sortedRanges.push_back(range);
+    }
+
+    return sortedRanges;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// bytes staged at sourceOffset of an upload buffer, which are copied to destinationOffset of a destination buffer
+struct StagedRange {
+    uint64_t sourceOffset;
+    uint64_t destinationOffset;
+    uint64_t size;
+};
+
+
+// The ranges staged for a single destination buffer until they are copied. A range replaces the bytes of the ones
+// staged before it, which are cut or dropped where they overlap, so the ranges never overlap in the destination (as a
+// single vkCmdCopyBuffer requires) and the bytes staged last are the ones that are copied.
+class StagedRanges {
+public:
+    void add(uint64_t sourceOffset, uint64_t destinationOffset, uint64_t size);
+
+    // sorted by their destination offset
+    [[nodiscard]] std::vector<StagedRange> getRanges() const;
+
+private:
+    std::map<uint64_t, StagedRange> ranges; // by destination offset
+};
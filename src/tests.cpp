@@ -0,0 +1,651 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "image_encoder.h"
+#include "json.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "staged_ranges.h"
+#include "tile_scheduler.h"
+
+// Round-trip tests of the parts that don't need a device: the written files are decoded again by the independent,
+// minimal readers below and compared against what was written. A failed check throws.
+namespace {
+    void check(bool condition, const std::string &message) {
+        if (!condition)
+            throw std::runtime_error(message);
+    }
+
+    std::string getTemporaryPath(const std::string &name) {
+        return (std::filesystem::temp_directory_path() / ("ray_tracing_gpu_test_" + name)).string();
+    }
+
+    std::vector<uint8_t> readFile(const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        check(file.is_open(), "Failed to open '" + path + "'");
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    uint32_t readBigEndian(const uint8_t* data) {
+        return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | uint32_t(data[3]);
+    }
+
+    // an RGBA image with gradients, noise and flat areas, so every kind of encoding is used
+    std::vector<uint8_t> createTestImage(uint32_t width, uint32_t height) {
+        std::vector<uint8_t> pixels(size_t(width) * height * 4);
+        uint32_t random = 12345;
+
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                uint8_t* pixel = pixels.data() + (size_t(y) * width + x) * 4;
+                random = random * 1664525u + 1013904223u;
+
+                if (y < height / 3) {
+                    pixel[0] = uint8_t(x * 3), pixel[1] = uint8_t(y * 5), pixel[2] = uint8_t(x + y), pixel[3] = 255;
+                } else if (y < 2 * height / 3) {
+                    pixel[0] = 40, pixel[1] = 80, pixel[2] = 120, pixel[3] = x < width / 2 ? 255 : 128;
+                } else {
+                    std::memcpy(pixel, &random, 4);
+                }
+            }
+        }
+
+        return pixels;
+    }
+
+
+    // Inflate of the block types the encoder writes: stored and fixed Huffman codes.
+    class Inflater {
+    public:
+        explicit Inflater(const std::vector<uint8_t> &data) : data(data) {}
+
+        std::vector<uint8_t> inflate() {
+            std::vector<uint8_t> output;
+            bool isFinalBlock = false;
+
+            while (!isFinalBlock) {
+                isFinalBlock = readBits(1);
+                const uint32_t blockType = readBits(2);
+
+                if (blockType == 0) {
+                    bitPosition = (bitPosition + 7) / 8 * 8;
+                    const uint32_t length = readBits(16);
+                    check((readBits(16) ^ 0xFFFF) == length, "Stored block length mismatch");
+
+                    for (uint32_t i = 0; i < length; i++) {
+                        output.push_back(uint8_t(readBits(8)));
+                    }
+                } else if (blockType == 1) {
+                    inflateFixedBlock(output);
+                } else {
+                    throw std::runtime_error("Unexpected deflate block type " + std::to_string(blockType));
+                }
+            }
+
+            bytesRead = (bitPosition + 7) / 8;
+            return output;
+        }
+
+        [[nodiscard]] size_t getBytesRead() const {
+            return bytesRead;
+        }
+
+    private:
+        const std::vector<uint8_t> &data;
+        size_t bitPosition = 0;
+        size_t bytesRead = 0;
+
+        uint32_t readBits(uint32_t count) {
+            uint32_t value = 0;
+
+            for (uint32_t i = 0; i < count; i++, bitPosition++) {
+                check(bitPosition / 8 < data.size(), "Deflate stream ends early");
+                value |= uint32_t(data[bitPosition / 8] >> (bitPosition % 8) & 1) << i;
+            }
+
+            return value;
+        }
+
+        // the codes of RFC 1951 3.2.6, read most significant bit first
+        uint32_t readLiteralOrLength() {
+            uint32_t code = 0;
+
+            for (uint32_t length = 1; length <= 9; length++) {
+                code = code << 1 | readBits(1);
+
+                if (length == 7 && code <= 23)
+                    return 256 + code;
+                if (length == 8 && code >= 48 && code <= 191)
+                    return code - 48;
+                if (length == 8 && code >= 192 && code <= 199)
+                    return 280 + code - 192;
+                if (length == 9 && code >= 400)
+                    return 144 + code - 400;
+            }
+
+            throw std::runtime_error("Invalid fixed Huffman code");
+        }
+
+        void inflateFixedBlock(std::vector<uint8_t> &output) {
+            static const uint32_t LENGTH_BASES[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51,
+                                                    59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const uint32_t LENGTH_EXTRA_BITS[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4,
+                                                         4, 4, 4, 5, 5, 5, 5, 0};
+            static const uint32_t DISTANCE_BASES[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+                                                      385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+                                                      16385, 24577};
+
+            while (true) {
+                const uint32_t symbol = readLiteralOrLength();
+
+                if (symbol < 256) {
+                    output.push_back(uint8_t(symbol));
+                    continue;
+                }
+
+                if (symbol == 256)
+                    return;
+
+                check(symbol <= 285, "Invalid length symbol");
+                const uint32_t length = LENGTH_BASES[symbol - 257] + readBits(LENGTH_EXTRA_BITS[symbol - 257]);
+
+                uint32_t distanceSymbol = 0;
+                for (uint32_t i = 0; i < 5; i++) {
+                    distanceSymbol = distanceSymbol << 1 | readBits(1);
+                }
+
+                check(distanceSymbol < 30, "Invalid distance symbol");
+                const uint32_t extraBits = distanceSymbol < 4 ? 0 : distanceSymbol / 2 - 1;
+                const size_t distance = DISTANCE_BASES[distanceSymbol] + readBits(extraBits);
+                check(distance <= output.size(), "Distance before the start of the stream");
+
+                for (uint32_t i = 0; i < length; i++) {
+                    output.push_back(output[output.size() - distance]);
+                }
+            }
+        }
+    };
+
+    uint32_t calculateCrc32(const uint8_t* data, size_t size) {
+        uint32_t crc = 0xFFFFFFFFu;
+
+        for (size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+        }
+
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    uint8_t paethPredictor(uint8_t left, uint8_t above, uint8_t aboveLeft) {
+        const int estimate = int(left) + above - aboveLeft;
+        const int distanceLeft = std::abs(estimate - left), distanceAbove = std::abs(estimate - above),
+                distanceAboveLeft = std::abs(estimate - aboveLeft);
+
+        if (distanceLeft <= distanceAbove && distanceLeft <= distanceAboveLeft)
+            return left;
+
+        return distanceAbove <= distanceAboveLeft ? above : aboveLeft;
+    }
+
+    // only 8-bit RGBA without interlacing, as written by the encoder
+    std::vector<uint8_t> decodePng(const std::vector<uint8_t> &file, uint32_t &width, uint32_t &height) {
+        const uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        check(file.size() >= 8 && std::memcmp(file.data(), SIGNATURE, 8) == 0, "Missing PNG signature");
+
+        std::vector<uint8_t> zlibStream;
+        bool hasEnd = false;
+
+        for (size_t position = 8; position < file.size() && !hasEnd;) {
+            check(position + 12 <= file.size(), "Truncated PNG chunk");
+            const uint32_t length = readBigEndian(file.data() + position);
+            check(position + 12 + length <= file.size(), "Truncated PNG chunk");
+
+            const std::string type(reinterpret_cast<const char*>(file.data() + position + 4), 4);
+            const uint8_t* chunkData = file.data() + position + 8;
+            check(calculateCrc32(file.data() + position + 4, length + 4) == readBigEndian(chunkData + length),
+                  "CRC mismatch of a " + type + " chunk");
+
+            if (type == "IHDR") {
+                width = readBigEndian(chunkData);
+                height = readBigEndian(chunkData + 4);
+                check(chunkData[8] == 8 && chunkData[9] == 6 && chunkData[12] == 0, "Not 8-bit RGBA");
+            } else if (type == "IDAT") {
+                zlibStream.insert(zlibStream.end(), chunkData, chunkData + length);
+            } else if (type == "IEND") {
+                hasEnd = true;
+            }
+
+            position += 12 + length;
+        }
+
+        check(hasEnd, "Missing IEND chunk");
+        check(zlibStream.size() >= 6 && (zlibStream[0] * 256 + zlibStream[1]) % 31 == 0, "Invalid zlib header");
+
+        const std::vector<uint8_t> deflateStream(zlibStream.begin() + 2, zlibStream.end());
+        Inflater inflater(deflateStream);
+        const std::vector<uint8_t> filtered = inflater.inflate();
+
+        uint32_t a = 1, b = 0;
+        for (const uint8_t byte: filtered) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        check(inflater.getBytesRead() + 4 == deflateStream.size(), "Unexpected data after the deflate stream");
+        check(readBigEndian(deflateStream.data() + inflater.getBytesRead()) == (b << 16 | a), "Adler-32 mismatch");
+
+        const size_t rowSize = size_t(width) * 4;
+        check(filtered.size() == (rowSize + 1) * height, "Unexpected size of the image data");
+
+        std::vector<uint8_t> pixels(rowSize * height);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t filter = filtered[y * (rowSize + 1)];
+            const uint8_t* input = filtered.data() + y * (rowSize + 1) + 1;
+            uint8_t* row = pixels.data() + y * rowSize;
+            const uint8_t* above = y > 0 ? row - rowSize : nullptr;
+
+            for (size_t i = 0; i < rowSize; i++) {
+                const uint8_t left = i >= 4 ? row[i - 4] : 0;
+                const uint8_t up = above ? above[i] : 0;
+                const uint8_t upLeft = above && i >= 4 ? above[i - 4] : 0;
+
+                switch (filter) {
+                    case 0:
+                        row[i] = input[i];
+                        break;
+                    case 1:
+                        row[i] = uint8_t(input[i] + left);
+                        break;
+                    case 2:
+                        row[i] = uint8_t(input[i] + up);
+                        break;
+                    case 3:
+                        row[i] = uint8_t(input[i] + (left + up) / 2);
+                        break;
+                    case 4:
+                        row[i] = uint8_t(input[i] + paethPredictor(left, up, upLeft));
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid PNG filter type " + std::to_string(filter));
+                }
+            }
+        }
+
+        return pixels;
+    }
+
+    std::vector<uint8_t> decodeQoi(const std::vector<uint8_t> &file, uint32_t &width, uint32_t &height) {
+        check(file.size() >= 22 && std::memcmp(file.data(), "qoif", 4) == 0, "Missing QOI header");
+        width = readBigEndian(file.data() + 4);
+        height = readBigEndian(file.data() + 8);
+        check(file[12] == 4, "Not RGBA");
+
+        std::vector<uint8_t> pixels;
+        pixels.reserve(size_t(width) * height * 4);
+
+        uint8_t index[64][4] = {};
+        uint8_t pixel[4] = {0, 0, 0, 255};
+        size_t position = 14;
+        const size_t end = file.size() - 8;
+
+        while (pixels.size() < size_t(width) * height * 4) {
+            check(position < end, "QOI data ends early");
+            const uint8_t tag = file[position++];
+            uint32_t run = 1;
+
+            if (tag == 0xFE) {
+                std::memcpy(pixel, &file[position], 3);
+                position += 3;
+            } else if (tag == 0xFF) {
+                std::memcpy(pixel, &file[position], 4);
+                position += 4;
+            } else if (tag >> 6 == 0) {
+                std::memcpy(pixel, index[tag], 4);
+            } else if (tag >> 6 == 1) {
+                pixel[0] += (tag >> 4 & 3) - 2;
+                pixel[1] += (tag >> 2 & 3) - 2;
+                pixel[2] += (tag & 3) - 2;
+            } else if (tag >> 6 == 2) {
+                const int greenDifference = (tag & 0x3F) - 32;
+                const uint8_t next = file[position++];
+                pixel[0] += greenDifference + (next >> 4) - 8;
+                pixel[1] += greenDifference;
+                pixel[2] += greenDifference + (next & 0xF) - 8;
+            } else {
+                run = (tag & 0x3F) + 1;
+            }
+
+            std::memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+
+            for (uint32_t i = 0; i < run; i++) {
+                pixels.insert(pixels.end(), pixel, pixel + 4);
+            }
+        }
+
+        const uint8_t END_MARKER[] = {0, 0, 0, 0, 0, 0, 0, 1};
+        check(position == end && std::memcmp(&file[end], END_MARKER, 8) == 0, "Missing QOI end marker");
+        check(pixels.size() == size_t(width) * height * 4, "A QOI run exceeds the image");
+
+        return pixels;
+    }
+
+
+    void testImageEncoder(const std::string &extension, uint32_t compressionLevel) {
+        // odd sizes and several threads, so the image is split into strips with a smaller last one
+        const uint32_t width = 67, height = 45;
+        const std::vector<uint8_t> pixels = createTestImage(width, height);
+        const std::string path = getTemporaryPath("image" + extension);
+
+        ImageEncoder(4).write(path, pixels.data(), width, height, compressionLevel);
+
+        uint32_t decodedWidth = 0, decodedHeight = 0;
+        const std::vector<uint8_t> file = readFile(path);
+        const std::vector<uint8_t> decoded = extension == ".qoi" ? decodeQoi(file, decodedWidth, decodedHeight)
+                                                                 : decodePng(file, decodedWidth, decodedHeight);
+        std::filesystem::remove(path);
+
+        check(decodedWidth == width && decodedHeight == height, "Size mismatch");
+        check(decoded == pixels, "Pixel mismatch");
+    }
+
+    void testSceneFile() {
+        const Scene scene = generateScene({.seed = 7, .gridSize = 4});
+        const std::string path = getTemporaryPath("scene.rtscene");
+
+        writeSceneFile(path, scene);
+
+        {
+            const SceneFile sceneFile(path);
+            check(sceneFile.getSpheres().size() == scene.spheres.size(), "Sphere count mismatch");
+            check(sceneFile.getMaterials().size() == scene.materials.size(), "Material count mismatch");
+            check(!sceneFile.getBvhNodes().empty(), "Missing BVH");
+            check(std::memcmp(&sceneFile.getCamera(), &scene.camera, sizeof(Camera)) == 0, "Camera mismatch");
+
+            const glm::vec3 backgroundColor = sceneFile.getBackgroundColor();
+            check(std::memcmp(&backgroundColor, &scene.backgroundColor, sizeof(glm::vec3)) == 0,
+                  "Background color mismatch");
+            for (size_t i = 0; i < scene.materials.size(); i++) {
+                const Material &expected = scene.materials[i], &loaded = sceneFile.getMaterials()[i];
+                check(loaded.type == expected.type && loaded.textureType == expected.textureType &&
+                      loaded.specificAttribute == expected.specificAttribute &&
+                      std::memcmp(&loaded.colors[0].color, &expected.colors[0].color, sizeof(glm::vec3)) == 0 &&
+                      std::memcmp(&loaded.colors[1].color, &expected.colors[1].color, sizeof(glm::vec3)) == 0,
+                      "Material mismatch");
+            }
+
+            // the spheres are reordered by the BVH, the padding between their members is left out of the comparison
+            const auto getKey = [](const Sphere &sphere) {
+                return std::tuple(sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius,
+                                  sphere.materialIndex);
+            };
+
+            std::vector<std::tuple<float, float, float, float, uint32_t>> expected, loaded;
+            std::transform(scene.spheres.begin(), scene.spheres.end(), std::back_inserter(expected), getKey);
+            std::transform(sceneFile.getSpheres().begin(), sceneFile.getSpheres().end(), std::back_inserter(loaded),
+                           getKey);
+            std::sort(expected.begin(), expected.end());
+            std::sort(loaded.begin(), loaded.end());
+
+            check(loaded == expected, "Sphere mismatch");
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    // every corruption has to be rejected when the file is loaded, instead of being followed by the shader
+    void testCorruptedSceneFile() {
+        const std::string path = getTemporaryPath("corrupted.rtscene");
+        writeSceneFile(path, generateScene({.seed = 7, .gridSize = 4}));
+
+        SceneFileHeader header = {};
+        std::vector<BVHNode> nodes;
+        std::vector<Material> materials;
+        {
+            const SceneFile sceneFile(path);
+            std::memcpy(&header, readFile(path).data(), sizeof(header));
+            nodes.assign(sceneFile.getBvhNodes().begin(), sceneFile.getBvhNodes().end());
+            materials.assign(sceneFile.getMaterials().begin(), sceneFile.getMaterials().end());
+        }
+
+        // the root of the generated scene is an inner node
+        const auto firstLeaf = static_cast<size_t>(std::find_if(nodes.begin(), nodes.end(), [](const BVHNode &node) {
+            return node.sphereCount > 0;
+        }) - nodes.begin());
+
+        using Corruption = std::function<void(std::vector<BVHNode> &, std::vector<Material> &)>;
+        const std::vector<std::pair<std::string, Corruption>> corruptions = {
+                {"BVH leaf beyond the spheres", [&](std::vector<BVHNode> &corrupted, std::vector<Material> &) {
+                    corrupted[firstLeaf].offset = uint32_t(header.sphereCount);
+                }},
+                {"BVH child beyond the nodes", [&](std::vector<BVHNode> &corrupted, std::vector<Material> &) {
+                    corrupted[0].offset = uint32_t(corrupted.size());
+                }},
+                {"BVH cycle", [&](std::vector<BVHNode> &corrupted, std::vector<Material> &) {
+                    corrupted[0].offset = 0;
+                }},
+                {"BVH that is too deep", [&](std::vector<BVHNode> &corrupted, std::vector<Material> &) {
+                    // a chain of inner nodes, each with a leaf as its second child, and a leaf at the end
+                    const BVHNode leaf = corrupted[firstLeaf];
+                    corrupted.assign(2 * BVH_MAX_DEPTH + 1, leaf);
+
+                    for (uint32_t i = 0; i < BVH_MAX_DEPTH; i++) {
+                        corrupted[i].offset = BVH_MAX_DEPTH + 1 + i;
+                        corrupted[i].sphereCount = 0;
+                    }
+                }},
+                {"single inner BVH root with bounds", [&](std::vector<BVHNode> &corrupted, std::vector<Material> &) {
+                    // unlike the root of an empty scene, the traversal would read its children
+                    corrupted.resize(1);
+                }},
+                {"unknown material type", [&](std::vector<BVHNode> &, std::vector<Material> &corrupted) {
+                    corrupted[0].type = 3;
+                }},
+                {"unknown texture type", [&](std::vector<BVHNode> &, std::vector<Material> &corrupted) {
+                    corrupted[0].textureType = 2;
+                }}
+        };
+
+        for (const auto &[name, corrupt]: corruptions) {
+            std::vector<BVHNode> corruptedNodes = nodes;
+            std::vector<Material> corruptedMaterials = materials;
+            corrupt(corruptedNodes, corruptedMaterials);
+
+            std::vector<uint8_t> file = readFile(path);
+            SceneFileHeader corruptedHeader = header;
+            corruptedHeader.bvhNodeCount = corruptedNodes.size();
+            file.resize(header.bvhNodeOffset + corruptedNodes.size() * sizeof(BVHNode));
+            std::memcpy(file.data(), &corruptedHeader, sizeof(corruptedHeader));
+            std::memcpy(file.data() + header.materialOffset, corruptedMaterials.data(),
+                        corruptedMaterials.size() * sizeof(Material));
+            std::memcpy(file.data() + header.bvhNodeOffset, corruptedNodes.data(),
+                        corruptedNodes.size() * sizeof(BVHNode));
+
+            const std::string corruptedPath = getTemporaryPath("corrupted_scene.rtscene");
+            std::ofstream(corruptedPath, std::ios::binary).write(reinterpret_cast<const char*>(file.data()),
+                                                                  static_cast<std::streamsize>(file.size()));
+
+            bool hasThrown = false;
+            try {
+                const SceneFile sceneFile(corruptedPath);
+            } catch (const std::runtime_error &) {
+                hasThrown = true;
+            }
+
+            std::filesystem::remove(corruptedPath);
+            check(hasThrown, "A scene file with a " + name + " was accepted");
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    void testTileScheduler() {
+        const uint32_t width = 100, height = 70, samples = 4;
+        const double budgetMs = 30.0, costPerPixelSampleMs = 0.001;
+
+        TileScheduler scheduler(width, height, 16, 16, TileOrder::COST, budgetMs, 1);
+        const auto getCostMs = [&](uint32_t index) {
+            const Tile &tile = scheduler.getTile(index);
+            return double(tile.width) * tile.height * samples * costPerPixelSampleMs;
+        };
+
+        bool hasBatchedTiles = false;
+
+        for (uint32_t renderCall = 0; renderCall < 3; renderCall++) {
+            std::vector<uint32_t> coverage(size_t(width) * height, 0);
+            scheduler.beginRenderCall(samples);
+
+            while (!scheduler.isRenderCallComplete()) {
+                const std::vector<uint32_t> batch = scheduler.nextBatch();
+                check(!batch.empty(), "Empty batch before the render call is complete");
+
+                std::vector<double> timesMs;
+                for (const uint32_t index: batch) {
+                    const Tile &tile = scheduler.getTile(index);
+                    check(tile.x + tile.width <= width && tile.y + tile.height <= height, "Tile outside the image");
+
+                    for (uint32_t y = tile.y; y < tile.y + tile.height; y++) {
+                        for (uint32_t x = tile.x; x < tile.x + tile.width; x++) {
+                            coverage[size_t(y) * width + x]++;
+                        }
+                    }
+
+                    timesMs.push_back(getCostMs(index));
+                }
+
+                const double batchCostMs = std::accumulate(timesMs.begin(), timesMs.end(), 0.0);
+                check(batch.size() == 1 || batchCostMs <= budgetMs, "Batch exceeds the time budget");
+                hasBatchedTiles = hasBatchedTiles || batch.size() > 1;
+
+                scheduler.reportTileTimes(batch, timesMs, samples);
+            }
+
+            check(std::all_of(coverage.begin(), coverage.end(), [](uint32_t count) { return count == 1; }),
+                  "Every pixel has to be rendered exactly once per render call");
+        }
+
+        check(hasBatchedTiles, "The tiles are never batched");
+
+        // without any reported times, e.g. on devices without timestamps
+        TileScheduler untimedScheduler(width, height, 16, 16, TileOrder::CENTER_FIRST, budgetMs, 8);
+        untimedScheduler.beginRenderCall(samples);
+
+        for (uint32_t tiles = 0; tiles < untimedScheduler.getTileCount(); tiles += 8) {
+            const std::vector<uint32_t> batch = untimedScheduler.nextBatch();
+            check(batch.size() == std::min(8u, untimedScheduler.getTileCount() - tiles),
+                  "Unmeasured batches have to hold the fixed amount of tiles");
+        }
+
+        check(untimedScheduler.isRenderCallComplete(), "The untimed render call isn't complete");
+    }
+
+    void testStagedRanges() {
+        // the same range staged twice, e.g. by two cameras set before a render call
+        StagedRanges sameRange;
+        sameRange.add(0, 32, 64);
+        sameRange.add(64, 32, 64);
+
+        const std::vector<StagedRange> sameRanges = sameRange.getRanges();
+        check(sameRanges.size() == 1 && sameRanges[0].sourceOffset == 64 && sameRanges[0].destinationOffset == 32 &&
+              sameRanges[0].size == 64, "The range staged last doesn't replace the same range staged before");
+
+        // partly overlapping ranges, copied at once, have to write the same bytes as copying each one in order
+        std::vector<uint8_t> upload, expected(256, 0), copied(256, 0);
+        StagedRanges stagedRanges;
+
+        for (uint32_t i = 0; i < 64; i++) {
+            const uint64_t offset = (i * 37) % 200, size = 1 + (i * 13) % 56;
+            stagedRanges.add(upload.size(), offset, size);
+
+            for (uint64_t byte = 0; byte < size; byte++) {
+                upload.push_back(uint8_t(i + 1));
+                expected[offset + byte] = uint8_t(i + 1);
+            }
+        }
+
+        uint64_t end = 0;
+        for (const StagedRange &range: stagedRanges.getRanges()) {
+            check(range.size > 0 && range.destinationOffset >= end, "The staged ranges overlap");
+            end = range.destinationOffset + range.size;
+
+            std::copy_n(upload.begin() + std::ptrdiff_t(range.sourceOffset), range.size,
+                        copied.begin() + std::ptrdiff_t(range.destinationOffset));
+        }
+
+        check(copied == expected, "The staged ranges don't write the bytes staged last");
+    }
+
+    void testJson() {
+        const JsonValue value = JsonValue::Object{
+                {"name", "a \"quoted\"\\ name\n"},
+                {"numbers", JsonValue::Array{0.1, 1e-300, uint64_t(12345678901), -7, uint32_t(0)}},
+                {"flags", JsonValue::Array{true, false, JsonValue()}},
+                {"nested", JsonValue::Object{{"empty", JsonValue::Array{}}, {"object", JsonValue::Object{}}}}
+        };
+
+        std::stringstream text;
+        value.write(text);
+        const JsonValue parsed = JsonValue::parse(text.str());
+
+        std::stringstream rewrittenText;
+        parsed.write(rewrittenText);
+        check(rewrittenText.str() == text.str(), "The rewritten JSON differs");
+
+        check(parsed["name"].asString() == "a \"quoted\"\\ name\n", "String mismatch");
+        check(parsed["numbers"].asArray()[0].asNumber() == 0.1, "Number mismatch");
+        check(parsed["numbers"].asArray()[2].asNumber() == 12345678901.0, "Number mismatch");
+        check(parsed["flags"].asArray()[0].asBool() && parsed["flags"].asArray()[2].isNull(), "Literal mismatch");
+        check(parsed["missing"].isNull(), "A missing member has to be null");
+
+        for (const std::string invalid: {"", "{", "[1,]", "{\"a\" 1}", "01x", "\"unterminated", "[1] 2"}) {
+            bool hasThrown = false;
+
+            try {
+                (void) JsonValue::parse(invalid);
+            } catch (const std::runtime_error &) {
+                hasThrown = true;
+            }
+
+            check(hasThrown, "Invalid JSON '" + invalid + "' was accepted");
+        }
+    }
+}
+
+int main() {
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+            {"PNG stored", [] { testImageEncoder(".png", 0); }},
+            {"PNG fixed Huffman", [] { testImageEncoder(".png", 6); }},
+            {"QOI", [] { testImageEncoder(".qoi", 0); }},
+            {"Scene file", testSceneFile},
+            {"Corrupted scene file", testCorruptedSceneFile},
+            {"Tile scheduler", testTileScheduler},
+            {"Staged ranges", testStagedRanges},
+            {"JSON", testJson}
+    };
+
+    uint32_t failures = 0;
+
+    for (const auto &[name, test]: tests) {
+        try {
+            test();
+            std::cout << "[PASS] " << name << std::endl;
+        } catch (const std::exception &exception) {
+            std::cout << "[FAIL] " << name << ": " << exception.what() << std::endl;
+            failures++;
+        }
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed amount of worker threads that run the submitted tasks in the order of submission.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount); // 0: one thread per hardware thread
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // can be called from any thread, the future rethrows exceptions of the task
+    std::future<void> submit(std::function<void()> task);
+
+    [[nodiscard]] uint32_t getThreadCount() const;
+
+private:
+    std::vector<std::thread> threads;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool isStopping = false;
+
+    void work();
+};
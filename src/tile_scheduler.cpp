@@ -0,0 +1,123 @@
+#include "tile_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+TileScheduler::TileScheduler(uint32_t imageWidth, uint32_t imageHeight, uint32_t tileWidth, uint32_t tileHeight,
+                             TileOrder order, double timeBudgetMs, uint32_t unmeasuredTilesPerBatch) :
+        tileOrder(order), timeBudgetMs(timeBudgetMs), unmeasuredTilesPerBatch(std::max(unmeasuredTilesPerBatch, 1u)) {
+    if (tileWidth == 0 || tileHeight == 0)
+        throw std::runtime_error("The tile size has to be at least one pixel!");
+
+    for (uint32_t y = 0; y < imageHeight; y += tileHeight) {
+        for (uint32_t x = 0; x < imageWidth; x += tileWidth) {
+            tiles.push_back(
+                    {
+                            .x = x,
+                            .y = y,
+                            .width = std::min(tileWidth, imageWidth - x),
+                            .height = std::min(tileHeight, imageHeight - y)
+                    });
+        }
+    }
+
+    costPerSampleMs.resize(tiles.size(), 0.0);
+
+    // the center of the image usually is what the viewer looks at first
+    const double centerX = imageWidth / 2.0, centerY = imageHeight / 2.0;
+    const auto distanceToCenter = [&](uint32_t index) {
+        const Tile &tile = tiles[index];
+        return std::hypot(tile.x + tile.width / 2.0 - centerX, tile.y + tile.height / 2.0 - centerY);
+    };
+
+    this->order.resize(tiles.size());
+    std::iota(this->order.begin(), this->order.end(), 0);
+    std::stable_sort(this->order.begin(), this->order.end(), [&](uint32_t a, uint32_t b) {
+        return distanceToCenter(a) < distanceToCenter(b);
+    });
+
+    nextTile = this->order.size();
+}
+
+void TileScheduler::beginRenderCall(uint32_t samples) {
+    samplesPerPass = std::max(samples, 1u);
+    nextTile = 0;
+
+    // the most expensive tiles first, tiles that haven't been measured yet keep their position from the center
+    if (tileOrder == TileOrder::COST) {
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return costPerSampleMs[a] > costPerSampleMs[b];
+        });
+    }
+}
+
+bool TileScheduler::isRenderCallComplete() const {
+    return nextTile >= order.size();
+}
+
+std::vector<uint32_t> TileScheduler::nextBatch() {
+    std::vector<uint32_t> batch;
+
+    // a fixed amount of tiles until the first tile times have been reported
+    if (averageCostPerPixelMs == 0.0) {
+        while (nextTile < order.size() && batch.size() < unmeasuredTilesPerBatch) {
+            batch.push_back(order[nextTile++]);
+        }
+
+        return batch;
+    }
+
+    double batchCostMs = 0.0;
+
+    while (nextTile < order.size()) {
+        const uint32_t tile = order[nextTile];
+        const double costMs = estimateCostMs(tile);
+
+        if (!batch.empty() && batchCostMs + costMs > timeBudgetMs)
+            break;
+
+        batch.push_back(tile);
+        batchCostMs += costMs;
+        nextTile++;
+    }
+
+    return batch;
+}
+
+void TileScheduler::reportTileTimes(const std::vector<uint32_t> &batch, const std::vector<double> &timesMs,
+                                    uint32_t samples) {
+    for (size_t i = 0; i < batch.size() && i < timesMs.size(); i++) {
+        const double measuredCostMs = timesMs[i] / std::max(samples, 1u);
+        double &costMs = costPerSampleMs[batch[i]];
+
+        // smoothed, as the timestamps between overlapping dispatches only approximate the time of a single tile
+        costMs = costMs > 0.0 ? 0.5 * costMs + 0.5 * measuredCostMs : measuredCostMs;
+    }
+
+    // unmeasured tiles are assumed to cost as much per pixel as the measured ones on average
+    double measuredCostMs = 0.0, measuredPixels = 0.0;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (costPerSampleMs[i] > 0.0) {
+            measuredCostMs += costPerSampleMs[i];
+            measuredPixels += double(tiles[i].width) * tiles[i].height;
+        }
+    }
+
+    averageCostPerPixelMs = measuredPixels > 0.0 ? measuredCostMs / measuredPixels : 0.0;
+}
+
+const Tile &TileScheduler::getTile(uint32_t index) const {
+    return tiles[index];
+}
+
+uint32_t TileScheduler::getTileCount() const {
+    return static_cast<uint32_t>(tiles.size());
+}
+
+double TileScheduler::estimateCostMs(uint32_t tile) const {
+    if (costPerSampleMs[tile] > 0.0)
+        return costPerSampleMs[tile] * samplesPerPass;
+
+    return averageCostPerPixelMs * double(tiles[tile].width) * tiles[tile].height * samplesPerPass;
+}
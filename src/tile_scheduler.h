@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "vulkan_settings.h"
+
+struct Tile {
+    uint32_t x, y; // pixel offset, a multiple of the work group size
+    uint32_t width, height; // smaller at the right and bottom edges of the image
+};
+
+
+// Splits the image into tiles and hands them out in batches whose estimated GPU time fits a time budget, so that no
+// single submission runs long enough to trigger a driver timeout or to stall other work on the queue. The cost of every
+// tile is learned from the GPU time measured for it in earlier batches.
+class TileScheduler {
+public:
+    // Until the first tile times are reported, every batch holds unmeasuredTilesPerBatch tiles, e.g. all of them if the
+    // device has no timestamps to measure the tiles with.
+    TileScheduler(uint32_t imageWidth, uint32_t imageHeight, uint32_t tileWidth, uint32_t tileHeight,
+                  TileOrder order, double timeBudgetMs, uint32_t unmeasuredTilesPerBatch);
+
+    // schedules every tile once more, with the given samples per pixel
+    void beginRenderCall(uint32_t samplesPerPass);
+
+    [[nodiscard]] bool isRenderCallComplete() const;
+
+    // indices of the tiles of the next submission, at least one tile even if it alone exceeds the budget
+    [[nodiscard]] std::vector<uint32_t> nextBatch();
+
+    // GPU time of each tile of a finished batch, rendered with the given samples per pixel
+    void reportTileTimes(const std::vector<uint32_t> &tiles, const std::vector<double> &timesMs,
+                         uint32_t samplesPerPass);
+
+    [[nodiscard]] const Tile &getTile(uint32_t index) const;
+
+    [[nodiscard]] uint32_t getTileCount() const;
+
+private:
+    std::vector<Tile> tiles;
+    std::vector<double> costPerSampleMs; // 0 until the tile has been measured
+    double averageCostPerPixelMs = 0.0; // per sample, over all measured tiles
+    std::vector<uint32_t> order; // of the current render call
+    TileOrder tileOrder;
+    double timeBudgetMs;
+    uint32_t unmeasuredTilesPerBatch;
+
+    uint32_t samplesPerPass = 1;
+    size_t nextTile = 0; // position in order
+
+    [[nodiscard]] double estimateCostMs(uint32_t tile) const;
+};
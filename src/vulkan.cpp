@@ -1,91 +1,515 @@
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-
 #include "vulkan.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <set>
+#include <sstream>
 #include <fstream>
 #include <utility>
-#include <stb_image_write.h>
+#include "pipeline_cache.h"
+
+namespace {
+    // measures a startup phase that runs on its own thread, the time is written once the phase has ended
+    struct PhaseTimer {
+        double &timeMs;
+        const std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+
+        ~PhaseTimer() {
+            timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count();
+        }
+    };
+}
+
+Vulkan::Vulkan(VulkanSettings settings, Scene scene) : Vulkan(std::move(settings), std::move(scene), nullptr) {}
+
+Vulkan::Vulkan(VulkanSettings settings, const SceneFile &sceneFile) :
+        Vulkan(std::move(settings),
+               {.camera = sceneFile.getCamera(), .backgroundColor = sceneFile.getBackgroundColor()},
+               &sceneFile) {}
+
+Vulkan::Vulkan(VulkanSettings settings, Scene scene, const SceneFile* sceneFile) :
+        settings(std::move(settings)), scene(std::move(scene)), imageEncoder(this->settings.encoderThreads),
+        window(nullptr) {
+    // the wavefront kernels resolve every pixel with the same sample count
+    if (this->settings.adaptiveSampling && this->settings.renderMode == RenderMode::WAVEFRONT) {
+        throw std::runtime_error("Adaptive sampling is only supported by the megakernel!");
+    }
+
+    if (this->settings.tiledRendering &&
+        (this->settings.adaptiveSampling || this->settings.renderMode == RenderMode::WAVEFRONT)) {
+        throw std::runtime_error("Tiled rendering is only supported by the megakernel without adaptive sampling!");
+    }
+
+    // the error of a render call has to cover the whole image, not only a batch of tiles
+    if (this->settings.progressive &&
+        (this->settings.tiledRendering || this->settings.renderMode == RenderMode::WAVEFRONT)) {
+        throw std::runtime_error("The progressive mode is only supported by the megakernel without tiled rendering!");
+    }
+
+    // the variance and accumulation images, the tiles and the wavefront buffers only cover a single view
+    if (this->settings.viewCount > 1 &&
+        (this->settings.adaptiveSampling || this->settings.tiledRendering || this->settings.progressive ||
+         this->settings.renderMode == RenderMode::WAVEFRONT)) {
+        throw std::runtime_error("Multiple views are only supported by the megakernel without adaptive sampling, "
+                                 "tiled rendering and the progressive mode!");
+    }
+
+    if (this->settings.viewCount == 0)
+        throw std::runtime_error("At least one view is required!");
+
+    const auto beginTime = std::chrono::steady_clock::now();
+    auto phaseBeginTime = beginTime;
+
+    // ends the current phase of the startup breakdown and begins the next one
+    const auto endPhase = [&](const std::string &name) {
+        const auto endTime = std::chrono::steady_clock::now();
+        startupTimings.phases.push_back(
+                {
+                        .name = name,
+                        .timeMs = std::chrono::duration<double, std::milli>(endTime - phaseBeginTime).count(),
+                        .concurrent = false
+                });
+        phaseBeginTime = endTime;
+    };
+
+    // Neither the BVH nor the files depend on the device, so they are built and read on their own threads while the
+    // instance and the device are created. Declared before the futures, which wait for their threads when an exception
+    // is thrown in between.
+    double bvhTimeMs = 0.0, shaderReadTimeMs = 0.0, pipelineCacheReadTimeMs = 0.0;
+
+    std::future<void> bvhCreation = std::async(std::launch::async, [this, sceneFile, &bvhTimeMs]() {
+        const PhaseTimer timer(bvhTimeMs);
+        createBVH(sceneFile);
+    });
+
+    std::future<ShaderCode> shaderCodeRead = std::async(std::launch::async, [this, &shaderReadTimeMs]() {
+        const PhaseTimer timer(shaderReadTimeMs);
+        return readShaderCode();
+    });
+
+    if (!this->settings.headless) {
+        createWindow();
+        endPhase("window");
+    }
 
-Vulkan::Vulkan(VulkanSettings settings, Scene scene) :
-        settings(std::move(settings)), scene(scene), window(nullptr) {
-    createWindow();
     createInstance();
-    createSurface();
+
+    if (!this->settings.headless) {
+        createSurface();
+    }
+
+    endPhase("instance");
+
     pickPhysicalDevice();
     findQueueFamilies();
+    endPhase("physical device");
+
+    pipelineCachePath = getPipelineCacheFilePath();
+
+    std::future<std::vector<char>> pipelineCacheRead = std::async(
+            std::launch::async, [this, &pipelineCacheReadTimeMs]() {
+                const PhaseTimer timer(pipelineCacheReadTimeMs);
+                return pipelineCachePath.empty() ? std::vector<char>() : readPipelineCache(pipelineCachePath);
+            });
+
     createLogicalDevice();
-    createSceneBuffer();
-    createRenderCallInfoBuffer();
-    createSummedPixelColorImage();
     createCommandPool();
-    createSwapChain();
+    endPhase("logical device");
+
+    bvhCreation.get();
+    createSceneBuffer(sceneFile);
+    endPhase("scene upload");
+
+    createSummedPixelColorImage();
+    createRenderTargetImage();
+    createVarianceImage();
+    createAccumulationImage();
+    createTileWorkListBuffer();
+
+    createPathStatisticsBuffer();
+
+    if (this->settings.renderMode == RenderMode::WAVEFRONT) {
+        createWavefrontBuffers();
+    }
+
+    if (!this->settings.headless) {
+        createSwapChain();
+    }
+
     createDescriptorSetLayout();
     createDescriptorPool();
     createDescriptorSet();
     createPipelineLayout();
-    createPipeline();
-    createCommandBuffer();
-    createFence();
-    createSemaphore();
+    createTimelineSemaphore();
+    createFrames();
+    createQueryPool();
+    createReadbackSlots();
+    initializeImages();
+    endPhase("resources");
+
+    createPipelineCache(pipelineCacheRead.get());
+    endPhase("pipeline cache");
+
+    const ShaderCode shaderCode = shaderCodeRead.get();
+
+    // last, as the autotuner renders with the candidate pipelines
+    createComputeShaderModule(shaderCode.compute);
+
+    if (this->settings.adaptiveSampling) {
+        createTileWorkListPipeline(shaderCode.adaptiveSampling);
+    }
+
+    if (this->settings.tiledRendering) {
+        createTileScheduler();
+    }
+
+    if (this->settings.renderMode == RenderMode::WAVEFRONT) {
+        initializeWavefrontBuffers();
+        createWavefrontPipelines(shaderCode.wavefront);
+    }
+
+    endPhase("pipelines");
+
+    startupTimings.phases.push_back({.name = "BVH", .timeMs = bvhTimeMs, .concurrent = true});
+    startupTimings.phases.push_back({.name = "shader files", .timeMs = shaderReadTimeMs, .concurrent = true});
+    startupTimings.phases.push_back(
+            {.name = "pipeline cache file", .timeMs = pipelineCacheReadTimeMs, .concurrent = true});
+
+    startupTimings.totalMs = std::chrono::duration<double, std::milli>(phaseBeginTime - beginTime).count();
 }
 
 Vulkan::~Vulkan() {
+    waitForScreenshots();
+    device.waitIdle();
+
+    destroyImage(renderTargetImage);
     destroyImage(summedPixelColorImage);
-    destroyBuffer(sceneBuffer);
-    destroyBuffer(renderCallInfoBuffer);
+    destroyImage(varianceImage);
+    destroyImage(accumulationImage);
+    destroyBuffer(tileWorkListBuffer);
+    destroyBuffer(sphereBuffer);
+    destroyBuffer(materialBuffer);
+    destroyBuffer(bvhBuffer);
+    destroyBuffer(cameraBuffer);
+    device.unmapMemory(pathStatisticsBuffer.memory);
+    destroyBuffer(pathStatisticsBuffer);
+
+    if (settings.renderMode == RenderMode::WAVEFRONT) {
+        destroyWavefrontResources();
+    }
 
-    device.destroySemaphore(semaphore);
-    device.destroyFence(fence);
-    device.destroyPipeline(pipeline);
+    for (const Frame &frame: frames) {
+        device.destroySemaphore(frame.imageAvailableSemaphore);
+        device.destroySemaphore(frame.renderFinishedSemaphore);
+
+        if (frame.uploadBuffer.buffer) {
+            device.unmapMemory(frame.uploadBuffer.memory);
+            destroyBuffer(frame.uploadBuffer);
+        }
+    }
+
+    destroyReadbackSlots();
+
+    device.destroySemaphore(timelineSemaphore);
+    device.destroyQueryPool(queryPool);
+    for (const auto &[samplesPerPass, pipeline]: pipelines) {
+        device.destroyPipeline(pipeline);
+    }
+
+    savePipelineCache();
+    device.destroyPipelineCache(pipelineCache);
+
+    device.destroyPipeline(tileWorkListPipeline);
+
+    device.destroyShaderModule(computeShaderModule);
     device.destroyPipelineLayout(pipelineLayout);
     device.destroyDescriptorSetLayout(descriptorSetLayout);
     device.destroyDescriptorPool(descriptorPool);
-    device.destroyImageView(swapChainImageView);
     device.destroySwapchainKHR(swapChain);
     device.destroyCommandPool(commandPool);
     device.destroy();
     instance.destroySurfaceKHR(surface);
     instance.destroy();
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!settings.headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+void Vulkan::restartAccumulation() {
+    accumulationRestartPending = true;
 }
 
 void Vulkan::update() {
-    glfwPollEvents();
+    if (!settings.headless) {
+        glfwPollEvents();
+    }
 }
 
 void Vulkan::render(const RenderCallInfo &renderCallInfo) {
-    updateRenderCallInfoBuffer(renderCallInfo);
+    submittedRenderCallInfo = renderCallInfo;
+
+    if (!tileScheduler) {
+        submitFrame(renderCallInfo);
+        return;
+    }
+
+    // every submission only renders the tiles that fit the time budget, until all tiles have been rendered
+    tileScheduler->beginRenderCall(renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls);
+
+    while (!tileScheduler->isRenderCallComplete()) {
+        submitFrame(renderCallInfo);
+    }
+}
 
-    uint32_t swapChainImageIndex = device.acquireNextImageKHR(swapChain, UINT64_MAX, semaphore).value;
+void Vulkan::submitFrame(const RenderCallInfo &renderCallInfo) {
+    const auto beginTime = std::chrono::steady_clock::now();
 
-    device.resetFences(fence);
+    Frame &frame = frames[currentFrame];
+    currentFrame = (currentFrame + 1) % static_cast<uint32_t>(frames.size());
+
+    // the command buffer of this frame may still be executing, which is the only thing the host has to wait for
+    waitForTimelineValue(frame.timelineValue);
+    collectRenderCallTiming(frame);
+
+    if (settings.collectPathStatistics || settings.adaptiveSampling || settings.progressive) {
+        getPathStatistics(frame) = {};
+    }
+
+    // scheduled after the wait, so the tile costs measured in the finished frame are already taken into account
+    frame.tiles = tileScheduler ? tileScheduler->nextBatch() : std::vector<uint32_t>();
+
+    const auto waitEndTime = std::chrono::steady_clock::now();
+
+    // headless: there is no swap chain, the result stays in the render target image
+    uint32_t swapChainImageIndex = 0;
+    if (!settings.headless) {
+        swapChainImageIndex = device.acquireNextImageKHR(swapChain, UINT64_MAX, frame.imageAvailableSemaphore).value;
+    }
+
+    frame.commandBuffer.reset();
+    recordCommandBuffer(frame, renderCallInfo, settings.headless ? vk::Image() : swapChainImages[swapChainImageIndex]);
+
+    // the staged scene updates are recorded, the next ones are staged once this frame has finished
+    frame.uploadSize = 0;
+    frame.sceneUploads.clear();
+
+    frame.timelineValue = ++submittedTimelineValue;
+
+    const std::vector<vk::Semaphore> signalSemaphores = settings.headless
+                                                        ? std::vector<vk::Semaphore>{timelineSemaphore}
+                                                        : std::vector<vk::Semaphore>{timelineSemaphore,
+                                                                                     frame.renderFinishedSemaphore};
+    // the value for the binary semaphore is ignored
+    const std::vector<uint64_t> signalValues = {frame.timelineValue, 0};
+
+    // the render target must not be overwritten before the last screenshot has been copied out of it on the transfer
+    // queue; the copies of the summed colors for HDR screenshots are submitted to this queue instead, so the barrier
+    // before a restart clears them (see recordCommandBuffer) orders the clear after them
+    std::vector<vk::Semaphore> waitSemaphores = {readbackTimelineSemaphore};
+    std::vector<uint64_t> waitValues = {submittedReadbackValue};
+    std::vector<vk::PipelineStageFlags> waitStages = {vk::PipelineStageFlagBits::eComputeShader};
+
+    if (!settings.headless) {
+        waitSemaphores.push_back(frame.imageAvailableSemaphore);
+        waitValues.push_back(0); // ignored for the binary semaphore
+        waitStages.push_back(vk::PipelineStageFlagBits::eTransfer);
+    }
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+            .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+            .pWaitSemaphoreValues = waitValues.data(),
+            .signalSemaphoreValueCount = static_cast<uint32_t>(signalSemaphores.size()),
+            .pSignalSemaphoreValues = signalValues.data()
+    };
 
     vk::SubmitInfo submitInfo = {
+            .pNext = &timelineSubmitInfo,
+            .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+            .pWaitSemaphores = waitSemaphores.data(),
+            .pWaitDstStageMask = waitStages.data(),
             .commandBufferCount = 1,
-            .pCommandBuffers = &commandBuffer
+            .pCommandBuffers = &frame.commandBuffer,
+            .signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size()),
+            .pSignalSemaphores = signalSemaphores.data()
     };
 
-    computeQueue.submit(1, &submitInfo, fence);
+    computeQueue.submit(1, &submitInfo, nullptr);
 
-    device.waitForFences(1, &fence, true, UINT64_MAX);
-    device.resetFences(fence);
+    if (!settings.headless) {
+        vk::PresentInfoKHR presentInfo = {
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &frame.renderFinishedSemaphore,
+                .swapchainCount = 1,
+                .pSwapchains = &swapChain,
+                .pImageIndices = &swapChainImageIndex
+        };
+
+        presentQueue.presentKHR(presentInfo);
+    }
+
+    double sampledPixels = double(settings.windowWidth) * settings.windowHeight;
+    if (!frame.tiles.empty()) {
+        sampledPixels = 0.0;
+        for (const uint32_t tile: frame.tiles) {
+            sampledPixels += double(tileScheduler->getTile(tile).width) * tileScheduler->getTile(tile).height;
+        }
+    }
+
+    // the GPU time is filled in once the frame has finished executing
+    const auto endTime = std::chrono::steady_clock::now();
+    frame.hasPendingTiming = true;
+    frame.pendingTiming = {
+            .number = renderCallInfo.number,
+            .samples = renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls,
+            .gpuTimeMs = 0.0,
+            .hostOverheadMs = std::chrono::duration<double, std::milli>(endTime - waitEndTime).count(),
+            .hostWaitMs = std::chrono::duration<double, std::milli>(waitEndTime - beginTime).count(),
+            .megaSamplesPerSecond = 0.0,
+            .averagePathLength = 0.0,
+            .sampledPixelFraction = sampledPixels / (double(settings.windowWidth) * settings.windowHeight),
+            .estimatedError = 0.0
+    };
+}
+
+void Vulkan::waitIdle() {
+    waitForTimelineValue(submittedTimelineValue);
+
+    // oldest frame first, so the timings stay ordered by render call
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        collectRenderCallTiming(frames[(currentFrame + i) % frames.size()]);
+    }
+}
+
+bool Vulkan::hasConverged() const {
+    return settings.progressive && !renderCallTimings.empty() &&
+           renderCallTimings.back().estimatedError <= settings.progressiveTargetError;
+}
+
+const std::vector<RenderCallTiming> &Vulkan::getRenderCallTimings() const {
+    return renderCallTimings;
+}
+
+std::vector<ScreenshotTiming> Vulkan::getScreenshotTimings() const {
+    const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+    return screenshotTimings;
+}
+
+std::string Vulkan::getDeviceName() const {
+    return physicalDevice.getProperties().deviceName;
+}
+
+uint32_t Vulkan::getSuitablePhysicalDeviceCount() const {
+    return static_cast<uint32_t>(getSuitablePhysicalDevices().size());
+}
+
+WorkgroupSize Vulkan::getWorkgroupSize() const {
+    return {.x = settings.computeShaderGroupSizeX, .y = settings.computeShaderGroupSizeY};
+}
+
+vk::DeviceSize Vulkan::getAllocatedDeviceMemory() const {
+    return allocatedDeviceMemory;
+}
+
+const StartupTimings &Vulkan::getStartupTimings() const {
+    return startupTimings;
+}
+
+void Vulkan::writeTimingTrace(const std::string &path) const {
+    ::writeTimingTrace(path, renderCallTimings, getScreenshotTimings());
+}
+
+void Vulkan::collectRenderCallTiming(Frame &frame) {
+    if (!frame.hasPendingTiming)
+        return;
 
-    vk::PresentInfoKHR presentInfo = {
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &semaphore,
-            .swapchainCount = 1,
-            .pSwapchains = &swapChain,
-            .pImageIndices = &swapChainImageIndex
+    frame.hasPendingTiming = false;
+    RenderCallTiming timing = frame.pendingTiming;
+
+    // edge tiles are counted as whole tiles
+    if (settings.adaptiveSampling) {
+        timing.sampledPixelFraction = std::min(double(getPathStatistics(frame).sampledTileCount) / getTileCount(), 1.0);
+    }
+
+    if (timestampsSupported && !frame.tiles.empty()) {
+        const std::vector<double> tileTimesMs = readTimestampDurationsMs(frame.queryIndex,
+                                                                         static_cast<uint32_t>(frame.tiles.size()));
+        tileScheduler->reportTileTimes(frame.tiles, tileTimesMs, timing.samples);
+
+        timing.gpuTimeMs = 0.0;
+        for (const double tileTimeMs: tileTimesMs) {
+            timing.gpuTimeMs += tileTimeMs;
+        }
+    } else if (timestampsSupported) {
+        timing.gpuTimeMs = readTimestampDurationMs(frame.queryIndex);
+    }
+
+    if (timestampsSupported) {
+        timing.megaSamplesPerSecond = double(settings.windowWidth) * double(settings.windowHeight) *
+                                      double(settings.viewCount) * double(timing.samples) *
+                                      timing.sampledPixelFraction /
+                                      (timing.gpuTimeMs * 1000.0);
+    }
+
+    if (settings.collectPathStatistics) {
+        const PathStatistics &statistics = getPathStatistics(frame);
+        const uint64_t pathCount = uint64_t(statistics.pathCount[1]) << 32 | statistics.pathCount[0];
+        const uint64_t bounceCount = uint64_t(statistics.bounceCount[1]) << 32 | statistics.bounceCount[0];
+        timing.averagePathLength = pathCount > 0 ? double(bounceCount) / double(pathCount) : 0.0;
+    }
+
+    // pixels skipped by adaptive sampling have converged, they are counted with no error
+    if (settings.progressive) {
+        const PathStatistics &statistics = getPathStatistics(frame);
+        const uint64_t squaredErrorSum = uint64_t(statistics.squaredErrorSum[1]) << 32 | statistics.squaredErrorSum[0];
+        const double pixelCount = settings.adaptiveSampling
+                                  ? double(settings.windowWidth) * settings.windowHeight
+                                  : double(statistics.errorPixelCount);
+        timing.estimatedError = pixelCount > 0.0 ? std::sqrt(double(squaredErrorSum) / 65536.0 / pixelCount) : 0.0;
+    }
+
+    renderCallTimings.push_back(timing);
+}
+
+double Vulkan::readTimestampDurationMs(uint32_t firstQuery) const {
+    return readTimestampDurationsMs(firstQuery, 1).front();
+}
+
+std::vector<double> Vulkan::readTimestampDurationsMs(uint32_t firstQuery, uint32_t durationCount) const {
+    std::vector<uint64_t> timestamps(durationCount + 1);
+
+    // only called once the submission that wrote the queries has finished, so waiting returns immediately
+    static_cast<void>(device.getQueryPoolResults(queryPool, firstQuery, durationCount + 1,
+                                                 timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                                 sizeof(uint64_t),
+                                                 vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait));
+
+    std::vector<double> durationsMs;
+    for (uint32_t i = 0; i < durationCount; i++) {
+        const uint64_t ticks = (timestamps[i + 1] & timestampMask) - (timestamps[i] & timestampMask);
+        durationsMs.push_back(double(ticks) * timestampPeriod / 1e6);
+    }
+
+    return durationsMs;
+}
+
+void Vulkan::waitForTimelineValue(uint64_t value) const {
+    vk::SemaphoreWaitInfo waitInfo = {
+            .semaphoreCount = 1,
+            .pSemaphores = &timelineSemaphore,
+            .pValues = &value
     };
 
-    presentQueue.presentKHR(presentInfo);
+    device.waitSemaphores(waitInfo, UINT64_MAX);
 }
 
 bool Vulkan::shouldExit() const {
-    return glfwWindowShouldClose(window);
+    return settings.headless || glfwWindowShouldClose(window);
 }
 
 void Vulkan::createWindow() {
@@ -120,10 +544,13 @@ void Vulkan::createInstance() {
 
     std::vector<const char*> enabledExtensions;
 
-    uint32_t windowExtensionCount;
-    const char** windowExtensions = glfwGetRequiredInstanceExtensions(&windowExtensionCount);
+    if (!settings.headless) {
+        uint32_t windowExtensionCount;
+        const char** windowExtensions = glfwGetRequiredInstanceExtensions(&windowExtensionCount);
+
+        enabledExtensions.insert(enabledExtensions.end(), windowExtensions, windowExtensions + windowExtensionCount);
+    }
 
-    enabledExtensions.insert(enabledExtensions.end(), windowExtensions, windowExtensions + windowExtensionCount);
     enabledExtensions.insert(enabledExtensions.end(), requiredInstanceExtensions.begin(),
                              requiredInstanceExtensions.end());
 
@@ -159,7 +586,12 @@ void Vulkan::createInstance() {
     instanceCreateInfo.pNext = nullptr;
 #endif
 
-    instance = vk::createInstance(instanceCreateInfo);
+    try {
+        instance = vk::createInstance(instanceCreateInfo);
+    } catch (const vk::SystemError &exception) {
+        // e.g. no driver installed
+        throw VulkanUnavailableError(std::string("Failed to create the Vulkan instance: ") + exception.what());
+    }
 }
 
 void Vulkan::createSurface() {
@@ -167,13 +599,28 @@ void Vulkan::createSurface() {
 }
 
 void Vulkan::pickPhysicalDevice() {
-    std::vector<vk::PhysicalDevice> physicalDevices = instance.enumeratePhysicalDevices();
+    if (instance.enumeratePhysicalDevices().empty()) {
+        throw VulkanUnavailableError("No GPU with Vulkan support found!");
+    }
+
+    const std::vector<vk::PhysicalDevice> physicalDevices = getSuitablePhysicalDevices();
 
-    if (physicalDevices.empty()) {
-        throw std::runtime_error("No GPU with Vulkan support found!");
+    if (physicalDevices.size() <= settings.physicalDeviceIndex) {
+        throw VulkanUnavailableError("No GPU supporting all required features found!");
     }
 
-    for (const vk::PhysicalDevice &d: physicalDevices) {
+    physicalDevice = physicalDevices[settings.physicalDeviceIndex];
+}
+
+std::vector<vk::PhysicalDevice> Vulkan::getSuitablePhysicalDevices() const {
+    const std::vector<const char*> requiredDeviceExtensions = getRequiredDeviceExtensions();
+    std::vector<vk::PhysicalDevice> suitablePhysicalDevices;
+
+    for (const vk::PhysicalDevice &d: instance.enumeratePhysicalDevices()) {
+        const std::string deviceName = d.getProperties().deviceName;
+        if (!settings.physicalDeviceName.empty() && deviceName.find(settings.physicalDeviceName) == std::string::npos)
+            continue;
+
         std::vector<vk::ExtensionProperties> availableExtensions = d.enumerateDeviceExtensionProperties();
         std::set<std::string> requiredExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
 
@@ -181,27 +628,44 @@ void Vulkan::pickPhysicalDevice() {
             requiredExtensions.erase(extension.extensionName);
         }
 
-        if (requiredExtensions.empty()) {
-            physicalDevice = d;
-            return;
+        // timeline semaphores are used to keep several render calls in flight
+        const auto features = d.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        const bool supportsTimelineSemaphores =
+                d.getProperties().apiVersion >= VK_API_VERSION_1_2 &&
+                features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore;
+
+        if (requiredExtensions.empty() && supportsTimelineSemaphores) {
+            suitablePhysicalDevices.push_back(d);
         }
     }
 
-    throw std::runtime_error("No GPU supporting all required features found!");
+    return suitablePhysicalDevices;
+}
+
+std::vector<const char*> Vulkan::getRequiredDeviceExtensions() const {
+    std::vector<const char*> extensions = requiredDeviceExtensions;
+
+    if (!settings.headless) {
+        extensions.insert(extensions.end(), requiredWindowDeviceExtensions.begin(),
+                          requiredWindowDeviceExtensions.end());
+    }
+
+    return extensions;
 }
 
 void Vulkan::findQueueFamilies() {
     std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
 
     bool computeFamilyFound = false;
-    bool presentFamilyFound = false;
+    bool presentFamilyFound = settings.headless;
 
     for (uint32_t i = 0; i < queueFamilies.size(); i++) {
         bool supportsGraphics = (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)
                                 == vk::QueueFlagBits::eGraphics;
         bool supportsCompute = (queueFamilies[i].queueFlags & vk::QueueFlagBits::eCompute)
                                == vk::QueueFlagBits::eCompute;
-        bool supportsPresenting = physicalDevice.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface);
+        bool supportsPresenting = !settings.headless &&
+                                  physicalDevice.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface);
 
         if (supportsCompute && !supportsGraphics && !computeFamilyFound) {
             computeQueueFamily = i;
@@ -217,26 +681,64 @@ void Vulkan::findQueueFamilies() {
         if (computeFamilyFound && presentFamilyFound)
             break;
     }
+
+    // software implementations (e.g. lavapipe) only expose a combined graphics + compute family
+    if (!computeFamilyFound) {
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eCompute) {
+                computeQueueFamily = i;
+                computeFamilyFound = true;
+                break;
+            }
+        }
+    }
+
+    if (!computeFamilyFound) {
+        throw VulkanUnavailableError("No queue family with compute support found!");
+    }
+
+    if (settings.headless) {
+        presentQueueFamily = computeQueueFamily;
+    }
+
+    // a transfer-only family usually is a DMA engine, which copies screenshots without taking compute time away
+    transferQueueFamily = computeQueueFamily;
+
+    for (uint32_t i = 0; i < queueFamilies.size() && settings.useTransferQueue; i++) {
+        if ((queueFamilies[i].queueFlags & vk::QueueFlagBits::eTransfer) &&
+            !(queueFamilies[i].queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            transferQueueFamily = i;
+            break;
+        }
+    }
 }
 
 void Vulkan::createLogicalDevice() {
     float queuePriority = 1.0f;
-    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos = {
-            {
-                    .queueFamilyIndex = computeQueueFamily,
-                    .queueCount = 1,
-                    .pQueuePriorities = &queuePriority
-            },
-            {
-                    .queueFamilyIndex = presentQueueFamily,
-                    .queueCount = 1,
-                    .pQueuePriorities = &queuePriority
-            }
-    };
+    std::set<uint32_t> queueFamilies = {computeQueueFamily, presentQueueFamily, transferQueueFamily};
+
+    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+    for (uint32_t queueFamily: queueFamilies) {
+        queueCreateInfos.push_back(
+                {
+                        .queueFamilyIndex = queueFamily,
+                        .queueCount = 1,
+                        .pQueuePriorities = &queuePriority
+                });
+    }
 
     vk::PhysicalDeviceFeatures deviceFeatures = {};
 
+    // both are required by Vulkan 1.2, the screenshot timestamps are reset on the host as transfer queues can't
+    vk::PhysicalDeviceVulkan12Features vulkan12Features = {
+            .hostQueryReset = true,
+            .timelineSemaphore = true
+    };
+
+    const std::vector<const char*> requiredDeviceExtensions = getRequiredDeviceExtensions();
+
     vk::DeviceCreateInfo deviceCreateInfo = {
+            .pNext = &vulkan12Features,
             .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
             .pQueueCreateInfos = queueCreateInfos.data(),
             .enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size()),
@@ -248,24 +750,42 @@ void Vulkan::createLogicalDevice() {
 
     computeQueue = device.getQueue(computeQueueFamily, 0);
     presentQueue = device.getQueue(presentQueueFamily, 0);
+    transferQueue = device.getQueue(transferQueueFamily, 0);
 }
 
 void Vulkan::createCommandPool() {
-    commandPool = device.createCommandPool({.queueFamilyIndex = computeQueueFamily});
+    commandPool = device.createCommandPool(
+            {
+                    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                    .queueFamilyIndex = computeQueueFamily
+            });
 }
 
 void Vulkan::createSwapChain() {
+    const vk::SurfaceCapabilitiesKHR surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
+
+    // enough images to not block on acquiring while other frames are still in flight
+    uint32_t imageCount = std::max(surfaceCapabilities.minImageCount, settings.framesInFlight);
+    if (surfaceCapabilities.maxImageCount > 0) {
+        imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+    }
+
+    // the images are written on the compute queue and presented on the present queue
+    const bool concurrent = presentQueueFamily != computeQueueFamily;
+    const std::vector<uint32_t> queueFamilies = {computeQueueFamily, presentQueueFamily};
+
     vk::SwapchainCreateInfoKHR swapChainCreateInfo = {
             .surface = surface,
-            .minImageCount = 1,
+            .minImageCount = imageCount,
             .imageFormat = swapChainImageFormat,
             .imageColorSpace = colorSpace,
             .imageExtent = {.width = settings.windowWidth, .height = settings.windowHeight},
             .imageArrayLayers = 1,
-            .imageUsage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eStorage |
-                          vk::ImageUsageFlagBits::eTransferSrc,
-            .imageSharingMode = vk::SharingMode::eExclusive,
-            .preTransform = physicalDevice.getSurfaceCapabilitiesKHR(surface).currentTransform,
+            .imageUsage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst,
+            .imageSharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = concurrent ? 2u : 0u,
+            .pQueueFamilyIndices = queueFamilies.data(),
+            .preTransform = surfaceCapabilities.currentTransform,
             .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
             .presentMode = presentMode,
             .clipped = true,
@@ -274,24 +794,22 @@ void Vulkan::createSwapChain() {
 
     swapChain = device.createSwapchainKHR(swapChainCreateInfo);
 
-    // swap chain images
-    std::vector<vk::Image> swapChainImages = device.getSwapchainImagesKHR(swapChain);
-    swapChainImage = swapChainImages.front();
-    swapChainImageView = createImageView(swapChainImage, swapChainImageFormat);
+    swapChainImages = device.getSwapchainImagesKHR(swapChain);
 }
 
-vk::ImageView Vulkan::createImageView(const vk::Image &image, const vk::Format &format) const {
+vk::ImageView Vulkan::createImageView(const vk::Image &image, const vk::Format &format,
+                                      uint32_t arrayLayers) const {
     return device.createImageView(
             {
                     .image = image,
-                    .viewType = vk::ImageViewType::e2D,
+                    .viewType = arrayLayers > 0 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D,
                     .format = format,
                     .subresourceRange = {
                             .aspectMask = vk::ImageAspectFlagBits::eColor,
                             .baseMipLevel = 0,
                             .levelCount = 1,
                             .baseArrayLayer = 0,
-                            .layerCount = 1
+                            .layerCount = std::max(arrayLayers, 1u)
                     }
             });
 }
@@ -312,18 +830,70 @@ void Vulkan::createDescriptorSetLayout() {
             },
             {
                     .binding = 2,
-                    .descriptorType = vk::DescriptorType::eUniformBuffer,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
                     .descriptorCount = 1,
                     .stageFlags = vk::ShaderStageFlagBits::eCompute
             },
             {
                     .binding = 3,
-                    .descriptorType = vk::DescriptorType::eUniformBuffer,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+                    .binding = 4,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+                    .binding = 11,
+                    .descriptorType = vk::DescriptorType::eStorageImage,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+                    .binding = 12,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+                    .binding = 13,
+                    .descriptorType = vk::DescriptorType::eStorageImage,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+            {
+                    .binding = 14,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
                     .descriptorCount = 1,
                     .stageFlags = vk::ShaderStageFlagBits::eCompute
             }
     };
 
+    // every frame in flight counts into its own part of the path statistics buffer
+    bindings.push_back(
+            {
+                    .binding = 10,
+                    .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+                    .descriptorCount = 1,
+                    .stageFlags = vk::ShaderStageFlagBits::eCompute
+            });
+
+    // path, ray queue, material queue, queue state and radiance buffer of the wavefront kernels
+    if (settings.renderMode == RenderMode::WAVEFRONT) {
+        for (uint32_t binding = 5; binding <= 9; binding++) {
+            bindings.push_back(
+                    {
+                            .binding = binding,
+                            .descriptorType = vk::DescriptorType::eStorageBuffer,
+                            .descriptorCount = 1,
+                            .stageFlags = vk::ShaderStageFlagBits::eCompute
+                    });
+        }
+    }
+
     descriptorSetLayout = device.createDescriptorSetLayout(
             {
                     .bindingCount = static_cast<uint32_t>(bindings.size()),
@@ -335,11 +905,15 @@ void Vulkan::createDescriptorPool() {
     std::vector<vk::DescriptorPoolSize> poolSizes = {
             {
                     .type = vk::DescriptorType::eStorageImage,
-                    .descriptorCount = 2
+                    .descriptorCount = 4
+            },
+            {
+                    .type = vk::DescriptorType::eStorageBuffer,
+                    .descriptorCount = settings.renderMode == RenderMode::WAVEFRONT ? 10u : 5u
             },
             {
-                    .type = vk::DescriptorType::eUniformBuffer,
-                    .descriptorCount = 2
+                    .type = vk::DescriptorType::eStorageBufferDynamic,
+                    .descriptorCount = 1
             }
     };
 
@@ -361,7 +935,7 @@ void Vulkan::createDescriptorSet() {
 
 
     vk::DescriptorImageInfo renderTargetImageInfo = {
-            .imageView = swapChainImageView,
+            .imageView = renderTargetImage.imageView,
             .imageLayout = vk::ImageLayout::eGeneral
     };
 
@@ -370,16 +944,44 @@ void Vulkan::createDescriptorSet() {
             .imageLayout = vk::ImageLayout::eGeneral
     };
 
-    vk::DescriptorBufferInfo sceneBufferInfo = {
-            .buffer = sceneBuffer.buffer,
+    vk::DescriptorImageInfo varianceImageInfo = {
+            .imageView = varianceImage.imageView,
+            .imageLayout = vk::ImageLayout::eGeneral
+    };
+
+    vk::DescriptorImageInfo accumulationImageInfo = {
+            .imageView = accumulationImage.imageView,
+            .imageLayout = vk::ImageLayout::eGeneral
+    };
+
+    vk::DescriptorBufferInfo sphereBufferInfo = {
+            .buffer = sphereBuffer.buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+    };
+
+    vk::DescriptorBufferInfo materialBufferInfo = {
+            .buffer = materialBuffer.buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+    };
+
+    vk::DescriptorBufferInfo bvhBufferInfo = {
+            .buffer = bvhBuffer.buffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+    };
+
+    vk::DescriptorBufferInfo tileWorkListBufferInfo = {
+            .buffer = tileWorkListBuffer.buffer,
             .offset = 0,
-            .range = sizeof(Scene)
+            .range = VK_WHOLE_SIZE
     };
 
-    vk::DescriptorBufferInfo renderCallInfoBufferInfo = {
-            .buffer = renderCallInfoBuffer.buffer,
+    vk::DescriptorBufferInfo cameraBufferInfo = {
+            .buffer = cameraBuffer.buffer,
             .offset = 0,
-            .range = sizeof(RenderCallInfo)
+            .range = VK_WHOLE_SIZE
     };
 
     std::vector<vk::WriteDescriptorSet> descriptorWrites = {
@@ -404,57 +1006,437 @@ void Vulkan::createDescriptorSet() {
                     .dstBinding = 2,
                     .dstArrayElement = 0,
                     .descriptorCount = 1,
-                    .descriptorType = vk::DescriptorType::eUniformBuffer,
-                    .pBufferInfo = &sceneBufferInfo
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &sphereBufferInfo
             },
             {
                     .dstSet = descriptorSet,
                     .dstBinding = 3,
                     .dstArrayElement = 0,
                     .descriptorCount = 1,
-                    .descriptorType = vk::DescriptorType::eUniformBuffer,
-                    .pBufferInfo = &renderCallInfoBufferInfo
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &materialBufferInfo
+            },
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 4,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &bvhBufferInfo
+            },
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 11,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageImage,
+                    .pImageInfo = &varianceImageInfo
+            },
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 12,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &tileWorkListBufferInfo
+            },
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 13,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageImage,
+                    .pImageInfo = &accumulationImageInfo
+            },
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 14,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &cameraBufferInfo
             }
     };
 
+    vk::DescriptorBufferInfo pathStatisticsBufferInfo = {
+            .buffer = pathStatisticsBuffer.buffer,
+            .offset = 0,
+            .range = sizeof(PathStatistics)
+    };
+
+    descriptorWrites.push_back(
+            {
+                    .dstSet = descriptorSet,
+                    .dstBinding = 10,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBufferDynamic,
+                    .pBufferInfo = &pathStatisticsBufferInfo
+            });
+
+    std::vector<vk::DescriptorBufferInfo> wavefrontBufferInfos;
+
+    if (settings.renderMode == RenderMode::WAVEFRONT) {
+        for (const VulkanBuffer *buffer: {&pathBuffer, &rayQueueBuffer, &materialQueueBuffer, &queueStateBuffer,
+                                          &radianceBuffer}) {
+            wavefrontBufferInfos.push_back({.buffer = buffer->buffer, .offset = 0, .range = VK_WHOLE_SIZE});
+        }
+
+        for (uint32_t i = 0; i < wavefrontBufferInfos.size(); i++) {
+            descriptorWrites.push_back(
+                    {
+                            .dstSet = descriptorSet,
+                            .dstBinding = 5 + i,
+                            .dstArrayElement = 0,
+                            .descriptorCount = 1,
+                            .descriptorType = vk::DescriptorType::eStorageBuffer,
+                            .pBufferInfo = &wavefrontBufferInfos[i]
+                    });
+        }
+    }
+
     device.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(),
                                 0, nullptr);
 }
 
 void Vulkan::createPipelineLayout() {
+    // the render call info is recorded into each frame's command buffer, so frames in flight don't share any memory
+    vk::PushConstantRange pushConstantRange = {
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset = 0,
+            .size = sizeof(RenderCallInfo)
+    };
+
     pipelineLayout = device.createPipelineLayout(
             {
                     .setLayoutCount = 1,
                     .pSetLayouts = &descriptorSetLayout,
-                    .pushConstantRangeCount = 0,
-                    .pPushConstantRanges = nullptr
+                    .pushConstantRangeCount = 1,
+                    .pPushConstantRanges = &pushConstantRange
+            });
+}
+
+ShaderCode Vulkan::readShaderCode() const {
+    return {
+            .compute = readBinaryFile(settings.computeShaderFile),
+            .adaptiveSampling = settings.adaptiveSampling
+                                ? readBinaryFile(settings.adaptiveSamplingShaderFile) : std::vector<char>(),
+            .wavefront = settings.renderMode == RenderMode::WAVEFRONT
+                         ? readBinaryFile(settings.wavefrontShaderFile) : std::vector<char>()
+    };
+}
+
+std::string Vulkan::getPipelineCacheFilePath() const {
+    if (settings.pipelineCacheDirectory.empty())
+        return "";
+
+    const auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+            vk::PhysicalDeviceIDProperties>();
+    const vk::PhysicalDeviceIDProperties &idProperties = properties.get<vk::PhysicalDeviceIDProperties>();
+
+    return getPipelineCachePath(settings.pipelineCacheDirectory, idProperties.deviceUUID, idProperties.driverUUID);
+}
+
+void Vulkan::createPipelineCache(const std::vector<char> &data) {
+    const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+
+    // drivers should reject foreign data themselves, but not all of them do so gracefully
+    struct PipelineCacheHeader {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    } header = {};
+
+    if (data.size() >= sizeof(header)) {
+        memcpy(&header, data.data(), sizeof(header));
+    }
+
+    const bool isCompatible = data.size() >= sizeof(header) && header.headerSize >= sizeof(header) &&
+                              header.headerVersion == uint32_t(vk::PipelineCacheHeaderVersion::eOne) &&
+                              header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                              memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+
+    pipelineCache = device.createPipelineCache(
+            {
+                    .initialDataSize = isCompatible ? data.size() : 0,
+                    .pInitialData = isCompatible ? data.data() : nullptr
             });
+
+    loadedPipelineCacheSize = isCompatible ? data.size() : 0;
+    startupTimings.warmPipelineCache = isCompatible;
 }
 
-void Vulkan::createPipeline() {
-    std::vector<char> computeShaderCode = readBinaryFile(settings.computeShaderFile);
+void Vulkan::savePipelineCache() const {
+    if (pipelineCachePath.empty())
+        return;
+
+    const std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+
+    // the cache only grows, pipelines that were all loaded from it leave it as it was
+    if (data.size() == loadedPipelineCacheSize)
+        return;
+
+    try {
+        writePipelineCache(pipelineCachePath, std::vector<char>(data.begin(), data.end()));
+    } catch (const std::exception &exception) {
+        // the next run just compiles the pipelines again
+        std::cerr << exception.what() << std::endl;
+    }
+}
 
+void Vulkan::createComputeShaderModule(const std::vector<char> &computeShaderCode) {
     vk::ShaderModuleCreateInfo shaderModuleCreateInfo = {
             .codeSize = computeShaderCode.size(),
             .pCode = reinterpret_cast<const uint32_t*>(computeShaderCode.data())
     };
 
-    vk::ShaderModule computeShaderModule = device.createShaderModule(shaderModuleCreateInfo);
+    computeShaderModule = device.createShaderModule(shaderModuleCreateInfo);
+
+    if (settings.autotuneWorkgroupSize) {
+        autotuneWorkgroupSize(computeShaderCode);
+    }
+
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
+
+    if (!isSupportedWorkgroupSize(workgroupSize)) {
+        throw std::runtime_error("Work group size " + std::to_string(workgroupSize.x) + "x" +
+                                 std::to_string(workgroupSize.y) + " is not supported by the GPU!");
+    }
+}
+
+const vk::Pipeline &Vulkan::getPipeline(const RenderCallInfo &renderCallInfo) {
+    const uint32_t samplesPerPass = settings.specializeShader
+                                    ? renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls : 0;
+
+    auto variant = pipelines.find(samplesPerPass);
+
+    if (variant == pipelines.end()) {
+        const auto beginTime = std::chrono::steady_clock::now();
+        const vk::Pipeline pipeline = createComputePipeline(computeShaderModule, getWorkgroupSize(), samplesPerPass,
+                                                            WavefrontKernel::GENERATE, settings.adaptiveSampling);
+        variant = pipelines.emplace(samplesPerPass, pipeline).first;
+
+        // part of the startup, as the first render call has to wait for it
+        startupTimings.phases.push_back(
+                {
+                        .name = "pipeline variant " + std::to_string(samplesPerPass),
+                        .timeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - beginTime).count(),
+                        .concurrent = false
+                });
+    }
+
+    return variant->second;
+}
+
+SpecializationConstants Vulkan::getSpecializationConstants(const WorkgroupSize &workgroupSize, uint32_t samplesPerPass,
+                                                           WavefrontKernel wavefrontKernel,
+                                                           bool adaptiveSampling) const {
+    return {
+            .useBvh = settings.useBvh,
+            .groupSizeX = workgroupSize.x,
+            .groupSizeY = workgroupSize.y,
+            .maxDepth = settings.maxDepth,
+            .samplesPerPass = samplesPerPass,
+            .materialTypes = settings.specializeShader
+                             ? sceneMaterialTypes
+                             : (1u << MaterialType::DIFFUSE) | (1u << MaterialType::METAL) |
+                               (1u << MaterialType::REFRACTIVE),
+            .backgroundColor = {scene.backgroundColor.x, scene.backgroundColor.y, scene.backgroundColor.z},
+            .wavefrontKernel = wavefrontKernel,
+            .russianRoulette = settings.russianRoulette,
+            .russianRouletteMinDepth = settings.russianRouletteMinDepth,
+            .collectPathStatistics = settings.collectPathStatistics,
+            .adaptiveSampling = adaptiveSampling,
+            .adaptiveSamplingMinSamples = settings.adaptiveSamplingMinSamples,
+            .adaptiveSamplingThreshold = settings.adaptiveSamplingThreshold,
+            .progressive = settings.progressive
+    };
+}
+
+vk::Pipeline Vulkan::createComputePipeline(const vk::ShaderModule &shaderModule, const WorkgroupSize &workgroupSize,
+                                           uint32_t samplesPerPass, WavefrontKernel wavefrontKernel,
+                                           bool adaptiveSampling) const {
+    const SpecializationConstants specializationConstants =
+            getSpecializationConstants(workgroupSize, samplesPerPass, wavefrontKernel, adaptiveSampling);
+
+    // constant ids have to match the layout(constant_id = ...) declarations in the shader
+    static_assert(sizeof(SpecializationConstants) % sizeof(uint32_t) == 0);
+    std::vector<vk::SpecializationMapEntry> specializationMapEntries;
+
+    for (uint32_t constantId = 0; constantId < sizeof(SpecializationConstants) / sizeof(uint32_t); constantId++) {
+        specializationMapEntries.push_back(
+                {
+                        .constantID = constantId,
+                        .offset = constantId * static_cast<uint32_t>(sizeof(uint32_t)),
+                        .size = sizeof(uint32_t)
+                });
+    }
+
+    vk::SpecializationInfo specializationInfo = {
+            .mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size()),
+            .pMapEntries = specializationMapEntries.data(),
+            .dataSize = sizeof(SpecializationConstants),
+            .pData = &specializationConstants
+    };
 
     vk::PipelineShaderStageCreateInfo shaderStage = {
             .stage = vk::ShaderStageFlagBits::eCompute,
-            .module = computeShaderModule,
+            .module = shaderModule,
             .pName = "main",
+            .pSpecializationInfo = &specializationInfo
     };
 
+    // tiled rendering offsets the work group ids of the dispatches to the tiles
     vk::ComputePipelineCreateInfo pipelineCreateInfo = {
+            .flags = settings.tiledRendering ? vk::PipelineCreateFlagBits::eDispatchBase : vk::PipelineCreateFlags(),
             .stage = shaderStage,
             .layout = pipelineLayout
     };
 
-    pipeline = device.createComputePipeline(nullptr, pipelineCreateInfo).value;
+    return device.createComputePipeline(pipelineCache, pipelineCreateInfo).value;
+}
+
+bool Vulkan::isSupportedWorkgroupSize(const WorkgroupSize &workgroupSize) const {
+    const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
 
-    device.destroyShaderModule(computeShaderModule);
+    return workgroupSize.x > 0 && workgroupSize.y > 0 &&
+           workgroupSize.x <= limits.maxComputeWorkGroupSize[0] &&
+           workgroupSize.y <= limits.maxComputeWorkGroupSize[1] &&
+           workgroupSize.x * workgroupSize.y <= limits.maxComputeWorkGroupInvocations;
+}
+
+void Vulkan::autotuneWorkgroupSize(const std::vector<char> &shaderCode) {
+    const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+
+    // Every specialization constant except the work group size itself is part of the tuned shader variant, e.g. the
+    // material types and the background color of the scene. Adaptive sampling changes the rendering the result is
+    // used for, even though the tuning dispatches don't use it.
+    const SpecializationConstants specializationConstants =
+            getSpecializationConstants({0, 0}, settings.specializeShader ? 1 : 0, WavefrontKernel::GENERATE,
+                                       settings.adaptiveSampling);
+
+    std::stringstream cacheKey;
+    cacheKey << properties.vendorID << ":" << properties.deviceID << ":" << properties.driverVersion << ":" << std::hex
+             << hashFnv1a(shaderCode.data(), shaderCode.size()) << ":"
+             << hashFnv1a(&specializationConstants, sizeof(specializationConstants));
+
+    const std::optional<WorkgroupSize> cachedWorkgroupSize =
+            readCachedWorkgroupSize(settings.workgroupSizeCacheFile, cacheKey.str());
+
+    if (cachedWorkgroupSize && isSupportedWorkgroupSize(*cachedWorkgroupSize)) {
+        settings.computeShaderGroupSizeX = cachedWorkgroupSize->x;
+        settings.computeShaderGroupSizeY = cachedWorkgroupSize->y;
+        return;
+    }
+
+    const std::vector<WorkgroupSize> candidates = {
+            {8, 4}, {8, 8}, {16, 4}, {16, 8}, {8, 16}, {16, 16}, {32, 2}, {32, 4}, {32, 8}, {64, 1}, {64, 2},
+            {128, 1}, {256, 1}
+    };
+
+    WorkgroupSize fastestWorkgroupSize = {};
+    double fastestTimeMs = std::numeric_limits<double>::max();
+
+    for (const WorkgroupSize &candidate: candidates) {
+        if (!isSupportedWorkgroupSize(candidate))
+            continue;
+
+        // the tuning dispatches render a single sample per pixel, without the adaptive sampling work list
+        vk::Pipeline candidatePipeline = createComputePipeline(computeShaderModule, candidate,
+                                                               settings.specializeShader ? 1 : 0);
+        const double timeMs = measureWorkgroupSize(candidatePipeline, candidate);
+        device.destroyPipeline(candidatePipeline);
+
+        if (timeMs < fastestTimeMs) {
+            fastestTimeMs = timeMs;
+            fastestWorkgroupSize = candidate;
+        }
+    }
+
+    if (fastestWorkgroupSize.x == 0)
+        throw std::runtime_error("None of the work group size candidates is supported by the GPU!");
+
+    settings.computeShaderGroupSizeX = fastestWorkgroupSize.x;
+    settings.computeShaderGroupSizeY = fastestWorkgroupSize.y;
+    writeCachedWorkgroupSize(settings.workgroupSizeCacheFile, cacheKey.str(), fastestWorkgroupSize);
+
+    // the tuning dispatches accumulated samples that aren't part of the actual rendering
+    executeSingleTimeCommands([&](const vk::CommandBuffer &commandBuffer) {
+        clearSummedPixelColorImage(commandBuffer);
+    });
+}
+
+double Vulkan::measureWorkgroupSize(const vk::Pipeline &candidatePipeline, const WorkgroupSize &workgroupSize) {
+    const uint32_t measuredDispatches = 3;
+
+    // a single sample per pixel, the first dispatch is a warm-up and not measured
+    const RenderCallInfo renderCallInfo = {
+            .number = 1,
+            .totalRenderCalls = 1,
+            .totalSamples = 1
+    };
+
+    // no render call has been submitted yet, so the queries of the first frame are free
+    const uint32_t queryIndex = frames.front().queryIndex;
+    std::chrono::steady_clock::time_point beginTime;
+
+    executeSingleTimeCommands([&](const vk::CommandBuffer &commandBuffer) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, candidatePipeline);
+
+        std::vector<vk::DescriptorSet> descriptorSets = {descriptorSet};
+        const uint32_t pathStatisticsOffset = frames.front().pathStatisticsOffset;
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSets,
+                                         pathStatisticsOffset);
+
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RenderCallInfo),
+                                    &renderCallInfo);
+
+        if (timestampsSupported) {
+            commandBuffer.resetQueryPool(queryPool, queryIndex, 2);
+        }
+
+        for (uint32_t i = 0; i <= measuredDispatches; i++) {
+            vk::ImageMemoryBarrier imageBarriers[2] = {
+                    getImagePipelineBarrier(
+                            vk::AccessFlagBits::eShaderWrite,
+                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                            vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, summedPixelColorImage.image),
+                    getImagePipelineBarrier(
+                            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderWrite,
+                            vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, renderTargetImage.image)
+            };
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::DependencyFlagBits::eByRegion, 0, nullptr, 0, nullptr, 2, imageBarriers);
+
+            if (i == 1 && timestampsSupported) {
+                commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool, queryIndex);
+            }
+
+            commandBuffer.dispatch(
+                    static_cast<uint32_t>(std::ceil(float(settings.windowWidth) / float(workgroupSize.x))),
+                    static_cast<uint32_t>(std::ceil(float(settings.windowHeight) / float(workgroupSize.y))),
+                    1);
+        }
+
+        if (timestampsSupported) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool, queryIndex + 1);
+        }
+
+        beginTime = std::chrono::steady_clock::now();
+    });
+
+    if (timestampsSupported)
+        return readTimestampDurationMs(queryIndex) / measuredDispatches;
+
+    // without timestamps the host time of the whole submission (including the warm-up) has to do
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beginTime).count() /
+           (measuredDispatches + 1);
 }
 
 std::vector<char> Vulkan::readBinaryFile(const std::string &path) {
@@ -474,158 +1456,427 @@ std::vector<char> Vulkan::readBinaryFile(const std::string &path) {
     return buffer;
 }
 
-void Vulkan::createCommandBuffer() {
-    commandBuffer = device.allocateCommandBuffers(
+void Vulkan::createTileWorkListPipeline(const std::vector<char> &adaptiveSamplingShaderCode) {
+    vk::ShaderModule adaptiveSamplingShaderModule = device.createShaderModule(
             {
-                    .commandPool = commandPool,
-                    .level = vk::CommandBufferLevel::ePrimary,
-                    .commandBufferCount = 1
-            }).front();
+                    .codeSize = adaptiveSamplingShaderCode.size(),
+                    .pCode = reinterpret_cast<const uint32_t*>(adaptiveSamplingShaderCode.data())
+            });
 
-    vk::CommandBufferBeginInfo beginInfo = {};
-    commandBuffer.begin(&beginInfo);
+    // the tiles are the work groups of the megakernel, so both use the same work group size
+    tileWorkListPipeline = createComputePipeline(adaptiveSamplingShaderModule, getWorkgroupSize(), 0);
 
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    device.destroyShaderModule(adaptiveSamplingShaderModule);
+}
 
-    std::vector<vk::DescriptorSet> descriptorSets = {descriptorSet};
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSets, nullptr);
+void Vulkan::recordTileWorkList(const vk::CommandBuffer &commandBuffer) const {
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
 
+    // the previous render call may still be reading the list
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect,
+                                  vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 0, nullptr);
 
-    vk::ImageMemoryBarrier imageBarriersToGeneral[2] = {
-            getImagePipelineBarrier(
-                    vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eShaderWrite,
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, swapChainImage),
-            getImagePipelineBarrier(
-                    vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eShaderWrite,
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, summedPixelColorImage.image)
+    const TileWorkListHeader emptyWorkList = {.dispatch = {.x = 0, .y = 1, .z = 1}, .padding = 0};
+    commandBuffer.updateBuffer(tileWorkListBuffer.buffer, 0, sizeof(TileWorkListHeader), &emptyWorkList);
+
+    const vk::MemoryBarrier resetBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
     };
 
-    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
-                                  vk::DependencyFlagBits::eByRegion, 0, nullptr,
-                                  0, nullptr, 2, imageBarriersToGeneral);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, 1, &resetBarrier, 0, nullptr, 0, nullptr);
 
+    // one work group per tile
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, tileWorkListPipeline);
     commandBuffer.dispatch(
-            static_cast<uint32_t>(std::ceil(float(settings.windowWidth) / float(settings.computeShaderGroupSizeX))),
-            static_cast<uint32_t>(std::ceil(float(settings.windowHeight) / float(settings.computeShaderGroupSizeY))),
+            static_cast<uint32_t>(std::ceil(float(settings.windowWidth) / float(workgroupSize.x))),
+            static_cast<uint32_t>(std::ceil(float(settings.windowHeight) / float(workgroupSize.y))),
             1);
 
-    vk::ImageMemoryBarrier imageBarrierToPresent = getImagePipelineBarrier(
-            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eMemoryRead,
-            vk::ImageLayout::eGeneral, vk::ImageLayout::ePresentSrcKHR, swapChainImage);
-    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
-                                  vk::DependencyFlagBits::eByRegion, 0, nullptr,
-                                  0, nullptr, 1, &imageBarrierToPresent);
+    const vk::MemoryBarrier workListBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eIndirectCommandRead
+    };
 
-    commandBuffer.end();
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect,
+                                  {}, 1, &workListBarrier, 0, nullptr, 0, nullptr);
 }
 
-void Vulkan::createFence() {
-    fence = device.createFence({});
+uint32_t Vulkan::getTileCount() const {
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
+    return ((settings.windowWidth + workgroupSize.x - 1) / workgroupSize.x) *
+           ((settings.windowHeight + workgroupSize.y - 1) / workgroupSize.y);
 }
 
-void Vulkan::createSemaphore() {
-    semaphore = device.createSemaphore({});
+void Vulkan::createTileScheduler() {
+    // the dispatches of the tiles start at whole work groups
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
+    const uint32_t tileSize = std::max(settings.tileSize, 1u);
+    const uint32_t tileWidth = (tileSize + workgroupSize.x - 1) / workgroupSize.x * workgroupSize.x;
+    const uint32_t tileHeight = (tileSize + workgroupSize.y - 1) / workgroupSize.y * workgroupSize.y;
+
+    // Without timestamps the tile times are never reported, so every render call stays a single submission of all
+    // tiles. Otherwise the first batches hold a single tile each, until their times are known.
+    tileScheduler.emplace(settings.windowWidth, settings.windowHeight, tileWidth, tileHeight, settings.tileOrder,
+                          settings.tileTimeBudgetMs, timestampsSupported ? 1 : std::numeric_limits<uint32_t>::max());
 }
 
-uint32_t Vulkan::findMemoryTypeIndex(const uint32_t &memoryTypeBits, const vk::MemoryPropertyFlags &properties) {
-    vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+void Vulkan::recordTiles(const vk::CommandBuffer &commandBuffer, const Frame &frame,
+                         const RenderCallInfo &renderCallInfo) {
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
 
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        if ((memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+    // the tiles cover distinct pixels, so the dispatches don't need barriers between them and may overlap
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipeline(renderCallInfo));
+
+    for (uint32_t i = 0; i < frame.tiles.size(); i++) {
+        const Tile &tile = tileScheduler->getTile(frame.tiles[i]);
+
+        commandBuffer.dispatchBase(tile.x / workgroupSize.x, tile.y / workgroupSize.y, 0,
+                                   (tile.width + workgroupSize.x - 1) / workgroupSize.x,
+                                   (tile.height + workgroupSize.y - 1) / workgroupSize.y, 1);
+
+        if (timestampsSupported) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool,
+                                         frame.queryIndex + 1 + i);
         }
     }
+}
 
-    throw std::runtime_error("Unable to find suitable memory type!");
+void Vulkan::createPathStatisticsBuffer() {
+    const vk::DeviceSize alignment = physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment;
+    pathStatisticsStride = (sizeof(PathStatistics) + alignment - 1) / alignment * alignment;
+
+    pathStatisticsBuffer = createBuffer(std::max(settings.framesInFlight, 1u) * pathStatisticsStride,
+                                        vk::BufferUsageFlagBits::eStorageBuffer,
+                                        vk::MemoryPropertyFlagBits::eHostVisible |
+                                        vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    pathStatisticsMemory = device.mapMemory(pathStatisticsBuffer.memory, 0, VK_WHOLE_SIZE);
+    std::memset(pathStatisticsMemory, 0, pathStatisticsBuffer.size);
 }
 
-void Vulkan::saveScreenshot(const std::string &name) {
-    vk::Buffer screenshotBuffer = device.createBuffer(
+PathStatistics &Vulkan::getPathStatistics(const Frame &frame) const {
+    return *reinterpret_cast<PathStatistics*>(static_cast<char*>(pathStatisticsMemory) + frame.pathStatisticsOffset);
+}
+
+void Vulkan::createTimelineSemaphore() {
+    vk::SemaphoreTypeCreateInfo semaphoreTypeInfo = {
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0
+    };
+
+    timelineSemaphore = device.createSemaphore({.pNext = &semaphoreTypeInfo});
+}
+
+void Vulkan::createFrames() {
+    std::vector<vk::CommandBuffer> commandBuffers = device.allocateCommandBuffers(
             {
-                    .size = settings.windowWidth * settings.windowHeight * 4,
-                    .usage = vk::BufferUsageFlagBits::eTransferDst,
-                    .sharingMode = vk::SharingMode::eExclusive
+                    .commandPool = commandPool,
+                    .level = vk::CommandBufferLevel::ePrimary,
+                    .commandBufferCount = std::max(settings.framesInFlight, 1u)
             });
 
-    vk::MemoryRequirements memoryRequirements = device.getBufferMemoryRequirements(screenshotBuffer);
+    for (const vk::CommandBuffer &commandBuffer: commandBuffers) {
+        frames.push_back(
+                {
+                        .commandBuffer = commandBuffer,
+                        .timelineValue = 0,
+                        .imageAvailableSemaphore = settings.headless ? vk::Semaphore() : device.createSemaphore({}),
+                        .renderFinishedSemaphore = settings.headless ? vk::Semaphore() : device.createSemaphore({}),
+                        .queryIndex = 0,
+                        .pathStatisticsOffset = static_cast<uint32_t>(frames.size() * pathStatisticsStride),
+                        .tiles = {},
+                        .hasPendingTiming = false,
+                        .pendingTiming = {},
+                        .uploadBuffer = {},
+                        .uploadMemory = nullptr,
+                        .uploadSize = 0,
+                        .sceneUploads = {}
+                });
+    }
+}
+
+void Vulkan::createQueryPool() {
+    const uint32_t timestampValidBits = physicalDevice.getQueueFamilyProperties()[computeQueueFamily].timestampValidBits;
+    const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+
+    timestampsSupported = timestampValidBits > 0 && limits.timestampPeriod > 0.0f;
+    timestampPeriod = limits.timestampPeriod;
+    timestampMask = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+
+    // the copies are timed with the same mask, which only fits if the transfer queue has as many valid bits
+    readbackTimestampsSupported = timestampsSupported &&
+                                  physicalDevice.getQueueFamilyProperties()[transferQueueFamily].timestampValidBits ==
+                                  timestampValidBits;
+
+    // two timestamps (begin, end) per frame in flight, followed by two per screenshot staging buffer; with tiled
+    // rendering the begin timestamp is followed by one after each tile, the tiles are at most tileSize pixels large
+    if (settings.tiledRendering) {
+        const uint32_t tileSize = std::max(settings.tileSize, 1u);
+        queriesPerFrame = 1 + ((settings.windowWidth + tileSize - 1) / tileSize) *
+                              ((settings.windowHeight + tileSize - 1) / tileSize);
+    }
+
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        frames[i].queryIndex = queriesPerFrame * i;
+    }
+
+    screenshotQueryIndex = queriesPerFrame * static_cast<uint32_t>(frames.size());
 
-    vk::DeviceMemory screenshotBufferMemory = device.allocateMemory(
+    queryPool = device.createQueryPool(
             {
-                    .allocationSize = memoryRequirements.size,
-                    .memoryTypeIndex = findMemoryTypeIndex(memoryRequirements.memoryTypeBits,
-                                                           vk::MemoryPropertyFlagBits::eHostVisible |
-                                                           vk::MemoryPropertyFlagBits::eHostCoherent)
+                    .queryType = vk::QueryType::eTimestamp,
+                    .queryCount = screenshotQueryIndex + 2 * std::max(settings.screenshotSlots, 1u)
             });
+}
+
+void Vulkan::initializeImages() {
+    // all images stay in the general layout from now on
+    executeSingleTimeCommands([&](const vk::CommandBuffer &commandBuffer) {
+        vk::ImageMemoryBarrier imageBarriers[4] = {
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, summedPixelColorImage.image),
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eShaderWrite,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, renderTargetImage.image),
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, varianceImage.image),
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, accumulationImage.image)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                      vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, 0, nullptr, 0, nullptr, 4, imageBarriers);
+
+        clearSummedPixelColorImage(commandBuffer);
+    });
+}
+
+void Vulkan::clearSummedPixelColorImage(const vk::CommandBuffer &commandBuffer) const {
+    const vk::ClearColorValue clearColor = {}; // all zero
+    const vk::ImageSubresourceRange subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = VK_REMAINING_ARRAY_LAYERS
+    };
 
-    device.bindBufferMemory(screenshotBuffer, screenshotBufferMemory, 0);
+    // the sample counts of the variance image belong to the accumulated samples
+    commandBuffer.clearColorImage(summedPixelColorImage.image, vk::ImageLayout::eGeneral, clearColor, subresourceRange);
+    commandBuffer.clearColorImage(varianceImage.image, vk::ImageLayout::eGeneral, clearColor, subresourceRange);
+    commandBuffer.clearColorImage(accumulationImage.image, vk::ImageLayout::eGeneral, clearColor, subresourceRange);
 
-    vk::CommandBuffer screenshotCommandBuffer = device.allocateCommandBuffers(
+    vk::ImageMemoryBarrier imageBarriers[3] = {
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, summedPixelColorImage.image),
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, varianceImage.image),
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, accumulationImage.image)
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, 0, nullptr, 0, nullptr, 3, imageBarriers);
+}
+
+void Vulkan::executeSingleTimeCommands(const std::function<void(const vk::CommandBuffer &)> &recordCommands) {
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(
             {
                     .commandPool = commandPool,
                     .level = vk::CommandBufferLevel::ePrimary,
                     .commandBufferCount = 1
             }).front();
 
+    vk::CommandBufferBeginInfo beginInfo = {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+    commandBuffer.begin(&beginInfo);
+    recordCommands(commandBuffer);
+    commandBuffer.end();
+
+    vk::Fence fence = device.createFence({});
 
-    std::vector<vk::BufferImageCopy> screenshotImageCopy = {
-            {
-                    .bufferOffset = 0,
-                    .bufferRowLength = settings.windowWidth,
-                    .bufferImageHeight = settings.windowHeight,
-                    .imageSubresource = {
-                            .aspectMask = vk::ImageAspectFlagBits::eColor,
-                            .mipLevel = 0,
-                            .baseArrayLayer = 0,
-                            .layerCount = 1
-                    },
-                    .imageOffset = {.x = 0, .y = 0, .z = 0},
-                    .imageExtent = {
-                            .width = settings.windowWidth,
-                            .height = settings.windowHeight,
-                            .depth = 1
-                    },
-            }
+    vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer
     };
 
-    vk::ImageMemoryBarrier imageBarrierToTransferSrc = getImagePipelineBarrier(
-            vk::AccessFlagBits::eMemoryRead, vk::AccessFlagBits::eMemoryRead, vk::ImageLayout::ePresentSrcKHR,
-            vk::ImageLayout::eTransferSrcOptimal, swapChainImage);
+    computeQueue.submit(1, &submitInfo, fence);
+
+    device.waitForFences(1, &fence, true, UINT64_MAX);
+    device.destroyFence(fence);
+    device.freeCommandBuffers(commandPool, commandBuffer);
+}
+
+void Vulkan::recordCommandBuffer(const Frame &frame, const RenderCallInfo &renderCallInfo,
+                                 const vk::Image &presentImage) {
+    const vk::CommandBuffer &commandBuffer = frame.commandBuffer;
 
     vk::CommandBufferBeginInfo beginInfo = {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
-    screenshotCommandBuffer.begin(&beginInfo);
+    commandBuffer.begin(&beginInfo);
 
+    recordSceneUploads(frame);
 
-    screenshotCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
-                                            vk::DependencyFlagBits::eByRegion, 0, nullptr,
-                                            0, nullptr, 1, &imageBarrierToTransferSrc);
+    std::vector<vk::DescriptorSet> descriptorSets = {descriptorSet};
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSets,
+                                     frame.pathStatisticsOffset);
+
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(RenderCallInfo),
+                                &renderCallInfo);
+
+    // the previous render call (possibly still executing) may still accumulate into the images, and an HDR readback
+    // submitted to this queue in between (see submitHdrReadback) may still copy them, which only needs the transfer
+    // stage in the source scope
+    if (accumulationRestartPending) {
+        vk::ImageMemoryBarrier imageBarriersBeforeClear[3] = {
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, summedPixelColorImage.image),
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, varianceImage.image),
+                getImagePipelineBarrier(
+                        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, accumulationImage.image)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eTransfer,
+                                      {}, 0, nullptr, 0, nullptr, 3, imageBarriersBeforeClear);
+
+        clearSummedPixelColorImage(commandBuffer);
+        accumulationRestartPending = false;
+    }
 
-    screenshotCommandBuffer.copyImageToBuffer(swapChainImage, vk::ImageLayout::eTransferSrcOptimal, screenshotBuffer,
-                                              screenshotImageCopy);
+    // the previous render call (possibly still executing) accumulates into the same image and reads the render target
+    vk::ImageMemoryBarrier imageBarriersBeforeDispatch[4] = {
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, summedPixelColorImage.image),
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, renderTargetImage.image),
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, varianceImage.image),
+            getImagePipelineBarrier(
+                    vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, accumulationImage.image)
+    };
 
-    screenshotCommandBuffer.end();
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlagBits::eByRegion, 0, nullptr,
+                                  0, nullptr, 4, imageBarriersBeforeDispatch);
 
-    vk::Fence screenshotFence = device.createFence({});
+    // written after the barrier, so the begin timestamp doesn't include the previous render call
+    if (timestampsSupported) {
+        commandBuffer.resetQueryPool(queryPool, frame.queryIndex, queriesPerFrame);
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool, frame.queryIndex);
+    }
 
-    vk::SubmitInfo submitInfo = {
-            .commandBufferCount = 1,
-            .pCommandBuffers = &screenshotCommandBuffer
-    };
+    if (settings.renderMode == RenderMode::WAVEFRONT) {
+        recordWavefrontDispatches(commandBuffer, renderCallInfo);
+    } else if (!frame.tiles.empty()) {
+        recordTiles(commandBuffer, frame, renderCallInfo);
+    } else if (settings.adaptiveSampling) {
+        recordTileWorkList(commandBuffer);
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipeline(renderCallInfo));
+        commandBuffer.dispatchIndirect(tileWorkListBuffer.buffer, offsetof(TileWorkListHeader, dispatch));
+    } else {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipeline(renderCallInfo));
+        commandBuffer.dispatch(
+                static_cast<uint32_t>(std::ceil(float(settings.windowWidth) / float(settings.computeShaderGroupSizeX))),
+                static_cast<uint32_t>(std::ceil(float(settings.windowHeight) / float(settings.computeShaderGroupSizeY))),
+                settings.viewCount);
+    }
+
+    // the timestamp after the last tile ends a tiled frame
+    if (timestampsSupported && frame.tiles.empty()) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool, frame.queryIndex + 1);
+    }
+
+    // the host reads the counters once the frame has finished
+    if (settings.collectPathStatistics || settings.adaptiveSampling || settings.progressive) {
+        const vk::MemoryBarrier pathStatisticsBarrier = {
+                .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                .dstAccessMask = vk::AccessFlagBits::eHostRead
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost,
+                                      {}, 1, &pathStatisticsBarrier, 0, nullptr, 0, nullptr);
+    }
 
-    computeQueue.submit(1, &submitInfo, screenshotFence);
+    vk::ImageMemoryBarrier renderTargetBarrierToTransfer = getImagePipelineBarrier(
+            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+            vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, renderTargetImage.image);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlagBits::eByRegion, 0, nullptr,
+                                  0, nullptr, 1, &renderTargetBarrierToTransfer);
+
+    if (presentImage) {
+        vk::ImageMemoryBarrier presentImageBarrierToTransferDst = getImagePipelineBarrier(
+                vk::AccessFlagBits::eNoneKHR, vk::AccessFlagBits::eTransferWrite,
+                vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, presentImage);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                                      vk::DependencyFlagBits::eByRegion, 0, nullptr,
+                                      0, nullptr, 1, &presentImageBarrierToTransferDst);
+
+        vk::ImageCopy imageCopy = {
+                .srcSubresource = {
+                        .aspectMask = vk::ImageAspectFlagBits::eColor,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                },
+                .srcOffset = {.x = 0, .y = 0, .z = 0},
+                .dstSubresource = {
+                        .aspectMask = vk::ImageAspectFlagBits::eColor,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                },
+                .dstOffset = {.x = 0, .y = 0, .z = 0},
+                .extent = {.width = settings.windowWidth, .height = settings.windowHeight, .depth = 1}
+        };
+
+        commandBuffer.copyImage(renderTargetImage.image, vk::ImageLayout::eGeneral,
+                                presentImage, vk::ImageLayout::eTransferDstOptimal, 1, &imageCopy);
+
+        vk::ImageMemoryBarrier presentImageBarrierToPresent = getImagePipelineBarrier(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead,
+                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR, presentImage);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                      vk::DependencyFlagBits::eByRegion, 0, nullptr,
+                                      0, nullptr, 1, &presentImageBarrierToPresent);
+    }
 
-    device.waitForFences(1, &screenshotFence, true, UINT64_MAX);
-    device.destroy(screenshotFence);
+    commandBuffer.end();
+}
 
-    void* data = device.mapMemory(screenshotBufferMemory, 0, memoryRequirements.size);
-    stbi_write_png(name.c_str(), settings.windowWidth, settings.windowHeight, 4, data, settings.windowWidth * 4);
-    device.unmapMemory(screenshotBufferMemory);
+uint32_t Vulkan::findMemoryTypeIndex(const uint32_t &memoryTypeBits, const vk::MemoryPropertyFlags &properties) {
+    vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
 
-    device.destroyBuffer(screenshotBuffer);
-    device.freeMemory(screenshotBufferMemory);
+    throw std::runtime_error("Unable to find suitable memory type!");
 }
 
 vk::ImageMemoryBarrier Vulkan::getImagePipelineBarrier(
-        const vk::AccessFlagBits &srcAccessFlags, const vk::AccessFlagBits &dstAccessFlags,
+        const vk::AccessFlags &srcAccessFlags, const vk::AccessFlags &dstAccessFlags,
         const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout,
         const vk::Image &image) const {
 
@@ -634,58 +1885,90 @@ vk::ImageMemoryBarrier Vulkan::getImagePipelineBarrier(
             .dstAccessMask = dstAccessFlags,
             .oldLayout = oldLayout,
             .newLayout = newLayout,
-            .srcQueueFamilyIndex = computeQueueFamily,
-            .dstQueueFamilyIndex = computeQueueFamily,
+            // images used by several queue families are shared concurrently, so no ownership is transferred
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .image = image,
             .subresourceRange = {
                     .aspectMask = vk::ImageAspectFlagBits::eColor,
                     .baseMipLevel = 0,
                     .levelCount = 1,
                     .baseArrayLayer = 0,
-                    .layerCount = 1
+                    .layerCount = VK_REMAINING_ARRAY_LAYERS
             },
     };
 }
 
-void Vulkan::createSceneBuffer() {
-    sceneBuffer = createBuffer(sizeof(Scene),
-                               vk::BufferUsageFlagBits::eUniformBuffer,
-                               vk::MemoryPropertyFlagBits::eHostVisible |
-                               vk::MemoryPropertyFlagBits::eHostCoherent);
+void Vulkan::createSummedPixelColorImage() {
+    // replaced by the accumulation image in the progressive mode
+    const vk::Extent2D extent = settings.progressive
+                                ? vk::Extent2D{.width = 1, .height = 1}
+                                : vk::Extent2D{.width = settings.windowWidth, .height = settings.windowHeight};
+
+    summedPixelColorImage = createImage(summedPixelColorImageFormat,
+                                        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst |
+                                        vk::ImageUsageFlagBits::eTransferSrc, extent, false, settings.viewCount);
+}
 
-    void* data = device.mapMemory(sceneBuffer.memory, 0, sizeof(Scene));
-    memcpy(data, &scene, sizeof(Scene));
-    device.unmapMemory(sceneBuffer.memory);
+void Vulkan::createRenderTargetImage() {
+    renderTargetImage = createImage(renderTargetImageFormat,
+                                    vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc,
+                                    {.width = settings.windowWidth, .height = settings.windowHeight}, true,
+                                    settings.viewCount);
 }
 
-void Vulkan::createRenderCallInfoBuffer() {
-    renderCallInfoBuffer = createBuffer(sizeof(RenderCallInfo),
-                                        vk::BufferUsageFlagBits::eUniformBuffer,
-                                        vk::MemoryPropertyFlagBits::eHostVisible |
-                                        vk::MemoryPropertyFlagBits::eHostCoherent);
+void Vulkan::createVarianceImage() {
+    // without adaptive sampling or the progressive mode the shaders never access it, a single pixel keeps the
+    // descriptor valid
+    const vk::Extent2D extent = settings.adaptiveSampling || settings.progressive
+                                ? vk::Extent2D{.width = settings.windowWidth, .height = settings.windowHeight}
+                                : vk::Extent2D{.width = 1, .height = 1};
+
+    varianceImage = createImage(varianceImageFormat,
+                                vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst |
+                                vk::ImageUsageFlagBits::eTransferSrc, extent);
 }
 
-void Vulkan::updateRenderCallInfoBuffer(const RenderCallInfo &renderCallInfo) {
-    void* data = device.mapMemory(renderCallInfoBuffer.memory, 0, sizeof(RenderCallInfo));
-    memcpy(data, &renderCallInfo, sizeof(RenderCallInfo));
-    device.unmapMemory(renderCallInfoBuffer.memory);
+void Vulkan::createAccumulationImage() {
+    // 32-bit floats keep full precision at any sample count, unlike the normalized summed pixel color image
+    const vk::Extent2D extent = settings.progressive
+                                ? vk::Extent2D{.width = settings.windowWidth, .height = settings.windowHeight}
+                                : vk::Extent2D{.width = 1, .height = 1};
+
+    accumulationImage = createImage(accumulationImageFormat,
+                                    vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst |
+                                    vk::ImageUsageFlagBits::eTransferSrc, extent);
 }
 
-void Vulkan::createSummedPixelColorImage() {
-    summedPixelColorImage = createImage(summedPixelColorImageFormat, vk::ImageUsageFlagBits::eStorage);
+void Vulkan::createTileWorkListBuffer() {
+    // one entry per pixel, so the list is long enough for any work group size the autotuner may pick
+    const vk::DeviceSize maxTileCount = settings.adaptiveSampling
+                                        ? vk::DeviceSize(settings.windowWidth) * settings.windowHeight : 1;
+
+    tileWorkListBuffer = createBuffer(sizeof(TileWorkListHeader) + maxTileCount * sizeof(uint32_t),
+                                      vk::BufferUsageFlagBits::eStorageBuffer |
+                                      vk::BufferUsageFlagBits::eIndirectBuffer |
+                                      vk::BufferUsageFlagBits::eTransferDst,
+                                      vk::MemoryPropertyFlagBits::eDeviceLocal);
 }
 
-VulkanImage Vulkan::createImage(const vk::Format &format, const vk::Flags<vk::ImageUsageFlagBits> &usageFlagBits) {
+VulkanImage Vulkan::createImage(const vk::Format &format, const vk::Flags<vk::ImageUsageFlagBits> &usageFlagBits,
+                                const vk::Extent2D &extent, bool sharedWithTransferQueue, uint32_t arrayLayers) {
+    const bool concurrent = sharedWithTransferQueue && transferQueueFamily != computeQueueFamily;
+    const std::vector<uint32_t> queueFamilies = {computeQueueFamily, transferQueueFamily};
+
     vk::ImageCreateInfo imageCreateInfo = {
             .imageType = vk::ImageType::e2D,
             .format = format,
-            .extent = {.width = settings.windowWidth, .height = settings.windowHeight, .depth = 1},
+            .extent = {.width = extent.width, .height = extent.height, .depth = 1},
             .mipLevels = 1,
-            .arrayLayers = 1,
+            .arrayLayers = std::max(arrayLayers, 1u),
             .samples = vk::SampleCountFlagBits::e1,
             .tiling = vk::ImageTiling::eOptimal,
             .usage = usageFlagBits,
-            .sharingMode = vk::SharingMode::eExclusive,
+            .sharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = concurrent ? 2u : 0u,
+            .pQueueFamilyIndices = queueFamilies.data(),
             .initialLayout = vk::ImageLayout::eUndefined
     };
 
@@ -703,17 +1986,22 @@ VulkanImage Vulkan::createImage(const vk::Format &format, const vk::Flags<vk::Im
 
     device.bindImageMemory(image, memory, 0);
 
+    allocatedDeviceMemory += allocateInfo.allocationSize;
+
     return {
             .image = image,
             .memory = memory,
-            .imageView = createImageView(image, format)
+            .imageView = createImageView(image, format, arrayLayers),
+            .size = allocateInfo.allocationSize
     };
 }
 
-void Vulkan::destroyImage(const VulkanImage &image) const {
+void Vulkan::destroyImage(const VulkanImage &image) {
     device.destroyImageView(image.imageView);
     device.destroyImage(image.image);
     device.freeMemory(image.memory);
+
+    allocatedDeviceMemory -= image.size;
 }
 
 VulkanBuffer Vulkan::createBuffer(const vk::DeviceSize &size, const vk::Flags<vk::BufferUsageFlagBits> &usage,
@@ -737,13 +2025,18 @@ VulkanBuffer Vulkan::createBuffer(const vk::DeviceSize &size, const vk::Flags<vk
 
     device.bindBufferMemory(buffer, memory, 0);
 
+    allocatedDeviceMemory += allocateInfo.allocationSize;
+
     return {
             .buffer = buffer,
             .memory = memory,
+            .size = allocateInfo.allocationSize
     };
 }
 
-void Vulkan::destroyBuffer(const VulkanBuffer &buffer) const {
+void Vulkan::destroyBuffer(const VulkanBuffer &buffer) {
     device.destroyBuffer(buffer.buffer);
     device.freeMemory(buffer.memory);
+
+    allocatedDeviceMemory -= buffer.size;
 }
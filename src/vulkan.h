@@ -3,51 +3,271 @@
 #define VULKAN_HPP_NO_CONSTRUCTORS
 #define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
 
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 #include "vulkan_settings.h"
 #include "scene.h"
+#include "renderer.h"
 #include "render_call_info.h"
+#include "bvh.h"
+#include "render_timing.h"
+#include "workgroup_size_cache.h"
+#include "tile_scheduler.h"
+#include "image_encoder.h"
+#include "hdr_image.h"
+#include "scene_file.h"
+#include "staged_ranges.h"
 
 struct VulkanImage {
     vk::Image image;
     vk::DeviceMemory memory;
     vk::ImageView imageView;
+    vk::DeviceSize size;
 };
 
 struct VulkanBuffer {
     vk::Buffer buffer;
     vk::DeviceMemory memory;
+    vk::DeviceSize size;
 };
 
+// memory layout of the specialization constants of the compute shader,
+// every member is 4 bytes and the member index is its constant id
+struct SpecializationConstants {
+    VkBool32 useBvh;
+    uint32_t groupSizeX;
+    uint32_t groupSizeY;
+    uint32_t maxDepth;
+    uint32_t samplesPerPass; // 0 for the generic variant
+    uint32_t materialTypes; // bit mask of MaterialType
+    float backgroundColor[3];
+    uint32_t wavefrontKernel; // only used by the wavefront shader
+    VkBool32 russianRoulette;
+    uint32_t russianRouletteMinDepth;
+    VkBool32 collectPathStatistics;
+    VkBool32 adaptiveSampling;
+    uint32_t adaptiveSamplingMinSamples;
+    float adaptiveSamplingThreshold;
+    VkBool32 progressive;
+};
+
+// memory layout of the Camera struct in the camera buffer of the shaders, one per view
+struct ViewCamera {
+    alignas(4) float fov;
+    alignas(4) float aperture;
+    alignas(4) float focusDistance;
+    alignas(16) glm::vec3 lookFrom;
+    alignas(16) glm::vec3 lookAt;
+    alignas(16) glm::vec3 up;
+};
+
+// memory layout of the PathStatistics buffer in the shaders, every frame in flight has its own
+struct PathStatistics {
+    uint32_t pathCount[2]; // low and high 32 bits
+    uint32_t bounceCount[2];
+    uint32_t sampledTileCount; // written by the adaptive sampling work list kernel
+    uint32_t squaredErrorSum[2]; // progressive mode, with 16 fractional bits
+    uint32_t errorPixelCount;
+};
+
+// memory layout of the start of the TileWorkList buffer in the shaders, followed by the indices of the tiles
+struct TileWorkListHeader {
+    vk::DispatchIndirectCommand dispatch; // one work group per tile
+    uint32_t padding;
+};
+
+// values of the KERNEL specialization constant in wavefront.comp
+enum WavefrontKernel {
+    GENERATE = 0,
+    PREPARE_INTERSECT = 1,
+    INTERSECT = 2,
+    PREPARE_SHADE = 3,
+    SHADE_DIFFUSE = 4,
+    SHADE_METAL = 5,
+    SHADE_REFRACTIVE = 6,
+    RESOLVE = 7
+};
+
+// memory layout of the QueueState buffer in wavefront.comp
+struct WavefrontQueueState {
+    uint32_t rayCount;
+    uint32_t depth;
+    uint32_t intersectCount;
+    uint32_t materialCounts[3];
+    vk::DispatchIndirectCommand intersectDispatch;
+    vk::DispatchIndirectCommand shadeDispatches[3]; // indexed by MaterialType
+};
+
+// receives the RGBA8 pixels of a screenshot once per view, they are only valid during the call
+using ScreenshotCallback = std::function<void(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t view)>;
+
+// the image of a view in a screenshot of several views, e.g. render_view3.png for render.png
+std::string getViewScreenshotName(const std::string &name, uint32_t view);
+
+// a persistently mapped staging buffer of the screenshot ring, reused once the callback of its screenshot has returned
+struct ReadbackSlot {
+    VulkanBuffer buffer;
+    void* memory;
+    vk::CommandBuffer commandBuffer; // allocated from the transfer command pool
+    uint32_t queryIndex; // first of the two timestamp queries around the copy
+    std::shared_future<void> completion; // invalid until the slot has been used
+};
+
+// the staging buffer of HDR screenshots, created by the first one: the summed or accumulated color of every pixel,
+// followed by its variance estimate if the shader tracks one (which holds the sample count of the pixel)
+struct HdrReadback {
+    VulkanBuffer buffer = {};
+    void* memory = nullptr;
+    vk::DeviceSize colorSize = 0;
+    vk::CommandBuffer commandBuffer; // allocated from the compute command pool
+    vk::Fence fence;
+    std::shared_future<void> completion;
+};
+
+// SPIR-V of the shaders the settings need, the others are empty
+struct ShaderCode {
+    std::vector<char> compute;
+    std::vector<char> adaptiveSampling;
+    std::vector<char> wavefront;
+};
+
+struct Frame {
+    vk::CommandBuffer commandBuffer;
+    uint64_t timelineValue; // signaled once the command buffer has finished executing
+    vk::Semaphore imageAvailableSemaphore;
+    vk::Semaphore renderFinishedSemaphore;
+    uint32_t queryIndex; // first of the two timestamp queries around the dispatch
+    uint32_t pathStatisticsOffset; // dynamic offset into the path statistics buffer
+    std::vector<uint32_t> tiles; // tiled rendering: tiles of this submission, each one followed by a timestamp
+    bool hasPendingTiming;
+    RenderCallTiming pendingTiming;
+    VulkanBuffer uploadBuffer; // persistently mapped, created and grown by the first scene update that needs it
+    uint8_t* uploadMemory;
+    vk::DeviceSize uploadSize; // bytes staged for the next submission of this frame
+    // the ranges of the scene buffers, written from the upload buffer before the dispatch (see vulkan_scene.cpp)
+    std::map<VkBuffer, StagedRanges> sceneUploads;
+};
+
+// thrown by the constructor if there is no Vulkan instance or no suitable GPU, every other exception is a real error
+class VulkanUnavailableError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
 
-class Vulkan {
+class Vulkan : public Renderer {
 public:
     Vulkan(VulkanSettings settings, Scene scene);
 
-    ~Vulkan();
+    // uploads the arrays straight from the mapped file, which only has to stay open during the construction
+    Vulkan(VulkanSettings settings, const SceneFile &sceneFile);
 
-    void update();
+    ~Vulkan() override;
 
-    void render(const RenderCallInfo &renderCallInfo);
+    void update() override;
 
-    [[nodiscard]] bool shouldExit() const;
+    // only waits for the GPU if all frames are still in flight, tiled rendering submits a frame per batch of tiles
+    void render(const RenderCallInfo &renderCallInfo) override;
 
-    void saveScreenshot(const std::string &name);
+    // blocks until all submitted render calls have finished and collects their timings
+    void waitIdle() override;
+
+    // render calls are only included once they have finished executing (e.g. after waitIdle), with tiled rendering
+    // there is one entry per submission
+    [[nodiscard]] const std::vector<RenderCallTiming> &getRenderCallTimings() const override;
+
+    // screenshots are only included once they have been written (e.g. after waitForScreenshots)
+    [[nodiscard]] std::vector<ScreenshotTiming> getScreenshotTimings() const override;
+
+    [[nodiscard]] std::string getDeviceName() const override;
+
+    // devices that match VulkanSettings::physicalDeviceName and support all required features, including this one
+    [[nodiscard]] uint32_t getSuitablePhysicalDeviceCount() const;
+
+    // the configured one, or the fastest one found by the autotuner
+    [[nodiscard]] WorkgroupSize getWorkgroupSize() const;
+
+    // sum of all currently allocated buffers and images
+    [[nodiscard]] vk::DeviceSize getAllocatedDeviceMemory() const;
+
+    // how long the phases of the construction took, to compare cold and warm starts
+    [[nodiscard]] const StartupTimings &getStartupTimings() const;
+
+    // progressive mode: the estimated error of the latest finished render call is below the target, which lags behind
+    // the submitted render calls by up to VulkanSettings::framesInFlight
+    [[nodiscard]] bool hasConverged() const override;
+
+    // CSV, or JSON if the path ends with ".json"
+    void writeTimingTrace(const std::string &path) const override;
+
+    [[nodiscard]] bool shouldExit() const override;
+
+    // blocks until the PNG has been written
+    void saveScreenshot(const std::string &name) override;
+
+    // of the last submitted render call, only blocks while all staging buffers are in use (see vulkan_readback.cpp),
+    // with several views every one is written to its own image (see getViewScreenshotName)
+    std::shared_future<void> saveScreenshotAsync(const std::string &name) override;
+
+    // like saveScreenshotAsync, but hands the pixels to the callback, which runs on another thread
+    std::shared_future<void> readScreenshotAsync(ScreenshotCallback callback, const std::string &name = "screenshot");
+
+    // the mean linear color of every pixel before the gamma correction, as PFM or as OpenEXR if the path ends with
+    // ".exr", blocks until the file has been written; only supported with a single view
+    void saveHdrScreenshot(const std::string &name) override;
+
+    // of the last submitted render call, only blocks while the previous HDR screenshot is still being written
+    std::shared_future<void> saveHdrScreenshotAsync(const std::string &name);
+
+    void waitForScreenshots() override;
+
+    // not available in the progressive mode or with several views
+    [[nodiscard]] std::vector<float> readSummedPixelColors() override;
+
+    // Replaces spheres, indexed like the spheres of the scene (or scene file) the renderer was created with. Only the
+    // changed ranges are copied into the scene buffers, by the next frame before it traces (see vulkan_scene.cpp). The
+    // bounds of the BVH grow to enclose moved spheres, but never shrink.
+    void updateSpheres(uint32_t firstSphere, std::span<const Sphere> spheres);
+
+    // the material types can't change to ones the scene didn't have, as the pipelines are specialized on them
+    void updateMaterials(uint32_t firstMaterial, std::span<const Material> materials);
+
+    // the camera of every view, used from the next render call on. They are copied into the camera buffer like sphere
+    // updates, so changing them doesn't create new pipelines.
+    void setCameras(std::span<const Camera> cameras);
+
+    // the camera of the first view
+    void setCamera(const Camera &camera);
+
+    // The next render call starts a new image instead of accumulating into the current one (its number should be 1
+    // again). Screenshots that have already been requested aren't affected.
+    void restartAccumulation();
 
 
 private:
     VulkanSettings settings;
     Scene scene;
+    ImageEncoder imageEncoder;
 
     const vk::Format swapChainImageFormat = vk::Format::eR8G8B8A8Unorm;
+    const vk::Format renderTargetImageFormat = vk::Format::eR8G8B8A8Unorm;
     const vk::Format summedPixelColorImageFormat = vk::Format::eR16G16B16A16Unorm;
+    const vk::Format varianceImageFormat = vk::Format::eR32G32B32A32Sfloat;
+    const vk::Format accumulationImageFormat = vk::Format::eR32G32B32A32Sfloat;
     const vk::ColorSpaceKHR colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
     const vk::PresentModeKHR presentMode = vk::PresentModeKHR::eImmediate;
 
     const std::vector<const char*> requiredInstanceExtensions = {};
 
-    const std::vector<const char*> requiredDeviceExtensions = {
+    const std::vector<const char*> requiredDeviceExtensions = {};
+
+    const std::vector<const char*> requiredWindowDeviceExtensions = {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
@@ -58,30 +278,85 @@ private:
     vk::PhysicalDevice physicalDevice;
     vk::Device device;
 
-    uint32_t computeQueueFamily = 0, presentQueueFamily = 0;
-    vk::Queue computeQueue, presentQueue;
+    uint32_t computeQueueFamily = 0, presentQueueFamily = 0, transferQueueFamily = 0;
+    vk::Queue computeQueue, presentQueue, transferQueue;
 
     vk::CommandPool commandPool;
+    vk::CommandPool transferCommandPool; // the same as commandPool without a dedicated transfer queue
 
     vk::SwapchainKHR swapChain;
-    vk::Image swapChainImage;
-    vk::ImageView swapChainImageView;
+    std::vector<vk::Image> swapChainImages;
 
     vk::DescriptorSetLayout descriptorSetLayout;
     vk::DescriptorPool descriptorPool;
     vk::DescriptorSet descriptorSet;
 
     vk::PipelineLayout pipelineLayout;
-    vk::Pipeline pipeline;
-
-    vk::CommandBuffer commandBuffer;
-
-    vk::Fence fence;
-    vk::Semaphore semaphore;
-
-    VulkanBuffer sceneBuffer;
-    VulkanBuffer renderCallInfoBuffer;
+    vk::PipelineCache pipelineCache; // loaded from and saved to pipelineCachePath, if it isn't empty
+    std::string pipelineCachePath;
+    size_t loadedPipelineCacheSize = 0;
+    vk::ShaderModule computeShaderModule;
+    std::map<uint32_t, vk::Pipeline> pipelines; // variants specialized on the samples per pass, created on first use
+    uint32_t sceneMaterialTypes = 0;
+
+    vk::Pipeline tileWorkListPipeline; // adaptive sampling only
+    std::optional<TileScheduler> tileScheduler; // tiled rendering only
+
+    std::map<WavefrontKernel, vk::Pipeline> wavefrontPipelines;
+    VulkanBuffer pathBuffer;
+    VulkanBuffer rayQueueBuffer;
+    VulkanBuffer materialQueueBuffer;
+    VulkanBuffer queueStateBuffer;
+    VulkanBuffer radianceBuffer;
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+
+    vk::Semaphore timelineSemaphore;
+    uint64_t submittedTimelineValue = 0;
+
+    vk::QueryPool queryPool;
+    bool timestampsSupported = false;
+    double timestampPeriod = 0.0; // nanoseconds per tick
+    uint64_t timestampMask = 0;
+    uint32_t screenshotQueryIndex = 0;
+    uint32_t queriesPerFrame = 2;
+    bool readbackTimestampsSupported = false; // the transfer queue may not support timestamps with the same bits
+
+    std::vector<ReadbackSlot> readbackSlots;
+    uint32_t nextReadbackSlot = 0;
+    vk::Semaphore readbackTimelineSemaphore; // signaled once a screenshot has been copied to its staging buffer
+    uint64_t submittedReadbackValue = 0; // render calls wait for it before they overwrite the render target
+    HdrReadback hdrReadback;
+    RenderCallInfo submittedRenderCallInfo = {}; // turns the summed colors of HDR screenshots into means
+    bool accumulationRestartPending = false; // cleared by the first frame of the next render call
+
+    vk::DeviceSize allocatedDeviceMemory = 0;
+    StartupTimings startupTimings = {};
+
+    std::vector<RenderCallTiming> renderCallTimings;
+    std::vector<ScreenshotTiming> screenshotTimings;
+    mutable std::mutex screenshotTimingsMutex; // appended to by the threads that write the screenshots
+
+    std::vector<BVHNode> bvhNodes;
+    std::vector<uint32_t> spherePositions; // in the sphere buffer, by index in the scene, empty if they are the same
+    std::vector<uint32_t> bvhParents; // of every node, built by the first sphere update
+    std::vector<uint32_t> sphereLeaves; // of every sphere in the sphere buffer, built by the first sphere update
+    uint32_t sceneSphereCount = 0;
+    uint32_t sceneMaterialCount = 0;
+
+    VulkanBuffer sphereBuffer;
+    VulkanBuffer materialBuffer;
+    VulkanBuffer bvhBuffer;
+    VulkanBuffer cameraBuffer; // one ViewCamera per view
+    VulkanBuffer pathStatisticsBuffer;
+    void* pathStatisticsMemory = nullptr; // persistently mapped
+    vk::DeviceSize pathStatisticsStride = 0;
+    VulkanBuffer tileWorkListBuffer;
     VulkanImage summedPixelColorImage;
+    VulkanImage renderTargetImage;
+    VulkanImage varianceImage;
+    VulkanImage accumulationImage;
 
     void createWindow();
 
@@ -91,6 +366,10 @@ private:
 
     void pickPhysicalDevice();
 
+    [[nodiscard]] std::vector<vk::PhysicalDevice> getSuitablePhysicalDevices() const;
+
+    [[nodiscard]] std::vector<const char*> getRequiredDeviceExtensions() const;
+
     void findQueueFamilies();
 
     void createLogicalDevice();
@@ -99,7 +378,8 @@ private:
 
     void createSwapChain();
 
-    [[nodiscard]] vk::ImageView createImageView(const vk::Image &image, const vk::Format &format) const;
+    [[nodiscard]] vk::ImageView createImageView(const vk::Image &image, const vk::Format &format,
+                                                uint32_t arrayLayers) const;
 
     void createDescriptorSetLayout();
 
@@ -109,39 +389,153 @@ private:
 
     void createPipelineLayout();
 
-    void createPipeline();
+    [[nodiscard]] ShaderCode readShaderCode() const;
+
+    // keyed by the UUIDs of the device and the driver, empty without VulkanSettings::pipelineCacheDirectory
+    [[nodiscard]] std::string getPipelineCacheFilePath() const;
+
+    // data written by another device or driver is dropped, the cache starts empty then
+    void createPipelineCache(const std::vector<char> &data);
+
+    // only if pipelines have been added to the cache
+    void savePipelineCache() const;
+
+    void createComputeShaderModule(const std::vector<char> &computeShaderCode);
+
+    [[nodiscard]] const vk::Pipeline &getPipeline(const RenderCallInfo &renderCallInfo);
+
+    [[nodiscard]] SpecializationConstants getSpecializationConstants(const WorkgroupSize &workgroupSize,
+                                                                     uint32_t samplesPerPass,
+                                                                     WavefrontKernel wavefrontKernel,
+                                                                     bool adaptiveSampling) const;
+
+    [[nodiscard]] vk::Pipeline createComputePipeline(const vk::ShaderModule &shaderModule,
+                                                     const WorkgroupSize &workgroupSize, uint32_t samplesPerPass,
+                                                     WavefrontKernel wavefrontKernel = WavefrontKernel::GENERATE,
+                                                     bool adaptiveSampling = false) const;
+
+    [[nodiscard]] bool isSupportedWorkgroupSize(const WorkgroupSize &workgroupSize) const;
+
+    void autotuneWorkgroupSize(const std::vector<char> &shaderCode);
+
+    [[nodiscard]] double measureWorkgroupSize(const vk::Pipeline &candidatePipeline,
+                                              const WorkgroupSize &workgroupSize);
 
     [[nodiscard]] static std::vector<char> readBinaryFile(const std::string &path);
 
-    void createCommandBuffer();
+    // see vulkan_wavefront.cpp
+    void createWavefrontBuffers();
+
+    void createWavefrontPipelines(const std::vector<char> &wavefrontShaderCode);
+
+    void initializeWavefrontBuffers();
+
+    void recordWavefrontDispatches(const vk::CommandBuffer &commandBuffer, const RenderCallInfo &renderCallInfo) const;
+
+    void destroyWavefrontResources();
+
+    // see vulkan_readback.cpp
+    void createReadbackSlots();
+
+    void destroyReadbackSlots();
+
+    void waitForReadbackValue(uint64_t value) const;
+
+    void createHdrReadback();
+
+    // copies the summed (or accumulated) colors and the variances into the HDR readback buffer, signals its fence
+    void submitHdrReadback();
+
+    // mean linear RGB colors of a row of pixels, from the contents of the HDR staging buffer
+    void resolveHdrRow(const RenderCallInfo &renderCallInfo, uint32_t y, float* rgb) const;
 
-    void createFence();
+    void createTileWorkListPipeline(const std::vector<char> &adaptiveSamplingShaderCode);
 
-    void createSemaphore();
+    void createTileScheduler();
+
+    void recordTiles(const vk::CommandBuffer &commandBuffer, const Frame &frame, const RenderCallInfo &renderCallInfo);
+
+    void recordTileWorkList(const vk::CommandBuffer &commandBuffer) const;
+
+    [[nodiscard]] uint32_t getTileCount() const;
+
+    void createPathStatisticsBuffer();
+
+    [[nodiscard]] PathStatistics &getPathStatistics(const Frame &frame) const;
+
+    void createTimelineSemaphore();
+
+    void createFrames();
+
+    void createQueryPool();
+
+    void initializeImages();
+
+    void clearSummedPixelColorImage(const vk::CommandBuffer &commandBuffer) const;
+
+    void executeSingleTimeCommands(const std::function<void(const vk::CommandBuffer &)> &recordCommands);
+
+    // also clears the accumulated images first if a restart is pending
+    void recordCommandBuffer(const Frame &frame, const RenderCallInfo &renderCallInfo, const vk::Image &presentImage);
+
+    // records and submits one frame, which renders a batch of tiles with tiled rendering and the whole image otherwise
+    void submitFrame(const RenderCallInfo &renderCallInfo);
+
+    void waitForTimelineValue(uint64_t value) const;
+
+    void collectRenderCallTiming(Frame &frame);
+
+    [[nodiscard]] double readTimestampDurationMs(uint32_t firstQuery) const;
+
+    // the durations between consecutive timestamps
+    [[nodiscard]] std::vector<double> readTimestampDurationsMs(uint32_t firstQuery, uint32_t durationCount) const;
 
     [[nodiscard]] uint32_t findMemoryTypeIndex(const uint32_t &memoryTypeBits,
                                                const vk::MemoryPropertyFlags &properties);
 
     [[nodiscard]] vk::ImageMemoryBarrier getImagePipelineBarrier(
-            const vk::AccessFlagBits &srcAccessFlags, const vk::AccessFlagBits &dstAccessFlags,
+            const vk::AccessFlags &srcAccessFlags, const vk::AccessFlags &dstAccessFlags,
             const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout, const vk::Image &image) const;
 
-    void createSceneBuffer();
+    Vulkan(VulkanSettings settings, Scene scene, const SceneFile* sceneFile);
+
+    // see vulkan_scene.cpp
+    void createBVH(const SceneFile* sceneFile);
+
+    void createSceneBuffer(const SceneFile* sceneFile);
 
-    void createRenderCallInfoBuffer();
+    [[nodiscard]] VulkanBuffer createStorageBuffer(const vk::DeviceSize &size);
 
-    void updateRenderCallInfoBuffer(const RenderCallInfo &renderCallInfo);
+    // copies the data into the upload buffer of the next frame
+    void stageSceneUpload(const VulkanBuffer &buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+
+    void recordSceneUploads(const Frame &frame) const;
+
+    // grows the leaves of the spheres at the positions and their ancestors until they enclose the spheres, stages the
+    // changed nodes
+    void growBvhNodes(std::span<const uint32_t> positions, std::span<const Sphere> spheres);
 
     void createSummedPixelColorImage();
 
+    void createRenderTargetImage();
+
+    void createVarianceImage();
+
+    void createAccumulationImage();
+
+    void createTileWorkListBuffer();
+
+    // shared images can be read by the transfer queue without a queue family ownership transfer
     [[nodiscard]] VulkanImage createImage(const vk::Format &format,
-                                          const vk::Flags<vk::ImageUsageFlagBits> &usageFlagBits);
+                                          const vk::Flags<vk::ImageUsageFlagBits> &usageFlagBits,
+                                          const vk::Extent2D &extent, bool sharedWithTransferQueue = false,
+                                          uint32_t arrayLayers = 0); // 0: a 2D image, an array image otherwise
 
-    void destroyImage(const VulkanImage &image) const;
+    void destroyImage(const VulkanImage &image);
 
     [[nodiscard]] VulkanBuffer createBuffer(const vk::DeviceSize &size, const vk::Flags<vk::BufferUsageFlagBits> &usage,
                                             const vk::Flags<vk::MemoryPropertyFlagBits> &memoryProperty);
 
-    void destroyBuffer(const VulkanBuffer &buffer) const;
+    void destroyBuffer(const VulkanBuffer &buffer);
 
 };
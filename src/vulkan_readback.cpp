@@ -0,0 +1,437 @@
+#include "vulkan.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+// Screenshot readback: the render target is copied into a ring of persistently mapped staging buffers, on a dedicated
+// transfer queue if the device has one. The copy waits for the last submitted render call on the GPU and the next
+// render call waits for the copy, so the requesting thread only records and submits it. Waiting for the copy and
+// encoding the image happen on a separate thread, which lets render calls continue while screenshots are written.
+//
+// With several views, all layers of the render target are copied into the staging buffer one after the other and the
+// callback is called once per layer.
+//
+// HDR screenshots copy the summed (or accumulated) colors and the variance estimates on the compute queue instead, as
+// these images are only ever used by it. The next render call is ordered after the copy by its barrier. The colors are
+// turned into means row by row and written straight into a memory-mapped file (see hdr_image.cpp).
+
+void Vulkan::createReadbackSlots() {
+    transferCommandPool = transferQueueFamily == computeQueueFamily
+                          ? commandPool
+                          : device.createCommandPool(
+                    {
+                            .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                            .queueFamilyIndex = transferQueueFamily
+                    });
+
+    vk::SemaphoreTypeCreateInfo semaphoreTypeInfo = {
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0
+    };
+
+    readbackTimelineSemaphore = device.createSemaphore({.pNext = &semaphoreTypeInfo});
+
+    const uint32_t slotCount = std::max(settings.screenshotSlots, 1u);
+
+    std::vector<vk::CommandBuffer> commandBuffers = device.allocateCommandBuffers(
+            {
+                    .commandPool = transferCommandPool,
+                    .level = vk::CommandBufferLevel::ePrimary,
+                    .commandBufferCount = slotCount
+            });
+
+    for (uint32_t i = 0; i < slotCount; i++) {
+        // cached memory would be faster to read, but isn't available on every device
+        VulkanBuffer buffer = createBuffer(vk::DeviceSize(settings.windowWidth) * settings.windowHeight * 4 *
+                                           settings.viewCount,
+                                           vk::BufferUsageFlagBits::eTransferDst,
+                                           vk::MemoryPropertyFlagBits::eHostVisible |
+                                           vk::MemoryPropertyFlagBits::eHostCoherent);
+
+        readbackSlots.push_back(
+                {
+                        .buffer = buffer,
+                        .memory = device.mapMemory(buffer.memory, 0, VK_WHOLE_SIZE),
+                        .commandBuffer = commandBuffers[i],
+                        .queryIndex = screenshotQueryIndex + 2 * i,
+                        .completion = {}
+                });
+    }
+}
+
+void Vulkan::destroyReadbackSlots() {
+    for (const ReadbackSlot &slot: readbackSlots) {
+        device.unmapMemory(slot.buffer.memory);
+        destroyBuffer(slot.buffer);
+    }
+
+    if (transferCommandPool != commandPool) {
+        device.destroyCommandPool(transferCommandPool);
+    }
+
+    if (hdrReadback.buffer.buffer) {
+        device.unmapMemory(hdrReadback.buffer.memory);
+        destroyBuffer(hdrReadback.buffer);
+        device.destroyFence(hdrReadback.fence);
+    }
+
+    device.destroySemaphore(readbackTimelineSemaphore);
+}
+
+void Vulkan::waitForReadbackValue(uint64_t value) const {
+    vk::SemaphoreWaitInfo waitInfo = {
+            .semaphoreCount = 1,
+            .pSemaphores = &readbackTimelineSemaphore,
+            .pValues = &value
+    };
+
+    device.waitSemaphores(waitInfo, UINT64_MAX);
+}
+
+void Vulkan::saveScreenshot(const std::string &name) {
+    saveScreenshotAsync(name).get();
+}
+
+std::shared_future<void> Vulkan::saveScreenshotAsync(const std::string &name) {
+    // the encoder splits the image into strips, so a single screenshot already uses all of its threads
+    return readScreenshotAsync([this, name](const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t view) {
+        imageEncoder.write(settings.viewCount > 1 ? getViewScreenshotName(name, view) : name, pixels, width, height,
+                           settings.pngCompressionLevel);
+    }, name);
+}
+
+std::string getViewScreenshotName(const std::string &name, uint32_t view) {
+    const size_t directoryEnd = name.find_last_of("/\\");
+    const size_t extensionBegin = name.find_last_of('.');
+
+    // without an extension, the view is appended
+    const size_t insertPosition = extensionBegin == std::string::npos ||
+                                  (directoryEnd != std::string::npos && extensionBegin < directoryEnd)
+                                  ? name.size() : extensionBegin;
+
+    return name.substr(0, insertPosition) + "_view" + std::to_string(view) + name.substr(insertPosition);
+}
+
+std::shared_future<void> Vulkan::readScreenshotAsync(ScreenshotCallback callback, const std::string &name) {
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    ReadbackSlot &slot = readbackSlots[nextReadbackSlot];
+    nextReadbackSlot = (nextReadbackSlot + 1) % static_cast<uint32_t>(readbackSlots.size());
+
+    // the staging buffer and command buffer are reused once the oldest screenshot has been written
+    if (slot.completion.valid()) {
+        slot.completion.wait();
+    }
+
+    if (readbackTimestampsSupported) {
+        device.resetQueryPool(queryPool, slot.queryIndex, 2);
+    }
+
+    const vk::CommandBuffer &commandBuffer = slot.commandBuffer;
+    commandBuffer.reset();
+
+    vk::CommandBufferBeginInfo beginInfo = {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+    commandBuffer.begin(&beginInfo);
+
+    if (readbackTimestampsSupported) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTransfer, queryPool, slot.queryIndex);
+    }
+
+    std::vector<vk::BufferImageCopy> screenshotImageCopy = {
+            {
+                    .bufferOffset = 0,
+                    .bufferRowLength = settings.windowWidth,
+                    .bufferImageHeight = settings.windowHeight,
+                    .imageSubresource = {
+                            .aspectMask = vk::ImageAspectFlagBits::eColor,
+                            .mipLevel = 0,
+                            .baseArrayLayer = 0,
+                            .layerCount = settings.viewCount
+                    },
+                    .imageOffset = {.x = 0, .y = 0, .z = 0},
+                    .imageExtent = {
+                            .width = settings.windowWidth,
+                            .height = settings.windowHeight,
+                            .depth = 1
+                    },
+            }
+    };
+
+    commandBuffer.copyImageToBuffer(renderTargetImage.image, vk::ImageLayout::eGeneral, slot.buffer.buffer,
+                                    screenshotImageCopy);
+
+    if (readbackTimestampsSupported) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTransfer, queryPool, slot.queryIndex + 1);
+    }
+
+    const vk::MemoryBarrier hostReadBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                  {}, 1, &hostReadBarrier, 0, nullptr, 0, nullptr);
+
+    commandBuffer.end();
+
+    // the render calls end with a barrier that makes the render target available to transfer reads
+    const uint64_t renderCallValue = submittedTimelineValue;
+    const uint64_t readbackValue = ++submittedReadbackValue;
+    const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eTransfer;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+            .waitSemaphoreValueCount = 1,
+            .pWaitSemaphoreValues = &renderCallValue,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &readbackValue
+    };
+
+    vk::SubmitInfo submitInfo = {
+            .pNext = &timelineSubmitInfo,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &timelineSemaphore,
+            .pWaitDstStageMask = &waitStage,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &readbackTimelineSemaphore
+    };
+
+    transferQueue.submit(1, &submitInfo, nullptr);
+
+    const double hostBlockedMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - beginTime).count();
+
+    const auto pixels = static_cast<const uint8_t*>(slot.memory);
+    const uint32_t queryIndex = slot.queryIndex;
+
+    slot.completion = std::async(std::launch::async, [=, this]() {
+        waitForReadbackValue(readbackValue);
+
+        const size_t layerSize = size_t(settings.windowWidth) * settings.windowHeight * 4;
+        for (uint32_t view = 0; view < settings.viewCount; view++) {
+            callback(pixels + view * layerSize, settings.windowWidth, settings.windowHeight, view);
+        }
+
+        const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+        screenshotTimings.push_back(
+                {
+                        .name = name,
+                        .gpuCopyTimeMs = readbackTimestampsSupported ? readTimestampDurationMs(queryIndex) : 0.0,
+                        .hostTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - beginTime).count(),
+                        .hostBlockedMs = hostBlockedMs
+                });
+    }).share();
+
+    return slot.completion;
+}
+
+void Vulkan::waitForScreenshots() {
+    for (const ReadbackSlot &slot: readbackSlots) {
+        if (slot.completion.valid()) {
+            slot.completion.wait();
+        }
+    }
+
+    if (hdrReadback.completion.valid()) {
+        hdrReadback.completion.wait();
+    }
+}
+
+void Vulkan::createHdrReadback() {
+    const vk::DeviceSize pixelCount = vk::DeviceSize(settings.windowWidth) * settings.windowHeight;
+    const bool hasVariance = settings.adaptiveSampling || settings.progressive;
+
+    // 4 floats per pixel in the progressive mode, 4 normalized 16-bit values otherwise
+    hdrReadback.colorSize = pixelCount * (settings.progressive ? 16 : 8);
+    hdrReadback.buffer = createBuffer(hdrReadback.colorSize + (hasVariance ? pixelCount * 16 : 0),
+                                      vk::BufferUsageFlagBits::eTransferDst,
+                                      vk::MemoryPropertyFlagBits::eHostVisible |
+                                      vk::MemoryPropertyFlagBits::eHostCoherent);
+    hdrReadback.memory = device.mapMemory(hdrReadback.buffer.memory, 0, VK_WHOLE_SIZE);
+
+    hdrReadback.commandBuffer = device.allocateCommandBuffers(
+            {
+                    .commandPool = commandPool,
+                    .level = vk::CommandBufferLevel::ePrimary,
+                    .commandBufferCount = 1
+            }).front();
+
+    hdrReadback.fence = device.createFence({});
+}
+
+void Vulkan::saveHdrScreenshot(const std::string &name) {
+    saveHdrScreenshotAsync(name).get();
+}
+
+std::shared_future<void> Vulkan::saveHdrScreenshotAsync(const std::string &name) {
+    // the readback only copies the first layer of the summed colors
+    if (settings.viewCount > 1)
+        throw std::runtime_error("HDR screenshots aren't supported with several views!");
+
+    const auto beginTime = std::chrono::steady_clock::now();
+
+    if (hdrReadback.completion.valid()) {
+        hdrReadback.completion.wait();
+    }
+
+    submitHdrReadback();
+
+    const double hostBlockedMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - beginTime).count();
+
+    const RenderCallInfo renderCallInfo = submittedRenderCallInfo;
+
+    hdrReadback.completion = std::async(std::launch::async, [=, this]() {
+        if (device.waitForFences(hdrReadback.fence, true, UINT64_MAX) != vk::Result::eSuccess)
+            throw std::runtime_error("[Error] Failed to wait for the HDR screenshot copy!");
+
+        writeHdrImage(name, settings.windowWidth, settings.windowHeight, [&](uint32_t y, float* rgb) {
+            resolveHdrRow(renderCallInfo, y, rgb);
+        });
+
+        // the copy shares the compute queue with the render calls, so it isn't timed
+        const std::lock_guard<std::mutex> lock(screenshotTimingsMutex);
+        screenshotTimings.push_back(
+                {
+                        .name = name,
+                        .gpuCopyTimeMs = 0.0,
+                        .hostTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - beginTime).count(),
+                        .hostBlockedMs = hostBlockedMs
+                });
+    }).share();
+
+    return hdrReadback.completion;
+}
+
+std::vector<float> Vulkan::readSummedPixelColors() {
+    if (settings.progressive)
+        throw std::runtime_error("The summed pixel colors aren't available in the progressive mode!");
+
+    if (settings.viewCount > 1)
+        throw std::runtime_error("The summed pixel colors aren't available with several views!");
+
+    if (hdrReadback.completion.valid()) {
+        hdrReadback.completion.wait();
+    }
+
+    submitHdrReadback();
+
+    if (device.waitForFences(hdrReadback.fence, true, UINT64_MAX) != vk::Result::eSuccess)
+        throw std::runtime_error("[Error] Failed to wait for the summed pixel color copy!");
+
+    const size_t pixelCount = size_t(settings.windowWidth) * settings.windowHeight;
+    const auto* summedColors = static_cast<const uint16_t*>(hdrReadback.memory);
+    std::vector<float> colors(pixelCount * 3);
+
+    for (size_t pixel = 0; pixel < pixelCount; pixel++) {
+        for (size_t channel = 0; channel < 3; channel++) {
+            colors[pixel * 3 + channel] = float(summedColors[pixel * 4 + channel]) / 65535.0f;
+        }
+    }
+
+    return colors;
+}
+
+void Vulkan::submitHdrReadback() {
+    if (!hdrReadback.buffer.buffer) {
+        createHdrReadback();
+    }
+
+    const bool hasVariance = settings.adaptiveSampling || settings.progressive;
+    const VulkanImage &colorImage = settings.progressive ? accumulationImage : summedPixelColorImage;
+
+    const vk::CommandBuffer &commandBuffer = hdrReadback.commandBuffer;
+    commandBuffer.reset();
+
+    vk::CommandBufferBeginInfo beginInfo = {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+    commandBuffer.begin(&beginInfo);
+
+    // the render calls before on the same queue write both images
+    const vk::ImageMemoryBarrier imageBarriers[2] = {
+            getImagePipelineBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+                                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, colorImage.image),
+            getImagePipelineBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead,
+                                    vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral, varianceImage.image)
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                  {}, 0, nullptr, 0, nullptr, hasVariance ? 2 : 1, imageBarriers);
+
+    vk::BufferImageCopy imageCopy = {
+            .bufferOffset = 0,
+            .bufferRowLength = settings.windowWidth,
+            .bufferImageHeight = settings.windowHeight,
+            .imageSubresource = {
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+            },
+            .imageOffset = {.x = 0, .y = 0, .z = 0},
+            .imageExtent = {
+                    .width = settings.windowWidth,
+                    .height = settings.windowHeight,
+                    .depth = 1
+            },
+    };
+
+    commandBuffer.copyImageToBuffer(colorImage.image, vk::ImageLayout::eGeneral, hdrReadback.buffer.buffer, 1,
+                                    &imageCopy);
+
+    if (hasVariance) {
+        imageCopy.bufferOffset = hdrReadback.colorSize;
+        commandBuffer.copyImageToBuffer(varianceImage.image, vk::ImageLayout::eGeneral, hdrReadback.buffer.buffer, 1,
+                                        &imageCopy);
+    }
+
+    const vk::MemoryBarrier hostReadBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                  {}, 1, &hostReadBarrier, 0, nullptr, 0, nullptr);
+
+    commandBuffer.end();
+
+    device.resetFences(hdrReadback.fence);
+
+    vk::SubmitInfo submitInfo = {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer
+    };
+
+    computeQueue.submit(1, &submitInfo, hdrReadback.fence);
+}
+
+void Vulkan::resolveHdrRow(const RenderCallInfo &renderCallInfo, uint32_t y, float* rgb) const {
+    const bool hasVariance = settings.adaptiveSampling || settings.progressive;
+
+    // the summed color image holds the sum of the samples divided by totalSamples, and every pixel has the samples of
+    // all render calls so far unless adaptive sampling skipped it (then the sample count is tracked per pixel)
+    float colorScale = 1.0f;
+    if (!settings.progressive && renderCallInfo.number > 0) {
+        colorScale = settings.adaptiveSampling ? float(renderCallInfo.totalSamples)
+                                               : float(renderCallInfo.totalRenderCalls) / float(renderCallInfo.number);
+    }
+
+    const auto* colorMemory = static_cast<const uint8_t*>(hdrReadback.memory);
+    const auto* accumulatedColors = reinterpret_cast<const float*>(colorMemory);
+    const auto* summedColors = reinterpret_cast<const uint16_t*>(colorMemory);
+    const auto* variances = reinterpret_cast<const float*>(colorMemory + hdrReadback.colorSize);
+
+    for (uint32_t x = 0; x < settings.windowWidth; x++) {
+        const size_t pixel = size_t(y) * settings.windowWidth + x;
+        const float sampleCount = hasVariance ? variances[pixel * 4] : 1.0f;
+        const float scale = sampleCount > 0.0f ? colorScale / sampleCount : 0.0f;
+
+        for (size_t channel = 0; channel < 3; channel++) {
+            const float color = settings.progressive ? accumulatedColors[pixel * 4 + channel]
+                                                     : float(summedColors[pixel * 4 + channel]) / 65535.0f;
+            rgb[x * 3 + channel] = color * scale;
+        }
+    }
+}
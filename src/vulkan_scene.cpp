@@ -0,0 +1,418 @@
+#include "vulkan.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Scene memory: the spheres, materials and BVH nodes are stored in device-local storage buffers, so the shader doesn't
+// read them across the bus on discrete GPUs. They are filled once through a staging buffer, in chunks, straight from
+// the scene (or the mapped scene file).
+//
+// Scene updates are staged in a persistently mapped upload buffer of the frame that is submitted next, which only has
+// to wait for the previous submission of that frame. Its command buffer copies the staged ranges into the scene
+// buffers in one batch before the dispatch. The barrier in front of the copies orders them after the dispatches of the
+// earlier frames, which may still read the previous contents, so neither the host nor the device waits for all work.
+// The cameras of the views are stored and updated the same way.
+
+namespace {
+    // at most this much host-visible memory is used for the initial upload
+    const vk::DeviceSize SCENE_STAGING_BUFFER_SIZE = 64 * 1024 * 1024;
+
+    // the smallest upload buffer of a frame, it grows to twice its size whenever it is too small
+    const vk::DeviceSize MIN_UPLOAD_BUFFER_SIZE = 64 * 1024;
+
+    const uint32_t NO_PARENT = UINT32_MAX;
+
+    ViewCamera toViewCamera(const Camera &camera) {
+        return {
+                .fov = camera.fov,
+                .aperture = camera.aperture,
+                .focusDistance = camera.focusDistance,
+                .lookFrom = camera.lookFrom,
+                .lookAt = camera.lookAt,
+                .up = camera.up
+        };
+    }
+}
+
+void Vulkan::createBVH(const SceneFile* sceneFile) {
+    // the spheres of a scene file are already in the order of its BVH, they are uploaded as they are
+    if (sceneFile && !sceneFile->getBvhNodes().empty()) {
+        const std::span<const BVHNode> nodes = sceneFile->getBvhNodes();
+        bvhNodes.assign(nodes.begin(), nodes.end());
+        return;
+    }
+
+    if (sceneFile) {
+        scene = sceneFile->toScene();
+    }
+
+    // the BVH reorders the spheres, the index of every sphere is carried through it in place of its material index,
+    // so updates can still address the spheres by their index in the scene
+    std::vector<uint32_t> materialIndices(scene.spheres.size());
+
+    for (size_t i = 0; i < scene.spheres.size(); i++) {
+        materialIndices[i] = scene.spheres[i].materialIndex;
+        scene.spheres[i].materialIndex = static_cast<uint32_t>(i);
+    }
+
+    // reorders the spheres, so this has to happen before they are uploaded
+    bvhNodes = buildBVH(scene.spheres);
+
+    spherePositions.resize(scene.spheres.size());
+
+    for (size_t position = 0; position < scene.spheres.size(); position++) {
+        Sphere &sphere = scene.spheres[position];
+        spherePositions[sphere.materialIndex] = static_cast<uint32_t>(position);
+        sphere.materialIndex = materialIndices[sphere.materialIndex];
+    }
+}
+
+void Vulkan::createSceneBuffer(const SceneFile* sceneFile) {
+    std::span<const Sphere> spheres = scene.spheres;
+    std::span<const Material> materials = scene.materials;
+
+    if (sceneFile && !sceneFile->getBvhNodes().empty()) {
+        spheres = sceneFile->getSpheres();
+        materials = sceneFile->getMaterials();
+    }
+
+    sceneSphereCount = static_cast<uint32_t>(spheres.size());
+    sceneMaterialCount = static_cast<uint32_t>(materials.size());
+
+    for (const Sphere &sphere: spheres) {
+        if (sphere.materialIndex >= materials.size()) {
+            throw std::runtime_error("Sphere references material " + std::to_string(sphere.materialIndex) +
+                                     ", but the scene only has " + std::to_string(materials.size()) + "!");
+        }
+    }
+
+    // the shader and the updates (see growBvhNodes) follow the nodes without any bounds checks
+    validateBVH(bvhNodes, spheres.size());
+    validateMaterials(materials);
+
+    // only the material types of the scene are compiled into the specialized shader, updates can switch between them
+    for (const Material &material: materials) {
+        sceneMaterialTypes |= 1u << material.type;
+    }
+
+    sphereBuffer = createStorageBuffer(spheres.size_bytes());
+    materialBuffer = createStorageBuffer(materials.size_bytes());
+    bvhBuffer = createStorageBuffer(bvhNodes.size() * sizeof(BVHNode));
+
+    // every view starts with the camera of the scene
+    const std::vector<ViewCamera> cameras(settings.viewCount, toViewCamera(scene.camera));
+    cameraBuffer = createStorageBuffer(cameras.size() * sizeof(ViewCamera));
+
+    struct Upload {
+        const VulkanBuffer &buffer;
+        const uint8_t* data;
+        vk::DeviceSize size;
+    };
+
+    const Upload uploads[4] = {
+            {sphereBuffer, reinterpret_cast<const uint8_t*>(spheres.data()), spheres.size_bytes()},
+            {materialBuffer, reinterpret_cast<const uint8_t*>(materials.data()), materials.size_bytes()},
+            {bvhBuffer, reinterpret_cast<const uint8_t*>(bvhNodes.data()), bvhNodes.size() * sizeof(BVHNode)},
+            {cameraBuffer, reinterpret_cast<const uint8_t*>(cameras.data()), cameras.size() * sizeof(ViewCamera)}
+    };
+
+    if (!settings.deviceLocalScene) {
+        for (const Upload &upload: uploads) {
+            if (upload.size > 0) {
+                void* mappedMemory = device.mapMemory(upload.buffer.memory, 0, upload.size);
+                memcpy(mappedMemory, upload.data, upload.size);
+                device.unmapMemory(upload.buffer.memory);
+            }
+        }
+
+        return;
+    }
+
+    vk::DeviceSize totalSize = 0;
+    for (const Upload &upload: uploads) {
+        totalSize += upload.size;
+    }
+
+    if (totalSize == 0)
+        return;
+
+    const vk::DeviceSize stagingSize = std::min(totalSize, SCENE_STAGING_BUFFER_SIZE);
+    const VulkanBuffer stagingBuffer = createBuffer(stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+                                                    vk::MemoryPropertyFlagBits::eHostVisible |
+                                                    vk::MemoryPropertyFlagBits::eHostCoherent);
+    auto* stagingMemory = static_cast<uint8_t*>(device.mapMemory(stagingBuffer.memory, 0, stagingSize));
+
+    // the staging buffer is filled with as many chunks of the arrays as fit, then copied in a single submission
+    std::vector<std::pair<vk::Buffer, vk::BufferCopy>> copies;
+    vk::DeviceSize stagedSize = 0;
+
+    const auto flush = [&]() {
+        executeSingleTimeCommands([&](const vk::CommandBuffer &commandBuffer) {
+            for (const auto &[buffer, region]: copies) {
+                commandBuffer.copyBuffer(stagingBuffer.buffer, buffer, 1, &region);
+            }
+
+            // the fence only makes the copies visible to the host, not to the shader of the next submission
+            const vk::MemoryBarrier memoryBarrier = {
+                    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .dstAccessMask = vk::AccessFlagBits::eShaderRead
+            };
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                          vk::PipelineStageFlagBits::eComputeShader,
+                                          {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+        });
+
+        copies.clear();
+        stagedSize = 0;
+    };
+
+    for (const Upload &upload: uploads) {
+        for (vk::DeviceSize offset = 0; offset < upload.size;) {
+            const vk::DeviceSize chunkSize = std::min(upload.size - offset, stagingSize - stagedSize);
+            memcpy(stagingMemory + stagedSize, upload.data + offset, chunkSize);
+
+            copies.emplace_back(upload.buffer.buffer,
+                                vk::BufferCopy{.srcOffset = stagedSize, .dstOffset = offset, .size = chunkSize});
+
+            stagedSize += chunkSize;
+            offset += chunkSize;
+
+            if (stagedSize == stagingSize) {
+                flush();
+            }
+        }
+    }
+
+    if (!copies.empty()) {
+        flush();
+    }
+
+    device.unmapMemory(stagingBuffer.memory);
+    destroyBuffer(stagingBuffer);
+}
+
+VulkanBuffer Vulkan::createStorageBuffer(const vk::DeviceSize &size) {
+    if (size > physicalDevice.getProperties().limits.maxStorageBufferRange) {
+        throw std::runtime_error("Scene data of " + std::to_string(size) + " bytes exceeds the storage buffer range!");
+    }
+
+    // empty buffers are not allowed, the shader sees a runtime array of length 0 instead
+    const vk::DeviceSize bufferSize = std::max(size, vk::DeviceSize(16));
+
+    // updates are always copied on the device, even into host-visible memory, which frames in flight may still read
+    return createBuffer(bufferSize,
+                        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                        settings.deviceLocalScene
+                        ? vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal)
+                        : vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+void Vulkan::updateSpheres(uint32_t firstSphere, std::span<const Sphere> spheres) {
+    if (uint64_t(firstSphere) + spheres.size() > sceneSphereCount)
+        throw std::runtime_error("Spheres " + std::to_string(firstSphere) + " to " +
+                                 std::to_string(firstSphere + spheres.size() - 1) + " are out of range, the scene has " +
+                                 std::to_string(sceneSphereCount) + "!");
+
+    for (const Sphere &sphere: spheres) {
+        if (sphere.materialIndex >= sceneMaterialCount)
+            throw std::runtime_error("Sphere references material " + std::to_string(sphere.materialIndex) +
+                                     ", but the scene only has " + std::to_string(sceneMaterialCount) + "!");
+    }
+
+    // the positions of the spheres in the sphere buffer, sorted so that neighbouring spheres are copied together
+    std::vector<std::pair<uint32_t, uint32_t>> order(spheres.size()); // position, index in spheres
+    for (uint32_t i = 0; i < spheres.size(); i++) {
+        order[i] = {spherePositions.empty() ? firstSphere + i : spherePositions[firstSphere + i], i};
+    }
+
+    std::sort(order.begin(), order.end());
+
+    std::vector<uint32_t> positions(order.size());
+    std::vector<Sphere> sortedSpheres(order.size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        positions[i] = order[i].first;
+        sortedSpheres[i] = spheres[order[i].second];
+    }
+
+    // one copy per run of consecutive positions
+    for (size_t first = 0; first < positions.size();) {
+        size_t last = first;
+        while (last + 1 < positions.size() && positions[last + 1] == positions[last] + 1) {
+            last++;
+        }
+
+        stageSceneUpload(sphereBuffer, vk::DeviceSize(positions[first]) * sizeof(Sphere), &sortedSpheres[first],
+                         (last - first + 1) * sizeof(Sphere));
+        first = last + 1;
+    }
+
+    growBvhNodes(positions, sortedSpheres);
+}
+
+void Vulkan::updateMaterials(uint32_t firstMaterial, std::span<const Material> materials) {
+    if (uint64_t(firstMaterial) + materials.size() > sceneMaterialCount)
+        throw std::runtime_error("Materials " + std::to_string(firstMaterial) + " to " +
+                                 std::to_string(firstMaterial + materials.size() - 1) +
+                                 " are out of range, the scene has " + std::to_string(sceneMaterialCount) + "!");
+
+    validateMaterials(materials);
+
+    for (const Material &material: materials) {
+        if (!(sceneMaterialTypes & (1u << material.type)))
+            throw std::runtime_error("Material type " + std::to_string(material.type) +
+                                     " isn't part of the scene and can't be added by an update!");
+    }
+
+    if (!materials.empty()) {
+        stageSceneUpload(materialBuffer, vk::DeviceSize(firstMaterial) * sizeof(Material), materials.data(),
+                         materials.size_bytes());
+    }
+}
+
+void Vulkan::setCameras(std::span<const Camera> cameras) {
+    if (cameras.size() != settings.viewCount)
+        throw std::runtime_error(std::to_string(cameras.size()) + " cameras were given, but the renderer has " +
+                                 std::to_string(settings.viewCount) + " view(s)!");
+
+    std::vector<ViewCamera> viewCameras;
+    for (const Camera &camera: cameras) {
+        viewCameras.push_back(toViewCamera(camera));
+    }
+
+    scene.camera = cameras.front();
+    stageSceneUpload(cameraBuffer, 0, viewCameras.data(), viewCameras.size() * sizeof(ViewCamera));
+}
+
+void Vulkan::setCamera(const Camera &camera) {
+    const ViewCamera viewCamera = toViewCamera(camera);
+
+    scene.camera = camera;
+    stageSceneUpload(cameraBuffer, 0, &viewCamera, sizeof(ViewCamera));
+}
+
+void Vulkan::growBvhNodes(std::span<const uint32_t> positions, std::span<const Sphere> spheres) {
+    if (bvhNodes.empty() || positions.empty())
+        return;
+
+    // inner nodes are followed by their first child, the second one is at their offset; createSceneBuffer made sure
+    // that every index is in range and that every node has a single parent
+    if (sphereLeaves.empty()) {
+        bvhParents.assign(bvhNodes.size(), NO_PARENT);
+        sphereLeaves.resize(sceneSphereCount);
+
+        for (uint32_t node = 0; node < bvhNodes.size(); node++) {
+            const BVHNode &bvhNode = bvhNodes[node];
+
+            if (bvhNode.sphereCount > 0) {
+                std::fill_n(sphereLeaves.begin() + bvhNode.offset, bvhNode.sphereCount, node);
+            } else {
+                bvhParents[node + 1] = node;
+                bvhParents[bvhNode.offset] = node;
+            }
+        }
+    }
+
+    std::vector<uint32_t> grownNodes;
+
+    for (size_t i = 0; i < positions.size(); i++) {
+        const glm::vec3 aabbMin = spheres[i].center - glm::vec3(spheres[i].radius);
+        const glm::vec3 aabbMax = spheres[i].center + glm::vec3(spheres[i].radius);
+
+        // the ancestors of a node that already encloses the sphere enclose it as well
+        for (uint32_t node = sphereLeaves[positions[i]]; node != NO_PARENT; node = bvhParents[node]) {
+            BVHNode &bvhNode = bvhNodes[node];
+
+            if (glm::all(glm::lessThanEqual(bvhNode.aabbMin, aabbMin)) &&
+                glm::all(glm::greaterThanEqual(bvhNode.aabbMax, aabbMax)))
+                break;
+
+            bvhNode.aabbMin = glm::min(bvhNode.aabbMin, aabbMin);
+            bvhNode.aabbMax = glm::max(bvhNode.aabbMax, aabbMax);
+            grownNodes.push_back(node);
+        }
+    }
+
+    std::sort(grownNodes.begin(), grownNodes.end());
+    grownNodes.erase(std::unique(grownNodes.begin(), grownNodes.end()), grownNodes.end());
+
+    for (size_t first = 0; first < grownNodes.size();) {
+        size_t last = first;
+        while (last + 1 < grownNodes.size() && grownNodes[last + 1] == grownNodes[last] + 1) {
+            last++;
+        }
+
+        stageSceneUpload(bvhBuffer, vk::DeviceSize(grownNodes[first]) * sizeof(BVHNode), &bvhNodes[grownNodes[first]],
+                         (last - first + 1) * sizeof(BVHNode));
+        first = last + 1;
+    }
+}
+
+void Vulkan::stageSceneUpload(const VulkanBuffer &buffer, vk::DeviceSize offset, const void* data,
+                              vk::DeviceSize size) {
+    Frame &frame = frames[currentFrame];
+
+    // the upload buffer may still be read by the previous submission of this frame, the other frames keep running
+    waitForTimelineValue(frame.timelineValue);
+
+    if (frame.uploadSize + size > frame.uploadBuffer.size) {
+        const vk::DeviceSize capacity = std::max({frame.uploadBuffer.size * 2, frame.uploadSize + size,
+                                                  MIN_UPLOAD_BUFFER_SIZE});
+        const VulkanBuffer uploadBuffer = createBuffer(capacity, vk::BufferUsageFlagBits::eTransferSrc,
+                                                       vk::MemoryPropertyFlagBits::eHostVisible |
+                                                       vk::MemoryPropertyFlagBits::eHostCoherent);
+        auto* uploadMemory = static_cast<uint8_t*>(device.mapMemory(uploadBuffer.memory, 0, VK_WHOLE_SIZE));
+
+        if (frame.uploadBuffer.buffer) {
+            memcpy(uploadMemory, frame.uploadMemory, frame.uploadSize);
+            device.unmapMemory(frame.uploadBuffer.memory);
+            destroyBuffer(frame.uploadBuffer);
+        }
+
+        frame.uploadBuffer = uploadBuffer;
+        frame.uploadMemory = uploadMemory;
+    }
+
+    memcpy(frame.uploadMemory + frame.uploadSize, data, size);
+
+    // e.g. two cameras set before a render call: the range staged last replaces the overlapped bytes of earlier ones
+    frame.sceneUploads[static_cast<VkBuffer>(buffer.buffer)].add(frame.uploadSize, offset, size);
+
+    frame.uploadSize += size;
+}
+
+void Vulkan::recordSceneUploads(const Frame &frame) const {
+    if (frame.sceneUploads.empty())
+        return;
+
+    const vk::CommandBuffer &commandBuffer = frame.commandBuffer;
+
+    // the dispatches of the other frames may still read the ranges that are overwritten
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                  {}, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    // one copy command per scene buffer with all of its regions, which never overlap
+    std::vector<vk::BufferCopy> regions;
+
+    for (const auto &[buffer, ranges]: frame.sceneUploads) {
+        regions.clear();
+
+        for (const StagedRange &range: ranges.getRanges()) {
+            regions.push_back(
+                    {.srcOffset = range.sourceOffset, .dstOffset = range.destinationOffset, .size = range.size});
+        }
+
+        if (!regions.empty()) {
+            commandBuffer.copyBuffer(frame.uploadBuffer.buffer, vk::Buffer(buffer), regions);
+        }
+    }
+
+    const vk::MemoryBarrier memoryBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
@@ -2,9 +2,54 @@
 
 #include <string>
 
+enum class RenderMode {
+    MEGAKERNEL, // one thread traces all samples and bounces of a pixel (shader.comp)
+    WAVEFRONT // separate kernels for ray generation, intersection and shading per material type (wavefront.comp)
+};
+
+enum class TileOrder {
+    CENTER_FIRST, // by distance to the center of the image
+    COST // most expensive first, measured in the previous render calls
+};
+
 struct VulkanSettings {
     uint32_t windowWidth, windowHeight;
     std::string computeShaderFile;
     uint32_t computeShaderGroupSizeX;
     uint32_t computeShaderGroupSizeY;
+    bool headless = false; // render into an offscreen image without creating a window or swap chain
+    std::string physicalDeviceName; // if not empty, only devices whose name contains it are considered
+    uint32_t physicalDeviceIndex = 0; // among the devices that match the name and support all required features
+    uint32_t devicesPerPhysicalDevice = 1; // multi-device: logical devices per physical device, e.g. to test on one
+    uint32_t maxDepth = 50; // maximum amount of bounces per path
+    uint32_t framesInFlight = 2; // render calls the host may queue before it waits for the GPU
+    bool useBvh = true; // false: test every ray against every sphere (only useful for comparisons)
+    bool deviceLocalScene = true; // false: the shader reads the scene from host-visible memory (for comparisons)
+    bool specializeShader = true; // false: one generic pipeline for all samples per pass and material types
+    bool autotuneWorkgroupSize = false; // replace computeShaderGroupSizeX/Y by the fastest of several candidates
+    bool russianRoulette = false; // randomly terminate paths with a low throughput, without biasing the result
+    uint32_t russianRouletteMinDepth = 3; // bounces before a path can be terminated
+    bool collectPathStatistics = false; // count paths and bounces to report the average path length of each render call
+    bool adaptiveSampling = false; // only trace the tiles with pixels that haven't converged yet (megakernel only)
+    uint32_t adaptiveSamplingMinSamples = 16; // samples per pixel before its variance estimate is trusted
+    float adaptiveSamplingThreshold = 0.02f; // relative standard error of the mean at which a pixel has converged
+    bool tiledRendering = false; // split every render call into submissions of tiles that fit the time budget
+    uint32_t tileSize = 256; // pixels, rounded up to whole work groups
+    TileOrder tileOrder = TileOrder::CENTER_FIRST;
+    double tileTimeBudgetMs = 30.0; // targeted GPU time per submission
+    bool progressive = false; // accumulate in a float image for an open-ended amount of render calls (megakernel only)
+    double progressiveTargetError = 0.01; // root mean square of the relative pixel errors to stop at
+    uint32_t progressiveMaxRenderCalls = 2000; // stop here if the target error is never reached, e.g. by fireflies
+    uint32_t viewCount = 1; // cameras traced by every dispatch into the layers of the render target (megakernel only)
+    uint32_t screenshotSlots = 2; // staging buffers, further screenshots wait until the oldest one has been written
+    bool useTransferQueue = true; // copy screenshots on a dedicated transfer queue, if the device has one
+    uint32_t encoderThreads = 0; // threads that encode screenshots, 0: one per hardware thread
+    uint32_t pngCompressionLevel = 6; // 0 (uncompressed) to 9, ".qoi" screenshots aren't affected
+    uint32_t cpuThreads = 0; // threads of the CPU renderer, 0: one per hardware thread
+    bool cpuSimd = true; // intersect 8 spheres at a time with AVX2 in the CPU renderer, if the CPU supports it
+    RenderMode renderMode = RenderMode::MEGAKERNEL;
+    std::string wavefrontShaderFile = "wavefront.comp.spv";
+    std::string adaptiveSamplingShaderFile = "adaptive_sampling.comp.spv";
+    std::string workgroupSizeCacheFile = "workgroup_size.cache"; // autotune results per device, driver and shader
+    std::string pipelineCacheDirectory = "pipeline_cache"; // compiled pipelines of every device and driver, empty: none
 };
@@ -0,0 +1,207 @@
+#include "vulkan.h"
+#include <cmath>
+#include <cstddef>
+#include <exception>
+
+// Wavefront path tracing (RenderMode::WAVEFRONT): every pixel owns one path, the kernels of wavefront.comp pass the
+// indices of the active paths between each other through queues in storage buffers.
+
+void Vulkan::createWavefrontBuffers() {
+    const vk::DeviceSize pathCount = vk::DeviceSize(settings.windowWidth) * settings.windowHeight;
+    const vk::DeviceSize maxStorageBufferRange = physicalDevice.getProperties().limits.maxStorageBufferRange;
+
+    // path state (4 x vec4), ray queue, one queue per material type and the radiance (vec4) of each path
+    const vk::DeviceSize pathBufferSize = pathCount * 4 * 16;
+    const vk::DeviceSize materialQueueBufferSize = pathCount * 3 * sizeof(uint32_t);
+
+    if (pathBufferSize > maxStorageBufferRange || materialQueueBufferSize > maxStorageBufferRange) {
+        throw std::runtime_error("The wavefront path buffers exceed the storage buffer range at this resolution!");
+    }
+
+    const vk::Flags<vk::BufferUsageFlagBits> usage =
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+    pathBuffer = createBuffer(pathBufferSize, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    rayQueueBuffer = createBuffer(pathCount * sizeof(uint32_t), usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    materialQueueBuffer = createBuffer(materialQueueBufferSize, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    radianceBuffer = createBuffer(pathCount * 16, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // the queue state also holds the arguments of the indirect dispatches
+    queueStateBuffer = createBuffer(sizeof(WavefrontQueueState), usage | vk::BufferUsageFlagBits::eIndirectBuffer,
+                                    vk::MemoryPropertyFlagBits::eDeviceLocal);
+}
+
+void Vulkan::createWavefrontPipelines(const std::vector<char> &wavefrontShaderCode) {
+    vk::ShaderModule wavefrontShaderModule = device.createShaderModule(
+            {
+                    .codeSize = wavefrontShaderCode.size(),
+                    .pCode = reinterpret_cast<const uint32_t*>(wavefrontShaderCode.data())
+            });
+
+    const WorkgroupSize pixelWorkgroupSize = getWorkgroupSize();
+    const WorkgroupSize queueWorkgroupSize = {.x = pixelWorkgroupSize.x * pixelWorkgroupSize.y, .y = 1};
+
+    std::vector<std::pair<WavefrontKernel, WorkgroupSize>> kernels = {
+            {WavefrontKernel::GENERATE, pixelWorkgroupSize},
+            {WavefrontKernel::PREPARE_INTERSECT, queueWorkgroupSize},
+            {WavefrontKernel::INTERSECT, queueWorkgroupSize},
+            {WavefrontKernel::PREPARE_SHADE, queueWorkgroupSize},
+            {WavefrontKernel::RESOLVE, pixelWorkgroupSize}
+    };
+
+    // shading kernels are only needed for the material types of the scene
+    const std::pair<MaterialType, WavefrontKernel> shadingKernels[3] = {
+            {MaterialType::DIFFUSE, WavefrontKernel::SHADE_DIFFUSE},
+            {MaterialType::METAL, WavefrontKernel::SHADE_METAL},
+            {MaterialType::REFRACTIVE, WavefrontKernel::SHADE_REFRACTIVE}
+    };
+
+    for (const auto &[materialType, kernel]: shadingKernels) {
+        if (sceneMaterialTypes & (1u << materialType)) {
+            kernels.emplace_back(kernel, queueWorkgroupSize);
+        }
+    }
+
+    if (!isSupportedWorkgroupSize(queueWorkgroupSize)) {
+        device.destroyShaderModule(wavefrontShaderModule);
+        throw std::runtime_error("Work group size " + std::to_string(queueWorkgroupSize.x) +
+                                 "x1 of the wavefront queue kernels is not supported by the GPU!");
+    }
+
+    // The samples per pass are read from the push constants, all kernels work for any render call. Drivers compile a
+    // pipeline on the calling thread, so the kernels are compiled on a thread each.
+    std::vector<std::future<vk::Pipeline>> pipelineCreations;
+
+    for (const auto &kernel: kernels) {
+        pipelineCreations.push_back(std::async(std::launch::async, [this, &wavefrontShaderModule, kernel]() {
+            return createComputePipeline(wavefrontShaderModule, kernel.second, 0, kernel.first);
+        }));
+    }
+
+    // every creation has to finish before the module is destroyed, the pipelines of a failed set aren't kept
+    std::exception_ptr failure;
+    std::vector<vk::Pipeline> createdPipelines;
+
+    for (std::future<vk::Pipeline> &pipelineCreation: pipelineCreations) {
+        try {
+            createdPipelines.push_back(pipelineCreation.get());
+        } catch (...) {
+            if (!failure) failure = std::current_exception();
+        }
+    }
+
+    device.destroyShaderModule(wavefrontShaderModule);
+
+    if (failure) {
+        for (const vk::Pipeline &pipeline: createdPipelines) {
+            device.destroyPipeline(pipeline);
+        }
+
+        std::rethrow_exception(failure);
+    }
+
+    for (size_t i = 0; i < kernels.size(); i++) {
+        wavefrontPipelines[kernels[i].first] = createdPipelines[i];
+    }
+}
+
+void Vulkan::initializeWavefrontBuffers() {
+    // the generation kernel continues the random sequence stored in each path, the resolve kernel adds the radiance
+    executeSingleTimeCommands([&](const vk::CommandBuffer &commandBuffer) {
+        for (const VulkanBuffer *buffer: {&pathBuffer, &rayQueueBuffer, &materialQueueBuffer, &queueStateBuffer,
+                                          &radianceBuffer}) {
+            commandBuffer.fillBuffer(buffer->buffer, 0, VK_WHOLE_SIZE, 0);
+        }
+    });
+}
+
+void Vulkan::recordWavefrontDispatches(const vk::CommandBuffer &commandBuffer,
+                                       const RenderCallInfo &renderCallInfo) const {
+    const uint32_t pathCount = settings.windowWidth * settings.windowHeight;
+    const uint32_t samplesPerPass = renderCallInfo.totalSamples / renderCallInfo.totalRenderCalls;
+
+    const WorkgroupSize workgroupSize = getWorkgroupSize();
+    const auto pixelGroupsX = static_cast<uint32_t>(std::ceil(float(settings.windowWidth) / float(workgroupSize.x)));
+    const auto pixelGroupsY = static_cast<uint32_t>(std::ceil(float(settings.windowHeight) / float(workgroupSize.y)));
+
+    // every kernel consumes the buffers written by the previous one, the indirect dispatches also read their arguments
+    const vk::MemoryBarrier memoryBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite |
+                             vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eIndirectCommandRead
+    };
+
+    const auto barrier = [&]() {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer |
+                                      vk::PipelineStageFlagBits::eDrawIndirect,
+                                      {}, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    };
+
+    const auto bind = [&](WavefrontKernel kernel) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, wavefrontPipelines.at(kernel));
+    };
+
+    // the previous render call may still be using the path buffers
+    barrier();
+
+    for (uint32_t sample = 0; sample < samplesPerPass; sample++) {
+        commandBuffer.fillBuffer(queueStateBuffer.buffer, offsetof(WavefrontQueueState, rayCount), sizeof(uint32_t),
+                                 pathCount);
+        // incremented before every intersection kernel, so the first bounce has depth 0
+        commandBuffer.fillBuffer(queueStateBuffer.buffer, offsetof(WavefrontQueueState, depth), sizeof(uint32_t),
+                                 UINT32_MAX);
+        barrier();
+
+        bind(WavefrontKernel::GENERATE);
+        commandBuffer.dispatch(pixelGroupsX, pixelGroupsY, 1);
+        barrier();
+
+        for (uint32_t depth = 0; depth < settings.maxDepth; depth++) {
+            bind(WavefrontKernel::PREPARE_INTERSECT);
+            commandBuffer.dispatch(1, 1, 1);
+            barrier();
+
+            bind(WavefrontKernel::INTERSECT);
+            commandBuffer.dispatchIndirect(queueStateBuffer.buffer, offsetof(WavefrontQueueState, intersectDispatch));
+            barrier();
+
+            // paths that still hit something after the last bounce don't contribute any light
+            if (depth + 1 == settings.maxDepth)
+                break;
+
+            bind(WavefrontKernel::PREPARE_SHADE);
+            commandBuffer.dispatch(1, 1, 1);
+            barrier();
+
+            // the shading kernels work on disjoint paths and only share the atomic counter of the ray queue
+            for (const MaterialType materialType: {MaterialType::DIFFUSE, MaterialType::METAL,
+                                                   MaterialType::REFRACTIVE}) {
+                if (!(sceneMaterialTypes & (1u << materialType)))
+                    continue;
+
+                bind(static_cast<WavefrontKernel>(WavefrontKernel::SHADE_DIFFUSE + materialType));
+                commandBuffer.dispatchIndirect(queueStateBuffer.buffer,
+                                               offsetof(WavefrontQueueState, shadeDispatches) +
+                                               materialType * sizeof(vk::DispatchIndirectCommand));
+            }
+
+            barrier();
+        }
+    }
+
+    bind(WavefrontKernel::RESOLVE);
+    commandBuffer.dispatch(pixelGroupsX, pixelGroupsY, 1);
+}
+
+void Vulkan::destroyWavefrontResources() {
+    for (const auto &[kernel, pipeline]: wavefrontPipelines) {
+        device.destroyPipeline(pipeline);
+    }
+
+    destroyBuffer(pathBuffer);
+    destroyBuffer(rayQueueBuffer);
+    destroyBuffer(materialQueueBuffer);
+    destroyBuffer(queueStateBuffer);
+    destroyBuffer(radianceBuffer);
+}
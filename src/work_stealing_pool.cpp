@@ -0,0 +1,156 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    ranges = std::make_unique<TaskRange[]>(threadCount);
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+
+    startCondition.notify_all();
+
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::run(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)> &function) {
+    if (taskCount == 0)
+        return;
+
+    const uint64_t workerCount = threads.size();
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // no worker accesses the ranges between two runs
+    for (uint64_t worker = 0; worker < workerCount; worker++) {
+        ranges[worker].begin = static_cast<uint32_t>(taskCount * worker / workerCount);
+        ranges[worker].end = static_cast<uint32_t>(taskCount * (worker + 1) / workerCount);
+    }
+
+    currentFunction = &function;
+    busyWorkers = static_cast<uint32_t>(workerCount);
+    stolenTaskCount = 0;
+    generation++;
+
+    startCondition.notify_all();
+    doneCondition.wait(lock, [&] { return busyWorkers == 0; });
+
+    currentFunction = nullptr;
+
+    if (exception) {
+        std::rethrow_exception(std::exchange(exception, nullptr));
+    }
+}
+
+uint32_t WorkStealingPool::getThreadCount() const {
+    return static_cast<uint32_t>(threads.size());
+}
+
+uint32_t WorkStealingPool::getStolenTaskCount() const {
+    return stolenTaskCount;
+}
+
+void WorkStealingPool::work(uint32_t worker) {
+    uint64_t finishedGeneration = 0;
+
+    while (true) {
+        const std::function<void(uint32_t, uint32_t)>* function;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return isStopping || generation != finishedGeneration; });
+
+            if (isStopping)
+                return;
+
+            finishedGeneration = generation;
+            function = currentFunction;
+        }
+
+        try {
+            uint32_t task;
+            while (true) {
+                if (takeTask(worker, task)) {
+                    (*function)(task, worker);
+                } else if (!stealTasks(worker)) {
+                    break;
+                }
+            }
+        } catch (...) {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+
+            for (size_t i = 0; i < threads.size(); i++) {
+                const std::lock_guard<std::mutex> rangeLock(ranges[i].mutex);
+                ranges[i].begin = ranges[i].end;
+            }
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+        }
+
+        doneCondition.notify_one();
+    }
+}
+
+bool WorkStealingPool::takeTask(uint32_t worker, uint32_t &task) {
+    TaskRange &range = ranges[worker];
+    const std::lock_guard<std::mutex> lock(range.mutex);
+
+    if (range.begin == range.end)
+        return false;
+
+    task = range.begin++;
+    return true;
+}
+
+// only one range is locked at a time, a stolen range is briefly held by neither worker
+bool WorkStealingPool::stealTasks(uint32_t worker) {
+    const uint32_t workerCount = getThreadCount();
+
+    for (uint32_t i = 1; i < workerCount; i++) {
+        TaskRange &victim = ranges[(worker + i) % workerCount];
+        uint32_t begin, end;
+
+        {
+            const std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end)
+                continue;
+
+            end = victim.end;
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            victim.end = begin;
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(ranges[worker].mutex);
+            ranges[worker].begin = begin;
+            ranges[worker].end = end;
+        }
+
+        const std::lock_guard<std::mutex> lock(mutex);
+        stolenTaskCount += end - begin;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the tasks of a parallel for-loop on a fixed amount of worker threads. Every worker starts with an equal range
+// of the tasks and works through it from the front. Once its range is empty, it steals the back half of the range of
+// another worker, so uneven tasks (e.g. image tiles with more or less geometry) still keep all threads busy.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(uint32_t threadCount); // 0: one thread per hardware thread
+
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // calls the function with every task index below the task count and the index of the executing worker, returns
+    // once all tasks are done. The first exception of a task is rethrown, once it occurred no new tasks are started.
+    void run(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)> &function);
+
+    [[nodiscard]] uint32_t getThreadCount() const;
+
+    // tasks a worker took from another one during the last run
+    [[nodiscard]] uint32_t getStolenTaskCount() const;
+
+private:
+    // the tasks [begin, end) a worker still has to do
+    struct TaskRange {
+        std::mutex mutex;
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<TaskRange[]> ranges; // one per worker
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    const std::function<void(uint32_t, uint32_t)>* currentFunction = nullptr;
+    uint64_t generation = 0; // incremented by every run
+    uint32_t busyWorkers = 0;
+    uint32_t stolenTaskCount = 0;
+    std::exception_ptr exception;
+    bool isStopping = false;
+
+    void work(uint32_t worker);
+
+    [[nodiscard]] bool takeTask(uint32_t worker, uint32_t &task);
+
+    [[nodiscard]] bool stealTasks(uint32_t worker);
+};
@@ -0,0 +1,77 @@
+#include "workgroup_size_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+uint64_t hashFnv1a(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::optional<WorkgroupSize> readCachedWorkgroupSize(const std::string &path, const std::string &key) {
+    std::ifstream file(path);
+
+    // a missing cache file just means nothing has been tuned yet
+    if (!file.is_open())
+        return std::nullopt;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream entry(line);
+        std::string entryKey;
+        WorkgroupSize workgroupSize = {};
+
+        if (entry >> entryKey >> workgroupSize.x >> workgroupSize.y && entryKey == key)
+            return workgroupSize;
+    }
+
+    return std::nullopt;
+}
+
+void writeCachedWorkgroupSize(const std::string &path, const std::string &key, const WorkgroupSize &workgroupSize) {
+    std::vector<std::string> lines;
+
+    std::ifstream existingFile(path);
+    std::string line;
+    while (std::getline(existingFile, line)) {
+        std::istringstream entry(line);
+        std::string entryKey;
+
+        if (entry >> entryKey && entryKey != key)
+            lines.push_back(line);
+    }
+    existingFile.close();
+
+    // written next to the cache and renamed, like the pipeline cache
+    const std::string temporaryPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+
+        if (!file.is_open())
+            throw std::runtime_error("[Error] Failed to open file at '" + temporaryPath + "'!");
+
+        for (const std::string &existingLine: lines) {
+            file << existingLine << "\n";
+        }
+
+        file << key << " " << workgroupSize.x << " " << workgroupSize.y << "\n";
+
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporaryPath);
+            throw std::runtime_error("[Error] Failed to write file at '" + temporaryPath + "'!");
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+}
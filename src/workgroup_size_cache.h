@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+struct WorkgroupSize {
+    uint32_t x, y;
+};
+
+
+// FNV-1a of the bytes, for keys that have to stay the same across runs and builds (unlike std::hash)
+uint64_t hashFnv1a(const void* data, size_t size);
+
+// the cache is a text file with one "<key> <x> <y>" line per tuned device and shader
+std::optional<WorkgroupSize> readCachedWorkgroupSize(const std::string &path, const std::string &key);
+
+// replaces an existing entry with the same key, the file is replaced as a whole so readers never see a partial one
+void writeCachedWorkgroupSize(const std::string &path, const std::string &key, const WorkgroupSize &workgroupSize);